@@ -15,6 +15,7 @@
 #include "r_studioint.h"
 
 #include "fx_flags.h"
+#include "ev_hldm.h"
 #include "particleman.h"
 
 extern engine_studio_api_t IEngineStudio;
@@ -495,6 +496,41 @@ int __MsgFunc_Streaks( const char* pszName, int iSize, void *pbuf )
 	return 1;
 }
 
+int __MsgFunc_BulletVolley( const char* pszName, int iSize, void *pbuf )
+{
+	BEGIN_READ( pbuf, iSize );
+
+	Vector vecSrc = READ_VECTOR();
+	const int iBulletType = READ_BYTE();
+	int count = READ_BYTE();
+	if( count > BULLET_VOLLEY_MAX_PELLETS )
+		count = BULLET_VOLLEY_MAX_PELLETS;
+
+	bullet_impact_t impacts[BULLET_VOLLEY_MAX_PELLETS];
+	for( int i = 0; i < count; i++ )
+	{
+		bullet_impact_t& impact = impacts[i];
+		impact.flags = READ_BYTE();
+		impact.end = READ_VECTOR();
+		if( impact.flags & BULLET_VOLLEY_HIT )
+		{
+			impact.textureType = READ_CHAR();
+			impact.normal.x = READ_CHAR() / 127.0f;
+			impact.normal.y = READ_CHAR() / 127.0f;
+			impact.normal.z = READ_CHAR() / 127.0f;
+		}
+		else
+		{
+			impact.textureType = 0;
+			impact.normal = Vector( 0, 0, 0 );
+		}
+	}
+
+	EV_HLDM_BulletVolley( vecSrc, iBulletType, impacts, count );
+
+	return 1;
+}
+
 void ExpandCallback(TEMPENTITY *ent, float frametime, float currenttime)
 {
 	const float minScale = 0.0001;
@@ -700,4 +736,5 @@ void HookFXMessages()
 	HOOK_MESSAGE( Smoke );
 	HOOK_MESSAGE( SparkShower );
 	HOOK_MESSAGE( Particle );
+	HOOK_MESSAGE( BulletVolley );
 }
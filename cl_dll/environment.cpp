@@ -25,6 +25,8 @@ extern Vector g_vPlayerVelocity;
 extern const Vector g_vecZero;
 
 extern cvar_t* cl_weather;
+extern cvar_t* cl_particle_batch;
+extern cvar_t* cl_weather_skymap;
 
 constexpr const char* RAINDROP_DEFAULT_SPRITE = "sprites/effects/rain.spr";
 constexpr const char* WINDPUFF_DEFAULT_SPRITE = "sprites/gas_puff_01.spr";
@@ -174,7 +176,8 @@ RainData::RainData():
 	rainSprite(nullptr),
 	windPuffSprite(nullptr),
 	splashSprite(nullptr),
-	rippleSprite(nullptr)
+	rippleSprite(nullptr),
+	impactId(-1)
 {
 	raindropParticleParams.minSize = raindropParticleParams.maxSize = 2.0f;
 	raindropParticleParams.color = Vector(255.0f, 255.0f, 255.0f);
@@ -279,6 +282,30 @@ bool SnowData::SnowflakesAffectedByWind() const
 	return !(flags & SF_SNOW_NOT_AFFECTED_BY_WIND);
 }
 
+RainImpact RainData::GetImpact() const
+{
+	RainImpact impact;
+	impact.splashAllowed = SplashesAllowed();
+	impact.rippleAllowed = RipplesAllowed();
+	impact.splashParams = splashParticleParams;
+	impact.rippleParams = rippleParticleParams;
+	impact.splashSprite = splashSprite;
+	impact.rippleSprite = rippleSprite;
+	return impact;
+}
+
+static bool UseSkyExposureMap()
+{
+	return cl_weather_skymap && cl_weather_skymap->value != 0;
+}
+
+static bool UseParticleBatches()
+{
+	return cl_particle_batch && cl_particle_batch->value != 0;
+}
+
+static void SpawnRainImpact( const RainImpact& impact, const Vector& origin, const Vector& normal );
+
 class CPartRainDrop : public CBaseParticle
 {
 public:
@@ -286,12 +313,7 @@ public:
 	void Think( float flTime ) override;
 	void Touch( Vector pos, Vector normal, int index ) override;
 
-	bool m_splashAllowed = true;
-	bool m_rippleAllowed = true;
-	ParticleParams m_splashParams;
-	ParticleParams m_rippleParams;
-	model_t* m_pRainSplash = nullptr;
-	model_t* m_pRipple = nullptr;
+	RainImpact m_impact;
 
 private:
 	bool m_bTouched = false;
@@ -324,13 +346,18 @@ void CPartRainDrop::Touch( Vector pos, Vector normal, int index )
 
 	m_bTouched = true;
 
-	Vector vecStart = m_vOrigin;
+	SpawnRainImpact( m_impact, m_vOrigin, normal );
+}
+
+static void SpawnRainImpact( const RainImpact& impact, const Vector& origin, const Vector& normal )
+{
+	Vector vecStart = origin;
 	vecStart.z += 32.0f;
 
 	pmtrace_t trace;
 
 	{
-		Vector vecEnd = m_vOrigin;
+		Vector vecEnd = origin;
 		vecEnd.z -= 16.0f;
 
 		gEngfuncs.pEventAPI->EV_PlayerTrace( vecStart, vecEnd, PM_WORLD_ONLY, -1, &trace );
@@ -348,23 +375,23 @@ void CPartRainDrop::Touch( Vector pos, Vector normal, int index )
 
 	if( gEngfuncs.PM_PointContents( trace.endpos, nullptr ) == gEngfuncs.PM_PointContents( vecStart, nullptr ) )
 	{
-		if (m_splashAllowed && m_pRainSplash)
+		if (impact.splashAllowed && impact.splashSprite)
 		{
 			CBaseParticle* pParticle = new CBaseParticle();
 
-			model_t* pRainSplash = m_pRainSplash;
+			model_t* pRainSplash = impact.splashSprite;
 
-			pParticle->InitializeSprite( m_vOrigin + normal, Vector( 90.0f, 0.0f, 0.0f ), pRainSplash, m_splashParams.GetSize(), m_splashParams.brightness );
+			pParticle->InitializeSprite( origin + normal, Vector( 90.0f, 0.0f, 0.0f ), pRainSplash, impact.splashParams.GetSize(), impact.splashParams.brightness );
 
-			pParticle->m_iRendermode = m_splashParams.renderMode;
+			pParticle->m_iRendermode = impact.splashParams.renderMode;
 
 			pParticle->m_flMass = 1.0f;
 			pParticle->m_flGravity = 0.1f;
 
 			pParticle->SetCullFlag( CULL_PVS );
-			pParticle->SetLightFlag( m_splashParams.lightFlag );
+			pParticle->SetLightFlag( impact.splashParams.lightFlag );
 
-			pParticle->m_vColor = m_splashParams.color;
+			pParticle->m_vColor = impact.splashParams.color;
 
 			pParticle->m_iNumFrames = pRainSplash->numframes - 1;
 			pParticle->m_iFramerate = Com_RandomLong( 30, 45 );
@@ -375,7 +402,7 @@ void CPartRainDrop::Touch( Vector pos, Vector normal, int index )
 	}
 	else
 	{
-		if (m_rippleAllowed && m_pRipple)
+		if (impact.rippleAllowed && impact.rippleSprite)
 		{
 			Vector vecBegin = vecStart;
 			Vector vecEnd = trace.endpos;
@@ -408,13 +435,13 @@ void CPartRainDrop::Touch( Vector pos, Vector normal, int index )
 
 			CBaseParticle* pParticle = new CBaseParticle();
 
-			pParticle->InitializeSprite( vecBegin, vecAngles, m_pRipple, m_rippleParams.GetSize(), m_rippleParams.brightness );
+			pParticle->InitializeSprite( vecBegin, vecAngles, impact.rippleSprite, impact.rippleParams.GetSize(), impact.rippleParams.brightness );
 
-			pParticle->m_iRendermode = m_rippleParams.renderMode;
+			pParticle->m_iRendermode = impact.rippleParams.renderMode;
 			pParticle->m_flScaleSpeed = 1.0f;
-			pParticle->m_vColor = m_rippleParams.color;
+			pParticle->m_vColor = impact.rippleParams.color;
 			pParticle->SetCullFlag( CULL_PVS );
-			pParticle->SetLightFlag( m_rippleParams.lightFlag );
+			pParticle->SetLightFlag( impact.rippleParams.lightFlag );
 			pParticle->m_flFadeSpeed = 2.0f;
 			pParticle->m_flDieTime = gEngfuncs.GetClientTime() + 2.0f;
 		}
@@ -538,10 +565,87 @@ void CPartSnowFlake::Touch( Vector pos, Vector normal, int index )
 	m_flTimeCreated = gEngfuncs.GetClientTime();
 }
 
+int CSkyExposureMap::CellCoord( float f )
+{
+	return static_cast<int>( floor( f / CELL_SIZE ) );
+}
+
+int CSkyExposureMap::ColumnKey( int cellX, int cellY )
+{
+	return ( ( cellX & 0xFFFF ) << 16 ) | ( cellY & 0xFFFF );
+}
+
+void CSkyExposureMap::Clear()
+{
+	_columns.clear();
+}
+
+bool CSkyExposureMap::BuildColumn( int cellX, int cellY, float z, Column& column )
+{
+	pmtrace_t trace;
+
+	// Sample the middle of the cell so the column doesn't depend on which point requested it
+	Vector vecStart( ( cellX + 0.5f ) * CELL_SIZE, ( cellY + 0.5f ) * CELL_SIZE, z );
+	Vector vecEnd = vecStart;
+	vecEnd.z = 8000.0f;
+
+	gEngfuncs.pEventAPI->EV_SetTraceHull( large_hull );
+	gEngfuncs.pEventAPI->EV_PlayerTrace( vecStart, vecEnd, PM_WORLD_ONLY, -1, &trace );
+	if( trace.startsolid || trace.allsolid )
+		return false;
+
+	const char* pszTexture = gEngfuncs.pEventAPI->EV_TraceTexture( trace.ent, vecStart, trace.endpos );
+	column.exposed = pszTexture && strncmp( pszTexture, "sky", 3 ) == 0;
+	column.topZ = trace.endpos.z;
+
+	vecStart.z = column.topZ;
+	vecEnd.z = -8000.0f;
+	gEngfuncs.pEventAPI->EV_SetTraceHull( large_hull );
+	gEngfuncs.pEventAPI->EV_PlayerTrace( vecStart, vecEnd, PM_WORLD_ONLY, -1, &trace );
+	column.bottomZ = trace.endpos.z;
+
+	return true;
+}
+
+bool CSkyExposureMap::Lookup( const Vector& point, bool& exposed, float& groundZ )
+{
+	const int cellX = CellCoord( point.x );
+	const int cellY = CellCoord( point.y );
+	const int key = ColumnKey( cellX, cellY );
+
+	auto it = _columns.find( key );
+	if( it == _columns.end() || point.z < it->second.bottomZ || point.z > it->second.topZ )
+	{
+		Column column;
+		if( !BuildColumn( cellX, cellY, point.z, column ) )
+			return false;
+		it = _columns.insert( std::make_pair( key, column ) ).first;
+		it->second = column;
+	}
+
+	exposed = it->second.exposed;
+	groundZ = it->second.bottomZ;
+	return true;
+}
+
+bool CSkyExposureMap::IsUnderSky( const Vector& point )
+{
+	bool exposed;
+	float groundZ;
+	return Lookup( point, exposed, groundZ ) && exposed;
+}
+
+static void BatchedRaindropImpact( int impactId, const Vector& origin, const Vector& normal )
+{
+	g_Environment.RaindropImpact( impactId, origin, normal );
+}
+
 void CEnvironment::Initialize()
 {
 	Reset();
 
+	CParticleBatch::SetImpactCallback( BatchedRaindropImpact );
+
 	m_flWeatherValue = cl_weather->value;
 }
 
@@ -572,6 +676,16 @@ void CEnvironment::Clear()
 {
 	m_rains.clear();
 	m_snows.clear();
+	m_rainImpacts.clear();
+	m_skyExposure.Clear();
+}
+
+void CEnvironment::RaindropImpact( int impactId, const Vector& origin, const Vector& normal ) const
+{
+	if( impactId >= 0 && impactId < static_cast<int>( m_rainImpacts.size() ) )
+	{
+		SpawnRainImpact( m_rainImpacts[impactId], origin, normal );
+	}
 }
 
 void CEnvironment::Update()
@@ -744,14 +858,9 @@ void CEnvironment::UpdateRain(const RainData& rainData)
 			vecEndPos.y = vecOrigin.y + g_vPlayerVelocity.y;
 			vecEndPos.z = 8000.0f;
 
-			gEngfuncs.pEventAPI->EV_SetTraceHull( large_hull );
-			gEngfuncs.pEventAPI->EV_PlayerTrace( vecOrigin, vecEndPos, PM_WORLD_ONLY, -1, &trace );
-			const char* pszTexture = gEngfuncs.pEventAPI->EV_TraceTexture( trace.ent, vecOrigin, trace.endpos );
-
-			if( allowIndoors || (pszTexture && strncmp( pszTexture, "sky", 3 ) == 0) )
+			if( allowIndoors || IsUnderSky( vecOrigin, vecEndPos ) )
 			{
-				CPartRainDrop* rainParticle = CreateRaindrop( vecOrigin, rainData );
-				if (rainParticle)
+				if (CreateRaindrop( vecOrigin, rainData ))
 					rainDropCount++;
 
 				if (windParticlesEnabled)
@@ -767,20 +876,33 @@ void CEnvironment::UpdateRain(const RainData& rainData)
 
 						vecEndPos.z = 8000.0f;
 
-						gEngfuncs.pEventAPI->EV_SetTraceHull( large_hull );
-						gEngfuncs.pEventAPI->EV_PlayerTrace( vecWindOrigin, vecEndPos, PM_WORLD_ONLY, -1, &trace );
-						pszTexture = gEngfuncs.pEventAPI->EV_TraceTexture( trace.ent, vecOrigin, trace.endpos );
-
-						if( allowIndoors || (pszTexture && strncmp( pszTexture, "sky", 3 ) == 0) )
+						if( UseSkyExposureMap() )
+						{
+							// The column ground is found with the same hull as the trace below
+							bool exposed;
+							float flGroundZ;
+							if( m_skyExposure.Lookup( vecWindOrigin, exposed, flGroundZ ) && ( allowIndoors || exposed ) )
+							{
+								if (CreateWindParticle( Vector( vecWindOrigin.x, vecWindOrigin.y, flGroundZ ), rainData ))
+									windParticleCount++;
+							}
+						}
+						else
 						{
-							vecEndPos.z = -8000.0f;
-
 							gEngfuncs.pEventAPI->EV_SetTraceHull( large_hull );
 							gEngfuncs.pEventAPI->EV_PlayerTrace( vecWindOrigin, vecEndPos, PM_WORLD_ONLY, -1, &trace );
+							const char* pszTexture = gEngfuncs.pEventAPI->EV_TraceTexture( trace.ent, vecOrigin, trace.endpos );
+
+							if( allowIndoors || (pszTexture && strncmp( pszTexture, "sky", 3 ) == 0) )
+							{
+								vecEndPos.z = -8000.0f;
 
-							CPartWind* windParticle = CreateWindParticle( trace.endpos, rainData );
-							if (windParticle)
-								windParticleCount++;
+								gEngfuncs.pEventAPI->EV_SetTraceHull( large_hull );
+								gEngfuncs.pEventAPI->EV_PlayerTrace( vecWindOrigin, vecEndPos, PM_WORLD_ONLY, -1, &trace );
+
+								if (CreateWindParticle( trace.endpos, rainData ))
+									windParticleCount++;
+							}
 						}
 					}
 					else
@@ -828,11 +950,7 @@ void CEnvironment::UpdateSnow(const SnowData& snowData)
 			vecEndPos.y = vecOrigin.y + g_vPlayerVelocity.y;
 			vecEndPos.z = 8000.0f;
 
-			gEngfuncs.pEventAPI->EV_SetTraceHull( large_hull );
-			gEngfuncs.pEventAPI->EV_PlayerTrace( vecOrigin, vecEndPos, PM_WORLD_ONLY, -1, &trace );
-			const char* pszTexture = gEngfuncs.pEventAPI->EV_TraceTexture( trace.ent, vecOrigin, trace.endpos );
-
-			if( allowIndoors || (pszTexture && strncmp( pszTexture, "sky", 3 ) == 0) )
+			if( allowIndoors || IsUnderSky( vecOrigin, vecEndPos ) )
 			{
 				CreateSnowFlake( vecOrigin, snowData );
 			}
@@ -840,20 +958,54 @@ void CEnvironment::UpdateSnow(const SnowData& snowData)
 	}
 }
 
-CPartRainDrop* CEnvironment::CreateRaindrop( const Vector& vecOrigin, const RainData& rainData )
+bool CEnvironment::IsUnderSky( Vector vecOrigin, Vector vecEndPos )
+{
+	if( UseSkyExposureMap() )
+		return m_skyExposure.IsUnderSky( vecOrigin );
+
+	pmtrace_t trace;
+	gEngfuncs.pEventAPI->EV_SetTraceHull( large_hull );
+	gEngfuncs.pEventAPI->EV_PlayerTrace( vecOrigin, vecEndPos, PM_WORLD_ONLY, -1, &trace );
+	const char* pszTexture = gEngfuncs.pEventAPI->EV_TraceTexture( trace.ent, vecOrigin, trace.endpos );
+	return pszTexture && strncmp( pszTexture, "sky", 3 ) == 0;
+}
+
+bool CEnvironment::CreateRaindrop( const Vector& vecOrigin, const RainData& rainData )
 {
 	if( !rainData.rainSprite )
 	{
-		return nullptr;
+		return false;
+	}
+
+	if( UseParticleBatches() )
+	{
+		CParticleBatch::SpawnParams params;
+		params.origin = vecOrigin;
+		params.sprite = rainData.rainSprite;
+		params.size = rainData.raindropParticleParams.GetSize();
+		params.brightness = rainData.raindropParticleParams.brightness;
+		params.stretchY = rainData.raindropStretchY;
+
+		if (rainData.RaindropsAffectedByWind())
+		{
+			params.velocity.x = m_vecWind.x * Com_RandomFloat( 1.0f, 2.0f );
+			params.velocity.y = m_vecWind.y * Com_RandomFloat( 1.0f, 2.0f );
+		}
+
+		params.velocity.z = -rainData.GetRaindropFallingSpeed();
+		params.collisionFlags = TRI_COLLIDEWORLD | TRI_COLLIDEKILL | TRI_WATERTRACE;
+		params.lightFlag = rainData.raindropParticleParams.lightFlag;
+		params.renderMode = rainData.raindropParticleParams.renderMode;
+		params.color = rainData.raindropParticleParams.color;
+		params.dieTime = gEngfuncs.GetClientTime() + rainData.raindropLife;
+		params.impactId = rainData.impactId;
+
+		CMiniMem::Instance()->GetBatch( CParticleBatch::Raindrop ).Add( params );
+		return true;
 	}
 
 	CPartRainDrop* pParticle = new CPartRainDrop();
-	pParticle->m_splashAllowed = rainData.SplashesAllowed();
-	pParticle->m_rippleAllowed = rainData.RipplesAllowed();
-	pParticle->m_splashParams = rainData.splashParticleParams;
-	pParticle->m_rippleParams = rainData.rippleParticleParams;
-	pParticle->m_pRainSplash = rainData.splashSprite;
-	pParticle->m_pRipple = rainData.rippleSprite;
+	pParticle->m_impact = rainData.GetImpact();
 
 	pParticle->InitializeSprite( vecOrigin, g_vecZero, rainData.rainSprite, rainData.raindropParticleParams.GetSize(), rainData.raindropParticleParams.brightness );
 
@@ -886,24 +1038,52 @@ CPartRainDrop* CEnvironment::CreateRaindrop( const Vector& vecOrigin, const Rain
 
 	pParticle->m_flDieTime = gEngfuncs.GetClientTime() + rainData.raindropLife;
 
-	return pParticle;
+	return true;
 }
 
-CPartWind* CEnvironment::CreateWindParticle( const Vector& vecOrigin, const RainData& rainData )
+bool CEnvironment::CreateWindParticle( const Vector& vecOrigin, const RainData& rainData )
 {
 	if( !rainData.windPuffSprite )
 	{
-		return nullptr;
+		return false;
 	}
 
-	CPartWind* pParticle = new CPartWind();
-
 	Vector vecPartOrigin = vecOrigin;
 
 	float particleSize = rainData.windParticleParams.GetSize();
 
 	vecPartOrigin.z += particleSize * 0.3f;
 
+	if( UseParticleBatches() )
+	{
+		CParticleBatch::SpawnParams params;
+		params.origin = vecPartOrigin;
+		params.sprite = rainData.windPuffSprite;
+		params.size = particleSize;
+		params.brightness = rainData.windParticleParams.brightness;
+
+		params.velocity.x = m_vecWind.x / Com_RandomFloat( 1.0f, 2.0f );
+		params.velocity.y = m_vecWind.y / Com_RandomFloat( 1.0f, 2.0f );
+
+		if( Com_RandomFloat( 0.0, 1.0 ) < 0.1 )
+		{
+			params.velocity.x *= 0.5;
+			params.velocity.y *= 0.5;
+		}
+
+		params.collisionFlags = TRI_COLLIDEWORLD;
+		params.bounceFactor = 0;
+		params.lightFlag = rainData.windParticleParams.lightFlag;
+		params.renderMode = rainData.windParticleParams.renderMode;
+		params.color = rainData.windParticleParams.color;
+		params.dieTime = gEngfuncs.GetClientTime() + rainData.windpuffLife;
+
+		CMiniMem::Instance()->GetBatch( CParticleBatch::WindPuff ).Add( params );
+		return true;
+	}
+
+	CPartWind* pParticle = new CPartWind();
+
 	pParticle->InitializeSprite(
 		vecPartOrigin, g_vecZero,
 		rainData.windPuffSprite,
@@ -949,7 +1129,7 @@ CPartWind* CEnvironment::CreateWindParticle( const Vector& vecOrigin, const Rain
 
 	pParticle->m_flDieTime = gEngfuncs.GetClientTime() + rainData.windpuffLife;
 
-	return pParticle;
+	return true;
 }
 
 void CEnvironment::CreateSnowFlake( const Vector& vecOrigin, const SnowData& snowData )
@@ -959,6 +1139,55 @@ void CEnvironment::CreateSnowFlake( const Vector& vecOrigin, const SnowData& sno
 		return;
 	}
 
+	if( UseParticleBatches() )
+	{
+		CParticleBatch::SpawnParams params;
+		params.origin = vecOrigin;
+		params.sprite = snowData.snowSprite;
+		params.size = snowData.snowflakeParticleParams.GetSize();
+		params.brightness = snowData.snowflakeInitialBrightness;
+		params.targetBrightness = snowData.snowflakeParticleParams.brightness;
+
+		if (snowData.SnowflakesAffectedByWind())
+		{
+			params.velocity.x = m_vecWind.x / Com_RandomFloat( 1.0, 2.0 );
+			params.velocity.y = m_vecWind.y / Com_RandomFloat( 1.0, 2.0 );
+		}
+
+		params.velocity.z = -snowData.GetSnowflakeFallingSpeed();
+
+		const float flFrac = Com_RandomFloat( 0.0, 1.0 );
+
+		if( flFrac >= 0.1 )
+		{
+			if( flFrac < 0.2 )
+			{
+				params.velocity.z = -65.0;
+			}
+			else if( flFrac < 0.3 )
+			{
+				params.velocity.z = -75.0;
+			}
+		}
+		else
+		{
+			params.velocity.x *= 0.5;
+			params.velocity.y *= 0.5;
+		}
+
+		params.collisionFlags = TRI_COLLIDEWORLD;
+		params.bounceFactor = 0;
+		params.lightFlag = snowData.snowflakeParticleParams.lightFlag;
+		params.renderMode = snowData.snowflakeParticleParams.renderMode;
+		params.color = snowData.snowflakeParticleParams.color;
+		params.dieTime = gEngfuncs.GetClientTime() + snowData.snowflakeLife;
+		params.spiral = Com_RandomLong( 0, 1 ) != 0;
+		params.spiralTime = gEngfuncs.GetClientTime() + Com_RandomLong( 2, 4 );
+
+		CMiniMem::Instance()->GetBatch( CParticleBatch::Snowflake ).Add( params );
+		return;
+	}
+
 	CPartSnowFlake* pParticle = new CPartSnowFlake();
 	pParticle->m_targetBrightness = snowData.snowflakeParticleParams.brightness;
 
@@ -1381,6 +1610,8 @@ void CEnvironment::AddRain(const RainData &rainData)
 		return;
 	}
 	m_rains.push_back(rainData);
+	m_rains.back().impactId = static_cast<int>(m_rainImpacts.size());
+	m_rainImpacts.push_back(rainData.GetImpact());
 }
 
 void CEnvironment::RemoveSnow(int entIndex)
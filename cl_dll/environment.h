@@ -6,11 +6,9 @@
 #include "cl_dll.h"
 #include "com_model.h"
 
+#include <unordered_map>
 #include <vector>
 
-class CPartRainDrop;
-class CPartWind;
-
 struct ParticleParams
 {
 	float minSize;
@@ -23,6 +21,17 @@ struct ParticleParams
 	float GetSize() const;
 };
 
+// What a raindrop spawns when it hits the ground or water
+struct RainImpact
+{
+	bool splashAllowed = true;
+	bool rippleAllowed = true;
+	ParticleParams splashParams;
+	ParticleParams rippleParams;
+	model_t* splashSprite = nullptr;
+	model_t* rippleSprite = nullptr;
+};
+
 struct WeatherData
 {
 	WeatherData();
@@ -84,6 +93,10 @@ struct RainData : public WeatherData
 	model_t* windPuffSprite;
 	model_t* splashSprite;
 	model_t* rippleSprite;
+
+	int impactId; // index into CEnvironment::m_rainImpacts, used by batched raindrops
+
+	RainImpact GetImpact() const;
 };
 
 struct SnowData : public WeatherData
@@ -103,6 +116,37 @@ struct SnowData : public WeatherData
 	model_t* snowSprite;
 };
 
+// Lazily built 2D map of the world columns open to the sky, used by the weather spawners instead of tracing per particle.
+// Each column remembers the vertical span a sky test was done for: the weather hull goes up to topZ, where it either hits
+// the sky or a ceiling, and down to bottomZ where it hits the ground. Points inside the span get the cached answer,
+// points outside of it rebuild the column from their own height.
+class CSkyExposureMap
+{
+public:
+	void Clear();
+
+	// Finds if the weather hull at point can reach the sky and the height the hull stops at below the point.
+	// Returns false if the point is in solid.
+	bool Lookup( const Vector& point, bool& exposed, float& groundZ );
+	bool IsUnderSky( const Vector& point );
+
+	static const int CELL_SIZE = 32;
+
+private:
+	struct Column
+	{
+		float bottomZ;
+		float topZ;
+		bool exposed;
+	};
+
+	static int CellCoord( float f );
+	static int ColumnKey( int cellX, int cellY );
+	static bool BuildColumn( int cellX, int cellY, float z, Column& column );
+
+	std::unordered_map<int, Column> _columns;
+};
+
 class CEnvironment
 {
 public:
@@ -118,6 +162,8 @@ public:
 	int MsgFunc_Rain(const char *pszName, int iSize, void *pbuf);
 	int MsgFunc_Snow(const char *pszName, int iSize, void *pbuf);
 
+	void RaindropImpact(int impactId, const Vector& origin, const Vector& normal) const;
+
 private:
 	void RemoveRain(int entIndex);
 	void AddRain(const RainData& rainData);
@@ -128,9 +174,10 @@ private:
 	void UpdateWind();
 	void UpdateRain(const RainData& rainData);
 	void UpdateSnow(const SnowData& snowData);
+	bool IsUnderSky(Vector vecOrigin, Vector vecEndPos);
 
-	CPartRainDrop* CreateRaindrop(const Vector& vecOrigin, const RainData& rainData);
-	CPartWind* CreateWindParticle(const Vector& vecOrigin, const RainData& rainData);
+	bool CreateRaindrop(const Vector& vecOrigin, const RainData& rainData);
+	bool CreateWindParticle(const Vector& vecOrigin, const RainData& rainData);
 	void CreateSnowFlake(const Vector& vecOrigin, const SnowData& snowData);
 
 	model_t* LoadSprite(const char* spriteName);
@@ -158,6 +205,11 @@ private:
 	std::vector<RainData> m_rains;
 	std::vector<SnowData> m_snows;
 
+	// Kept until the next reset, batched raindrops may outlive the rain that spawned them
+	std::vector<RainImpact> m_rainImpacts;
+
+	CSkyExposureMap m_skyExposure;
+
 private:
 	CEnvironment( const CEnvironment& ) = delete;
 	CEnvironment& operator=( const CEnvironment& ) = delete;
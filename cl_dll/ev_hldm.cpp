@@ -36,6 +36,7 @@
 #include "com_model.h"
 #include "mod_features.h"
 #include "tex_materials.h"
+#include "fx_flags.h"
 
 extern engine_studio_api_t IEngineStudio;
 
@@ -74,8 +75,6 @@ char EV_HLDM_GetTextureSound( int idx, pmtrace_t *ptr, float *vecSrc, float *vec
 	int entity;
 	cl_entity_t *ent;
 	const char *pTextureName;
-	char texname[64];
-	char szbuffer[64];
 
 	entity = gEngfuncs.pEventAPI->EV_IndexFromTrace( ptr );
 
@@ -104,18 +103,13 @@ char EV_HLDM_GetTextureSound( int idx, pmtrace_t *ptr, float *vecSrc, float *vec
 
 			if ( pTextureName )
 			{
-				strcpy( texname, pTextureName );
-				pTextureName = texname;
-
 				if( strcmp( pTextureName, "sky" ) == 0 )
 				{
 					isSky = true;
 				}
 
-				GetStrippedTextureName(szbuffer, pTextureName);
-
-				// get texture type
-				chTextureType = PM_FindTextureType( szbuffer );
+				// get texture type, cached per texture
+				chTextureType = PM_FindTextureTypeByTexture( pTextureName );
 			}
 		}
 	}
@@ -123,7 +117,7 @@ char EV_HLDM_GetTextureSound( int idx, pmtrace_t *ptr, float *vecSrc, float *vec
 	return chTextureType;
 }
 
-float EV_HLDM_PlayTextureSound( pmtrace_t *ptr, char chTextureType, int iBulletType )
+float EV_HLDM_PlayTextureSound( pmtrace_t *ptr, char chTextureType, int iBulletType, float volumeScale = 1.0f )
 {
 	float fvol;
 	float fvolbar;
@@ -133,6 +127,7 @@ float EV_HLDM_PlayTextureSound( pmtrace_t *ptr, char chTextureType, int iBulletT
 
 	if (!GetTextureMaterialProperties(chTextureType, &fvol, &fvolbar, rgsz, &cnt, &fattn, iBulletType))
 		return 0;
+	fvol *= volumeScale;
 	// play material hit sound
 	gEngfuncs.pEventAPI->EV_PlaySound( 0, ptr->endpos, CHAN_STATIC, rgsz[gEngfuncs.pfnRandomLong( 0, cnt - 1 )], fvol, fattn, 0, 96 + gEngfuncs.pfnRandomLong( 0, 0xf ) );
 
@@ -433,52 +428,105 @@ int EV_HLDM_CheckTracer( int idx, float *vecSrc, float *end, float *forward, flo
 	return tracer;
 }
 
+// Texture lookup shared by the pellets that hit the same plane of the same entity.
+// World faces on one plane often have different textures (a sky next to a ceiling), so world hits aren't shared.
+struct ev_surface_t
+{
+	int ent;
+	Vector normal;
+	float dist;
+	char textureType;
+	bool isSky;
+};
+
+#define EV_MAX_BATCHED_PELLETS 32
+
+static char EV_HLDM_GetSurfaceTextureSound( int idx, pmtrace_t *ptr, float *vecSrc, float *vecEnd, int iBulletType, bool& isSky, ev_surface_t *pSurfaces, int& surfaceCount )
+{
+	// world is ent(0)
+	if( ptr->ent == 0 )
+		return EV_HLDM_GetTextureSound( idx, ptr, vecSrc, vecEnd, iBulletType, isSky );
+
+	for( int i = 0; i < surfaceCount; i++ )
+	{
+		const ev_surface_t &surface = pSurfaces[i];
+		if( surface.ent == ptr->ent && surface.dist == ptr->plane.dist && surface.normal == Vector( ptr->plane.normal ) )
+		{
+			isSky = surface.isSky;
+			return surface.textureType;
+		}
+	}
+
+	const char cTextureType = EV_HLDM_GetTextureSound( idx, ptr, vecSrc, vecEnd, iBulletType, isSky );
+
+	if( surfaceCount < EV_MAX_BATCHED_PELLETS )
+	{
+		ev_surface_t &surface = pSurfaces[surfaceCount++];
+		surface.ent = ptr->ent;
+		surface.normal = ptr->plane.normal;
+		surface.dist = ptr->plane.dist;
+		surface.textureType = cTextureType;
+		surface.isSky = isSky;
+	}
+	return cTextureType;
+}
+
 /*
 ================
 FireBullets
 
 Go to the trouble of combining multiple pellets into a single damage call.
+The prediction state is set up once per batch of pellets, and the hits on the same plane of an entity other than the world share a texture lookup.
 ================
 */
 void EV_HLDM_FireBullets( int idx, float *forward, float *right, float *up, int cShots, float *vecSrc, float *vecDirShooting, float flDistance, int iBulletType, int iTracerFreq, int *tracerCount, float flSpreadX, float flSpreadY )
 {
 	int i;
-	pmtrace_t tr;
 	int iShot;
 	int tracer;
 	bool isSky;
 
+	Vector vecEnds[EV_MAX_BATCHED_PELLETS];
+	pmtrace_t traces[EV_MAX_BATCHED_PELLETS];
+	ev_surface_t surfaces[EV_MAX_BATCHED_PELLETS];
+
 	if( EV_IsLocal( idx ) )
 	{
 		EV_MuzzleLight(Vector(forward));
 	}
 
-	for( iShot = 1; iShot <= cShots; iShot++ )
+	for( int iFirstShot = 1; iFirstShot <= cShots; iFirstShot += EV_MAX_BATCHED_PELLETS )
 	{
-		Vector vecDir, vecEnd;
-		float x, y, z;
+		const int batchCount = Q_min( cShots - iFirstShot + 1, EV_MAX_BATCHED_PELLETS );
 
-		//We randomize for the Shotgun.
-		if( iBulletType == BULLET_PLAYER_BUCKSHOT )
+		for( int iPellet = 0; iPellet < batchCount; iPellet++ )
 		{
-			do{
-				x = gEngfuncs.pfnRandomFloat( -0.5, 0.5 ) + gEngfuncs.pfnRandomFloat( -0.5, 0.5 );
-				y = gEngfuncs.pfnRandomFloat( -0.5, 0.5 ) + gEngfuncs.pfnRandomFloat( -0.5, 0.5 );
-				z = x * x + y * y;
-			}while( z > 1 );
+			Vector vecDir;
+			Vector &vecEnd = vecEnds[iPellet];
+			float x, y, z;
 
-			for( i = 0 ; i < 3; i++ )
+			//We randomize for the Shotgun.
+			if( iBulletType == BULLET_PLAYER_BUCKSHOT )
 			{
-				vecDir[i] = vecDirShooting[i] + x * flSpreadX * right[i] + y * flSpreadY * up [i];
-				vecEnd[i] = vecSrc[i] + flDistance * vecDir[i];
-			}
-		}//But other guns already have their spread randomized in the synched spread.
-		else
-		{
-			for( i = 0 ; i < 3; i++ )
+				do{
+					x = gEngfuncs.pfnRandomFloat( -0.5, 0.5 ) + gEngfuncs.pfnRandomFloat( -0.5, 0.5 );
+					y = gEngfuncs.pfnRandomFloat( -0.5, 0.5 ) + gEngfuncs.pfnRandomFloat( -0.5, 0.5 );
+					z = x * x + y * y;
+				}while( z > 1 );
+
+				for( i = 0 ; i < 3; i++ )
+				{
+					vecDir[i] = vecDirShooting[i] + x * flSpreadX * right[i] + y * flSpreadY * up [i];
+					vecEnd[i] = vecSrc[i] + flDistance * vecDir[i];
+				}
+			}//But other guns already have their spread randomized in the synched spread.
+			else
 			{
-				vecDir[i] = vecDirShooting[i] + flSpreadX * right[i] + flSpreadY * up [i];
-				vecEnd[i] = vecSrc[i] + flDistance * vecDir[i];
+				for( i = 0 ; i < 3; i++ )
+				{
+					vecDir[i] = vecDirShooting[i] + flSpreadX * right[i] + flSpreadY * up [i];
+					vecEnd[i] = vecSrc[i] + flDistance * vecDir[i];
+				}
 			}
 		}
 
@@ -491,45 +539,54 @@ void EV_HLDM_FireBullets( int idx, float *forward, float *right, float *up, int
 		gEngfuncs.pEventAPI->EV_SetSolidPlayers( idx - 1 );
 
 		gEngfuncs.pEventAPI->EV_SetTraceHull( 2 );
-		gEngfuncs.pEventAPI->EV_PlayerTrace( vecSrc, vecEnd, PM_NORMAL, -1, &tr );
+		for( int iPellet = 0; iPellet < batchCount; iPellet++ )
+			gEngfuncs.pEventAPI->EV_PlayerTrace( vecSrc, vecEnds[iPellet], PM_NORMAL, -1, &traces[iPellet] );
 
-		tracer = EV_HLDM_CheckTracer( idx, vecSrc, tr.endpos, forward, right, iBulletType, iTracerFreq, tracerCount );
-
-		// do damage, paint decals
-		if( tr.fraction != 1.0f )
+		// Physent indices in the traces are only valid until the states are popped, so dispatch the effects here
+		int surfaceCount = 0;
+		for( int iPellet = 0; iPellet < batchCount; iPellet++ )
 		{
-			bool shouldPlayTextureSound = true;
-			bool shouldPlayGunshotEffect= true;
+			pmtrace_t &tr = traces[iPellet];
+			iShot = iFirstShot + iPellet;
 
-			switch( iBulletType )
-			{
-			default:
-			case BULLET_PLAYER_9MM:
-				break;
-			case BULLET_PLAYER_MP5:
-			case BULLET_PLAYER_556:
-			case BULLET_PLAYER_UZI:
-				shouldPlayTextureSound = shouldPlayGunshotEffect = !tracer;
-				break;
-			case BULLET_PLAYER_BUCKSHOT:
-				shouldPlayTextureSound = iShot == 1;
-				break;
-			case BULLET_PLAYER_357:
-			case BULLET_PLAYER_EAGLE:
-			case BULLET_PLAYER_762:
-				break;
-			}
+			tracer = EV_HLDM_CheckTracer( idx, vecSrc, tr.endpos, forward, right, iBulletType, iTracerFreq, tracerCount );
 
-			if ( shouldPlayTextureSound || shouldPlayGunshotEffect )
+			// do damage, paint decals
+			if( tr.fraction != 1.0f )
 			{
-				const char cTextureType = EV_HLDM_GetTextureSound( idx, &tr, vecSrc, vecEnd, iBulletType, isSky );
-				if ( shouldPlayTextureSound )
+				bool shouldPlayTextureSound = true;
+				bool shouldPlayGunshotEffect= true;
+
+				switch( iBulletType )
 				{
-					EV_HLDM_PlayTextureSound(&tr, cTextureType, iBulletType);
+				default:
+				case BULLET_PLAYER_9MM:
+					break;
+				case BULLET_PLAYER_MP5:
+				case BULLET_PLAYER_556:
+				case BULLET_PLAYER_UZI:
+					shouldPlayTextureSound = shouldPlayGunshotEffect = !tracer;
+					break;
+				case BULLET_PLAYER_BUCKSHOT:
+					shouldPlayTextureSound = iShot == 1;
+					break;
+				case BULLET_PLAYER_357:
+				case BULLET_PLAYER_EAGLE:
+				case BULLET_PLAYER_762:
+					break;
 				}
-				if ( shouldPlayGunshotEffect )
+
+				if ( shouldPlayTextureSound || shouldPlayGunshotEffect )
 				{
-					EV_HLDM_DecalGunshot( &tr, iBulletType, cTextureType, isSky );
+					const char cTextureType = EV_HLDM_GetSurfaceTextureSound( idx, &tr, vecSrc, vecEnds[iPellet], iBulletType, isSky, surfaces, surfaceCount );
+					if ( shouldPlayTextureSound )
+					{
+						EV_HLDM_PlayTextureSound(&tr, cTextureType, iBulletType);
+					}
+					if ( shouldPlayGunshotEffect )
+					{
+						EV_HLDM_DecalGunshot( &tr, iBulletType, cTextureType, isSky );
+					}
 				}
 			}
 		}
@@ -538,6 +595,108 @@ void EV_HLDM_FireBullets( int idx, float *forward, float *right, float *up, int
 	}
 }
 
+static float EV_HLDM_WaterLevel( Vector position, float minz, float maxz )
+{
+	position.z = minz;
+	if( gEngfuncs.PM_PointContents( position, NULL ) != CONTENTS_WATER )
+		return minz;
+
+	position.z = maxz;
+	if( gEngfuncs.PM_PointContents( position, NULL ) == CONTENTS_WATER )
+		return maxz;
+
+	float diff = maxz - minz;
+	while( diff > 1.0f )
+	{
+		position.z = minz + diff / 2.0f;
+		if( gEngfuncs.PM_PointContents( position, NULL ) == CONTENTS_WATER )
+			minz = position.z;
+		else
+			maxz = position.z;
+		diff = maxz - minz;
+	}
+
+	return position.z;
+}
+
+static void EV_HLDM_BubbleTrail( Vector from, Vector to, int count )
+{
+	float flHeight = EV_HLDM_WaterLevel( from, from.z, from.z + 256 ) - from.z;
+	if( flHeight < 8 )
+	{
+		flHeight = EV_HLDM_WaterLevel( to, to.z, to.z + 256 ) - to.z;
+		if( flHeight < 8 )
+			return;
+
+		flHeight = flHeight + to.z - from.z;
+	}
+
+	if( count > 255 )
+		count = 255;
+
+	gEngfuncs.pEfxAPI->R_BubbleTrail( from, to, flHeight, gEngfuncs.pEventAPI->EV_FindModelIndex( "sprites/bubble.spr" ), count, 8 );
+}
+
+/*
+================
+BulletVolley
+
+Expands the pellets of a monster volley sent by the server into tracers, impact sounds, decals and bubble trails.
+================
+*/
+void EV_HLDM_BulletVolley( float *vecSrc, int iBulletType, const bullet_impact_t *pImpacts, int count )
+{
+	pmtrace_t tr;
+
+	gEngfuncs.pEventAPI->EV_SetUpPlayerPrediction( false, true );
+	gEngfuncs.pEventAPI->EV_PushPMStates();
+	gEngfuncs.pEventAPI->EV_SetSolidPlayers( -1 );
+	gEngfuncs.pEventAPI->EV_SetTraceHull( 2 );
+
+	for( int i = 0; i < count; i++ )
+	{
+		const bullet_impact_t &impact = pImpacts[i];
+		Vector vecEnd = impact.end;
+
+		if( impact.flags & BULLET_VOLLEY_TRACER )
+			EV_CreateTracer( vecSrc, vecEnd );
+
+		if( impact.flags & BULLET_VOLLEY_HIT )
+		{
+			// Only the impact point is sent, find the surface entity with a short trace along the normal
+			Vector vecTraceStart = vecEnd + impact.normal * 4.0f;
+			Vector vecTraceEnd = vecEnd - impact.normal * 4.0f;
+			gEngfuncs.pEventAPI->EV_PlayerTrace( vecTraceStart, vecTraceEnd, PM_STUDIO_IGNORE, -1, &tr );
+			const bool foundSurface = tr.fraction != 1.0f && !tr.allsolid;
+			if( !foundSurface )
+			{
+				tr.endpos = vecEnd;
+				tr.plane.normal = impact.normal;
+			}
+
+			if( impact.flags & BULLET_VOLLEY_SOUND )
+			{
+				// drop volumes for breakables, the object will already play a damaged sound
+				EV_HLDM_PlayTextureSound( &tr, impact.textureType, iBulletType, ( impact.flags & BULLET_VOLLEY_QUIET_SOUND ) ? 1.0f / 1.5f : 1.0f );
+			}
+
+			if( impact.flags & BULLET_VOLLEY_SPARKS )
+			{
+				gEngfuncs.pEfxAPI->R_SparkShower( tr.endpos );
+				gEngfuncs.pEventAPI->EV_PlaySound( 0, tr.endpos, CHAN_STATIC, gEngfuncs.pfnRandomLong( 0, 1 ) ? "buttons/spark6.wav" : "buttons/spark5.wav",
+												   gEngfuncs.pfnRandomFloat( 0.7f, 1.0f ), ATTN_NORM, 0, PITCH_NORM );
+			}
+
+			if( ( impact.flags & BULLET_VOLLEY_DECAL ) && foundSurface )
+				EV_HLDM_DecalGunshot( &tr, iBulletType, impact.textureType, false );
+		}
+
+		EV_HLDM_BubbleTrail( vecSrc, vecEnd, (int)( ( vecEnd - Vector( vecSrc ) ).Length() / 64.0f ) );
+	}
+
+	gEngfuncs.pEventAPI->EV_PopPMStates();
+}
+
 //======================
 //	    GLOCK START
 //======================
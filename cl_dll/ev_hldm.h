@@ -20,8 +20,18 @@ enum
 	SMOKE_BLACK
 };
 
+// One pellet of a monster volley as sent in the BulletVolley message
+struct bullet_impact_t
+{
+	Vector end;
+	Vector normal;
+	int flags;
+	char textureType;
+};
+
 void EV_HLDM_GunshotDecalTrace( pmtrace_t *pTrace, char *decalName );
 void EV_HLDM_DecalGunshot(pmtrace_t *pTrace, int iBulletType, char cTextureType = 0, bool isSky = false);
 int EV_HLDM_CheckTracer( int idx, float *vecSrc, float *end, float *forward, float *right, int iBulletType, int iTracerFreq, int *tracerCount );
 void EV_HLDM_FireBullets( int idx, float *forward, float *right, float *up, int cShots, float *vecSrc, float *vecDirShooting, float flDistance, int iBulletType, int iTracerFreq, int *tracerCount, float flSpreadX, float flSpreadY );
+void EV_HLDM_BulletVolley( float *vecSrc, int iBulletType, const bullet_impact_t *pImpacts, int count );
 #endif // EV_HLDMH
@@ -244,6 +244,8 @@ cvar_t* cl_weapon_sparks = NULL;
 cvar_t* cl_weapon_wallpuff = NULL;
 
 cvar_t* cl_weather = NULL;
+cvar_t* cl_particle_batch = NULL;
+cvar_t* cl_weather_skymap = NULL;
 
 cvar_t* cl_muzzlelight = NULL;
 cvar_t* cl_muzzlelight_monsters = NULL;
@@ -661,6 +663,8 @@ void CHud::Init( void )
 	CreateBooleanCvarConditionally(cl_weapon_wallpuff, "cl_weapon_wallpuff", clientFeatures.weapon_wallpuff);
 
 	cl_weather = CVAR_CREATE( "cl_weather", "1", FCVAR_ARCHIVE );
+	cl_particle_batch = CVAR_CREATE( "cl_particle_batch", "1", FCVAR_ARCHIVE );
+	cl_weather_skymap = CVAR_CREATE( "cl_weather_skymap", "1", FCVAR_ARCHIVE );
 
 	CreateBooleanCvarConditionally(cl_muzzlelight, "cl_muzzlelight", clientFeatures.muzzlelight);
 	cl_muzzlelight_monsters = CVAR_CREATE( "cl_muzzlelight_monsters", "0", FCVAR_ARCHIVE );
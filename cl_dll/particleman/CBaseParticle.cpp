@@ -50,6 +50,7 @@ void CBaseParticle::InitializeSprite(Vector org, Vector normal, model_s* sprite,
 
 	m_flGravity = 0;
 	m_flNextCollisionTime = 0;
+	m_flUncheckedTime = 0;
 
 	m_bInPVS = true;
 
@@ -370,6 +371,21 @@ void CBaseParticle::CheckCollision(float time)
 		return;
 	}
 
+	//Time covered by the segment from the last checked origin, longer than a frame if checks were deferred.
+	const float frametime = time - g_flOldTime + m_flUncheckedTime;
+
+	if ((m_iCollisionFlags & (TRI_COLLIDEALL | TRI_COLLIDEWORLD)) != 0 || !m_bInWater)
+	{
+		//Out of traces for this frame, keep the previous origin so the next check covers the whole way.
+		if (!g_cParticleCollision.ConsumeTrace())
+		{
+			m_flUncheckedTime = frametime;
+			return;
+		}
+	}
+
+	m_flUncheckedTime = 0;
+
 	pmtrace_t trace;
 
 	bool collided = false;
@@ -414,8 +430,6 @@ void CBaseParticle::CheckCollision(float time)
 
 	if (collided)
 	{
-		const float frametime = time - g_flOldTime;
-
 		m_vOrigin = m_vPrevOrigin + m_vVelocity * (trace.fraction * frametime);
 
 		float bounce;
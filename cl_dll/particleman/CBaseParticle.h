@@ -176,4 +176,5 @@ protected:
 	Vector m_vPrevOrigin;
 
 	float m_flNextCollisionTime;
+	float m_flUncheckedTime; //Time since the last collision check, when checks were deferred
 };
@@ -14,6 +14,7 @@
 ****/
 
 #include <algorithm>
+#include <chrono>
 
 #include "hud.h"
 #include "cl_util.h"
@@ -23,14 +24,145 @@
 
 CMiniMem* CMiniMem::_instance = nullptr;
 
+CMiniMem::~CMiniMem()
+{
+	ReleasePool();
+}
+
+char* CMiniMem::AllocateBlock(std::size_t sizeInBytes)
+{
+	const std::size_t sizeClass = std::max<std::size_t>(1, (sizeInBytes + SizeClassGranularity - 1) / SizeClassGranularity);
+
+	if (sizeClass >= _freeLists.size())
+	{
+		_freeLists.resize(sizeClass + 1, nullptr);
+	}
+
+	if (nullptr == _freeLists[sizeClass])
+	{
+		const std::size_t blockSize = HeaderSize + sizeClass * SizeClassGranularity;
+		auto slab = reinterpret_cast<char*>(malloc(blockSize * BlocksPerSlab));
+
+		if (nullptr == slab)
+		{
+			return nullptr;
+		}
+
+		_slabs.push_back(slab);
+		_pooledBytes += blockSize * BlocksPerSlab;
+
+		//Thread the new blocks onto the free list so they're handed out in address order.
+		for (std::size_t i = BlocksPerSlab; i-- > 0;)
+		{
+			auto block = slab + i * blockSize;
+			auto header = reinterpret_cast<BlockHeader*>(block);
+			header->serial = 0;
+			header->sizeClass = static_cast<unsigned int>(sizeClass);
+			*reinterpret_cast<char**>(block + HeaderSize) = _freeLists[sizeClass];
+			_freeLists[sizeClass] = block;
+		}
+	}
+
+	auto block = _freeLists[sizeClass];
+	_freeLists[sizeClass] = *reinterpret_cast<char**>(block + HeaderSize);
+
+	return block;
+}
+
+void CMiniMem::FreeBlock(BlockHeader* header)
+{
+	auto block = reinterpret_cast<char*>(header);
+
+	header->serial = 0;
+	*reinterpret_cast<char**>(block + HeaderSize) = _freeLists[header->sizeClass];
+	_freeLists[header->sizeClass] = block;
+}
+
+void CMiniMem::ReleasePool()
+{
+	for (auto slab : _slabs)
+	{
+		free(slab);
+	}
+
+	_slabs.clear();
+	_slabs.shrink_to_fit();
+	_freeLists.clear();
+	_pooledBytes = 0;
+
+	_ageOrder.clear();
+	_ageOrder.shrink_to_fit();
+}
+
+void CMiniMem::RecycleOldest()
+{
+	const float time = gEngfuncs.GetClientTime();
+
+	while (!_ageOrder.empty())
+	{
+		const AgeEntry entry = _ageOrder.front();
+		_ageOrder.pop_front();
+
+		//Pool memory stays around until Reset, so the header of a removed particle can still be read.
+		if (HeaderOf(entry.particle)->serial != entry.serial)
+		{
+			continue;
+		}
+
+		//Let the next ProcessAll remove it, the particle may be the one whose Think is creating the new particle.
+		entry.particle->m_flDieTime = time;
+		++_recycledParticles;
+		return;
+	}
+}
+
+void CMiniMem::CompactAgeOrder()
+{
+	std::deque<AgeEntry> live;
+
+	for (const auto& entry : _ageOrder)
+	{
+		if (HeaderOf(entry.particle)->serial == entry.serial)
+		{
+			live.push_back(entry);
+		}
+	}
+
+	_ageOrder.swap(live);
+}
+
 void* CMiniMem::Allocate(std::size_t sizeInBytes)
 {
-	//auto particle = reinterpret_cast<CBaseParticle*>(_pool.allocate(sizeInBytes, alignment));
-	auto particle = reinterpret_cast<CBaseParticle*>(malloc(sizeInBytes));
+	if (0 != _particleLimit && _particles.size() >= _particleLimit)
+	{
+		RecycleOldest();
+	}
+
+	auto block = AllocateBlock(sizeInBytes);
+
+	if (nullptr == block)
+	{
+		return nullptr;
+	}
+
+	auto header = reinterpret_cast<BlockHeader*>(block);
+	header->index = _particles.size();
+	header->serial = _nextSerial++;
+
+	if (0 == _nextSerial)
+	{
+		_nextSerial = 1;
+	}
 
-	if (nullptr != particle)
+	auto particle = reinterpret_cast<CBaseParticle*>(block + HeaderSize);
+
+	_particles.push_back(particle);
+	_ageOrder.push_back({particle, header->serial});
+
+	//Particles rarely die in creation order, drop the entries of removed ones now and then.
+	if (_ageOrder.size() > 2 * _particles.size() + BlocksPerSlab)
 	{
-		_particles.push_back(particle);
+		CompactAgeOrder();
 	}
 
 	return particle;
@@ -43,14 +175,28 @@ void CMiniMem::Deallocate(void* memory)
 		return;
 	}
 
-	auto it = std::find(_particles.begin(), _particles.end(), memory);
-	if (it != _particles.end())
-		_particles.erase(it);
+	auto header = HeaderOf(memory);
+	const std::size_t index = header->index;
+
+	if (index < _particles.size() && _particles[index] == memory)
+	{
+		if (_processing)
+		{
+			//ProcessAll compacts the list once it's done walking it.
+			_particles[index] = nullptr;
+		}
+		else
+		{
+			auto last = _particles.back();
+			_particles[index] = last;
+			HeaderOf(last)->index = index;
+			_particles.pop_back();
+		}
+	}
 	else
 		gEngfuncs.Con_Printf("Couldn't find a particle in the particles array to erase!\n");
 
-	free(memory);
-	//_pool.deallocate(memory, sizeInBytes, alignment);
+	FreeBlock(header);
 }
 
 void CMiniMem::Shutdown()
@@ -69,23 +215,106 @@ CMiniMem* CMiniMem::Instance()
 	return _instance;
 }
 
+static float MillisecondsSince(std::chrono::steady_clock::time_point start)
+{
+	return std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+void CMiniMem::SetParticleLimit(std::size_t limit)
+{
+	_particleLimit = limit;
+
+	for (auto& batch : _batches)
+	{
+		batch.SetParticleLimit(limit);
+	}
+}
+
+std::size_t CMiniMem::GetRecycledParticles()
+{
+	std::size_t recycled = _recycledParticles;
+
+	for (const auto& batch : _batches)
+	{
+		recycled += batch.GetRecycledParticles();
+	}
+
+	return recycled;
+}
+
+std::size_t CMiniMem::GetBatchedParticles()
+{
+	std::size_t count = 0;
+
+	for (const auto& batch : _batches)
+	{
+		count += batch.Count();
+	}
+
+	return count;
+}
+
 void CMiniMem::ProcessAll()
 {
 	const float time = gEngfuncs.GetClientTime();
+	const bool paused = IsGamePaused();
+
+	auto stageStart = std::chrono::steady_clock::now();
 
 	//Clear list of visible particles.
 	_visibleParticles = 0;
 
-	//Divide the particle list in two: the list of visible particles and the list of invisible particles.
-	//Remove any particles that have died.
-	std::size_t invisibleCount = 0;
+	auto player = gEngfuncs.GetLocalPlayer();
+	const Vector viewOrigin = player->origin;
+
+	//Remove any particles that have died. Removed particles leave a null behind until the list is compacted below.
+	_processing = true;
+	_visibleFlags.clear();
+
+	//Start thinking where the collision trace budget ran out last frame, so every particle gets its turn.
+	//Particles created while thinking are appended and processed in the same frame.
+	const std::size_t existingCount = _particles.size();
+	const std::size_t thinkStart = existingCount > 0 ? _thinkStart % existingCount : 0;
+	_thinkStart = 0;
+
+	//The particle list and each batch get a share of the trace budget in proportion to their size,
+	//so a crowded consumer can't starve the others.
+	std::size_t collisionCount = existingCount;
+
+	for (const auto& batch : _batches)
+	{
+		collisionCount += batch.Count();
+	}
+
+	g_cParticleCollision.ShareBudget(collisionCount);
+	g_cParticleCollision.BeginConsumer(existingCount);
+
+	bool budgetExhausted = false;
 
-	for (std::size_t i = 0; i < (_particles.size() - invisibleCount);)
+	for (std::size_t n = 0; n < _particles.size(); ++n)
 	{
+		const std::size_t i = n < existingCount ? (thinkStart + n) % existingCount : n;
+
+		if (_visibleFlags.size() < _particles.size())
+		{
+			_visibleFlags.resize(_particles.size(), 0);
+		}
+
 		auto effect = _particles[i];
 
-		if (!IsGamePaused())
+		if (!effect)
 		{
+			continue;
+		}
+
+		if (!paused)
+		{
+			if (!budgetExhausted && n < existingCount && g_cParticleCollision.IsBudgetExhausted())
+			{
+				budgetExhausted = true;
+				_thinkStart = i;
+			}
+
 			effect->Think(time);
 		}
 
@@ -93,50 +322,108 @@ void CMiniMem::ProcessAll()
 		{
 			effect->Die();
 			delete effect;
-
-			//Don't do this! operator delete removes the effect from the list.
-			//_particles.erase(_particles.begin() + i);
 			continue;
 		}
 
 		if (effect->CheckVisibility())
 		{
-			auto player = gEngfuncs.GetLocalPlayer();
-			effect->SetPlayerDistance((player->origin - effect->m_vOrigin).Length()*(player->origin - effect->m_vOrigin).Length());
+			const Vector delta = viewOrigin - effect->m_vOrigin;
+			effect->SetPlayerDistance(DotProduct(delta, delta));
 
-			++_visibleParticles;
+			_visibleFlags[i] = 1;
+		}
+	}
+
+	_processing = false;
+
+	for (auto& batch : _batches)
+	{
+		g_cParticleCollision.BeginConsumer(batch.Count());
+		batch.Simulate(time, g_flOldTime, paused);
+	}
+
+	_simulateTime = MillisecondsSince(stageStart);
+	stageStart = std::chrono::steady_clock::now();
+
+	//Divide the particle list in two: the list of visible particles and the list of invisible particles.
+	std::size_t visibleCount = 0;
+	_invisibleScratch.clear();
+
+	for (std::size_t i = 0; i < _particles.size(); ++i)
+	{
+		auto effect = _particles[i];
+
+		if (!effect)
+		{
+			continue;
+		}
+
+		if (i < _visibleFlags.size() && 0 != _visibleFlags[i])
+		{
+			_particles[visibleCount++] = effect;
 		}
 		else
 		{
-			if (i + invisibleCount < _particles.size())
-			{
-				//There is an effect we haven't checked yet.
-				//Put the invisible effect at the end of the list and check the other effect next.
-				std::swap(_particles[i], _particles[_particles.size() - 1 - invisibleCount]);
-				++invisibleCount;
-				continue;
-			}
-			//No more unchecked effects in the list.
+			_invisibleScratch.push_back(effect);
 		}
+	}
+
+	std::copy(_invisibleScratch.begin(), _invisibleScratch.end(), _particles.begin() + visibleCount);
+	_particles.resize(visibleCount + _invisibleScratch.size());
+	_visibleParticles = visibleCount;
+
+	for (std::size_t i = 0; i < _particles.size(); ++i)
+	{
+		HeaderOf(_particles[i])->index = i;
+	}
+
+	_drawOrder.clear();
+
+	for (std::size_t i = 0; i < _visibleParticles; ++i)
+	{
+		_drawOrder.push_back({_particles[i]->GetPlayerDistance(), -1, static_cast<int>(i)});
+	}
 
-		++i;
+	for (int i = 0; i < CParticleBatch::KindCount; ++i)
+	{
+		_batches[i].CollectVisible(time, viewOrigin, i, _drawOrder);
 	}
 
-	std::sort(_particles.begin(), _particles.begin() + _visibleParticles, [](const CBaseParticle* lhs, const CBaseParticle* rhs)
+	_visibleBatchedParticles = _drawOrder.size() - _visibleParticles;
+
+	std::sort(_drawOrder.begin(), _drawOrder.end(), [](const ParticleDrawItem& lhs, const ParticleDrawItem& rhs)
 		{
 			//Particles are ordered farthest to nearest so they can be drawn in order.
-			const float lhsDistance = lhs->GetPlayerDistance();
-			const float rhsDistance = rhs->GetPlayerDistance();
-
-			return lhsDistance > rhsDistance;
+			return lhs.distanceSquared > rhs.distanceSquared;
 		});
 
-	for (std::size_t i = 0; i < _visibleParticles; ++i)
+	_sortTime = MillisecondsSince(stageStart);
+	stageStart = std::chrono::steady_clock::now();
+
+	CParticleBatch::DrawContext context;
+
+	if (0 != _visibleBatchedParticles)
 	{
-		auto effect = _particles[i];
-		effect->Draw();
+		Vector forward, up;
+		gEngfuncs.GetViewAngles(context.viewAngles);
+		gEngfuncs.pfnAngleVectors(context.viewAngles, forward, context.viewRight, up);
+		gEngfuncs.pfnAngleVectors(g_vViewAngles, forward, context.facePlayerRight, context.facePlayerUp);
 	}
 
+	for (const auto& item : _drawOrder)
+	{
+		if (item.batch < 0)
+		{
+			_particles[item.index]->Draw();
+		}
+		else
+		{
+			_batches[item.batch].Draw(item.index, context);
+		}
+	}
+
+	_drawTime = MillisecondsSince(stageStart);
+
 	g_flOldTime = time;
 }
 
@@ -230,7 +517,20 @@ void CMiniMem::Reset()
 		_particles.clear();
 	}
 
+	for (auto& batch : _batches)
+	{
+		batch.Clear();
+	}
+
+	_drawOrder.clear();
+	_drawOrder.shrink_to_fit();
+	_visibleBatchedParticles = 0;
+
 	//Wipe away previously allocated memory so maps with loads of particles don't eat up memory forever.
-	//_pool.release();
+	ReleasePool();
 	_particles.shrink_to_fit();
+	_visibleFlags.clear();
+	_visibleFlags.shrink_to_fit();
+	_invisibleScratch.clear();
+	_invisibleScratch.shrink_to_fit();
 }
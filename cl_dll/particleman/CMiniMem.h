@@ -3,27 +3,92 @@
 #define MINIMEM_H
 
 #include <cstddef>
+#include <deque>
 #include <vector>
 
+#include "CParticleBatch.h"
+
 class CBaseParticle;
 
 #define TRIANGLE_FPS 30
 
 /**
 *	@brief Simple allocator that uses a chunk-based pool to serve requests.
+*	Particles are carved out of slabs per size class and recycled through free lists.
+*	Every block starts with a header holding the particle's position in the particle list,
+*	so removing a particle is a swap with the last one instead of a search.
 */
 class CMiniMem
 {
 private:
 	static CMiniMem* _instance;
 
+	struct BlockHeader
+	{
+		std::size_t index;	   //Position in _particles
+		unsigned int serial;   //Creation order, 0 while the block is free
+		unsigned int sizeClass;
+	};
+
+	static constexpr std::size_t HeaderSize = 16;
+	static constexpr std::size_t SizeClassGranularity = 16;
+	static constexpr std::size_t BlocksPerSlab = 256;
+
+	static_assert(sizeof(BlockHeader) <= HeaderSize, "Particle block header doesn't fit");
+
+	struct AgeEntry
+	{
+		CBaseParticle* particle;
+		unsigned int serial;
+	};
+
 	std::vector<CBaseParticle*> _particles;
 	std::size_t _visibleParticles = 0;
 
+	std::vector<char*> _freeLists; //Indexed by size class
+	std::vector<char*> _slabs;
+	std::size_t _pooledBytes = 0;
+
+	//Particles in creation order, entries of removed particles are skipped lazily.
+	std::deque<AgeEntry> _ageOrder;
+	unsigned int _nextSerial = 1;
+	std::size_t _particleLimit = 0;
+	std::size_t _recycledParticles = 0;
+
+	//Removal is deferred while ProcessAll walks the list.
+	bool _processing = false;
+	std::vector<unsigned char> _visibleFlags;
+	std::size_t _thinkStart = 0; //First particle whose collision check was deferred last frame
+	std::vector<CBaseParticle*> _invisibleScratch;
+
+	//Weather particles simulated as structures of arrays, drawn together with the others.
+	CParticleBatch _batches[CParticleBatch::KindCount]{
+		CParticleBatch{CParticleBatch::Raindrop},
+		CParticleBatch{CParticleBatch::WindPuff},
+		CParticleBatch{CParticleBatch::Snowflake}};
+	std::vector<ParticleDrawItem> _drawOrder;
+	std::size_t _visibleBatchedParticles = 0;
+
+	//Duration of the last frame's stages in milliseconds.
+	float _simulateTime = 0;
+	float _sortTime = 0;
+	float _drawTime = 0;
+
+	static BlockHeader* HeaderOf(void* memory)
+	{
+		return reinterpret_cast<BlockHeader*>(static_cast<char*>(memory) - HeaderSize);
+	}
+
+	char* AllocateBlock(std::size_t sizeInBytes);
+	void FreeBlock(BlockHeader* header);
+	void RecycleOldest();
+	void CompactAgeOrder();
+	void ReleasePool();
+
 protected:
 	// private constructor and destructor.
 	CMiniMem() = default;
-	~CMiniMem() = default;
+	~CMiniMem();
 
 public:
 	void* Allocate(std::size_t sizeInBytes);
@@ -40,7 +105,23 @@ public:
 
 	static CMiniMem* Instance();
 
+	/**
+	*	@brief Caps the number of live particles, 0 means no limit.
+	*	Once the limit is reached the oldest particles are expired to make room for new ones.
+	*/
+	void SetParticleLimit(std::size_t limit);
+
+	CParticleBatch& GetBatch(CParticleBatch::Kind kind) { return _batches[kind]; }
+
 	std::size_t GetTotalParticles() { return _particles.size(); }
 	std::size_t GetDrawnParticles() { return _visibleParticles; }
+	std::size_t GetRecycledParticles();
+	std::size_t GetPooledBytes() { return _pooledBytes; }
+	std::size_t GetBatchedParticles();
+	std::size_t GetDrawnBatchedParticles() { return _visibleBatchedParticles; }
+
+	float GetSimulateTime() { return _simulateTime; }
+	float GetSortTime() { return _sortTime; }
+	float GetDrawTime() { return _drawTime; }
 };
 #endif
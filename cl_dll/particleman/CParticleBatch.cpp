@@ -0,0 +1,685 @@
+#include <algorithm>
+#include <cmath>
+
+#include "hud.h"
+#include "cl_util.h"
+
+#include "event_api.h"
+#include "triangleapi.h"
+
+#include "particleman.h"
+#include "particleman_internal.h"
+#include "CParticleBatch.h"
+#include "CParticleCollision.h"
+
+#include "pm_defs.h"
+#include "pmtrace.h"
+
+#include "pi_constant.h"
+
+constexpr float RaindropMaxBrightness = 155.0f;
+constexpr float RaindropBrightnessStep = 6.5f;
+constexpr float SnowflakeBrightnessStep = 4.5f;
+constexpr float WindPuffScaleSpeed = 0.4f;
+constexpr float WindPuffMaxBrightness = 105.0f;
+constexpr float WindPuffFadeOutTime = 3.0f;
+constexpr float SnowflakeMeltTime = 0.5f;
+constexpr float PVSCheckInterval = 0.1f;
+
+CParticleBatch::ImpactCallback CParticleBatch::_impactCallback = nullptr;
+
+CParticleBatch::CParticleBatch(Kind kind)
+	: _kind(kind)
+{
+}
+
+void CParticleBatch::Add(const SpawnParams& params)
+{
+	const float time = gEngfuncs.GetClientTime();
+
+	//Particles are kept in creation order, so the oldest ones are at the front.
+	if (0 != _particleLimit && Count() >= _particleLimit)
+	{
+		while (_recycleCursor < Count() && 0 != _dieTime[_recycleCursor] && _dieTime[_recycleCursor] <= time)
+		{
+			++_recycleCursor;
+		}
+
+		if (_recycleCursor < Count())
+		{
+			_dieTime[_recycleCursor++] = time;
+			++_recycledParticles;
+		}
+	}
+
+	_posX.push_back(params.origin.x);
+	_posY.push_back(params.origin.y);
+	_posZ.push_back(params.origin.z);
+	_prevX.push_back(params.origin.x);
+	_prevY.push_back(params.origin.y);
+	_prevZ.push_back(params.origin.z);
+	_velX.push_back(params.velocity.x);
+	_velY.push_back(params.velocity.y);
+	_velZ.push_back(params.velocity.z);
+	_size.push_back(params.size);
+	_originalSize.push_back(params.size);
+	_brightness.push_back(params.brightness);
+	_originalBrightness.push_back(params.brightness);
+	_timeCreated.push_back(time);
+	_dieTime.push_back(params.dieTime);
+	_distanceSquared.push_back(0);
+
+	_nextPVSCheck.push_back(time);
+	_inPVS.push_back(1);
+	_collisionFlags.push_back(params.collisionFlags);
+	_bounceFactor.push_back(params.bounceFactor);
+	_touched.push_back(0);
+	_inWater.push_back(0);
+	_uncheckedTime.push_back(0);
+	_targetBrightness.push_back(params.targetBrightness);
+	_spiral.push_back(params.spiral ? 1 : 0);
+	_spiralTime.push_back(params.spiralTime);
+	_spiralPhase.push_back(Com_RandomFloat(0, 2 * M_PI_F));
+	_impactId.push_back(params.impactId);
+
+	_sprite.push_back(params.sprite);
+	_stretchY.push_back(params.stretchY);
+	_colorR.push_back(params.color.x);
+	_colorG.push_back(params.color.y);
+	_colorB.push_back(params.color.z);
+	_renderMode.push_back(params.renderMode);
+	_lightFlag.push_back(params.lightFlag);
+}
+
+void CParticleBatch::Simulate(float time, float oldTime, bool paused)
+{
+	const std::size_t count = Count();
+
+	if (!paused && 0 != count)
+	{
+		const float deltaTime = time - oldTime;
+
+		float* const brightness = _brightness.data();
+		float* const size = _size.data();
+		const float* const originalSize = _originalSize.data();
+		const float* const timeCreated = _timeCreated.data();
+		float* const dieTime = _dieTime.data();
+
+		switch (_kind)
+		{
+		case Raindrop:
+			for (std::size_t i = 0; i < count; ++i)
+			{
+				brightness[i] = brightness[i] < RaindropMaxBrightness ? brightness[i] + RaindropBrightnessStep : brightness[i];
+			}
+			break;
+
+		case WindPuff:
+			for (std::size_t i = 0; i < count; ++i)
+			{
+				const float age = time - timeCreated[i];
+
+				if (dieTime[i] - time <= WindPuffFadeOutTime)
+				{
+					if (brightness[i] > 0)
+					{
+						brightness[i] -= age * 0.4f;
+					}
+
+					if (brightness[i] < 0)
+					{
+						brightness[i] = 0;
+						dieTime[i] = time;
+					}
+				}
+				else if (brightness[i] < WindPuffMaxBrightness)
+				{
+					brightness[i] += age * 5.0f + 4.0f;
+				}
+			}
+
+			//Wind puffs keep expanding over their lifetime.
+			for (std::size_t i = 0; i < count; ++i)
+			{
+				size[i] = WindPuffScaleSpeed * 30.0f * (time - timeCreated[i]) + originalSize[i];
+			}
+			break;
+
+		case Snowflake:
+			{
+				const float* const targetBrightness = _targetBrightness.data();
+				const unsigned char* const touched = _touched.data();
+
+				for (std::size_t i = 0; i < count; ++i)
+				{
+					float value = brightness[i];
+
+					if (value < targetBrightness[i] && 0 == touched[i])
+					{
+						value += SnowflakeBrightnessStep;
+					}
+
+					brightness[i] = value > 255.0f ? 255.0f : value;
+				}
+
+				//Snowflakes that touched something fade out until they die.
+				const float* const originalBrightness = _originalBrightness.data();
+
+				for (std::size_t i = 0; i < count; ++i)
+				{
+					if (0 != touched[i])
+					{
+						brightness[i] = (1.0f - (time - timeCreated[i]) / (dieTime[i] - timeCreated[i])) * originalBrightness[i];
+
+						if (brightness[i] < 1)
+						{
+							dieTime[i] = time;
+						}
+					}
+				}
+
+				for (std::size_t i = 0; i < count; ++i)
+				{
+					if (_spiralTime[i] <= time)
+					{
+						_spiral[i] = !_spiral[i];
+						_spiralTime[i] = time + Com_RandomLong(2, 4);
+					}
+				}
+			}
+			break;
+
+		default:
+			break;
+		}
+
+		{
+			float* const posX = _posX.data();
+			float* const posY = _posY.data();
+			float* const posZ = _posZ.data();
+			const float* const velX = _velX.data();
+			const float* const velY = _velY.data();
+			const float* const velZ = _velZ.data();
+
+			//None of the weather particles are affected by gravity.
+			for (std::size_t i = 0; i < count; ++i)
+			{
+				posX[i] += velX[i] * deltaTime;
+				posY[i] += velY[i] * deltaTime;
+				posZ[i] += velZ[i] * deltaTime;
+			}
+
+			if (Snowflake == _kind)
+			{
+				for (std::size_t i = 0; i < count; ++i)
+				{
+					if (0 != _spiral[i] && 0 == _touched[i])
+					{
+						const float spin = std::sin(time * 5.0f + _spiralPhase[i]);
+						posX[i] += spin * spin * 0.3f;
+					}
+				}
+			}
+		}
+
+		//Start where the trace budget ran out last frame, so every particle gets its turn.
+		std::size_t firstDeferred = count;
+
+		for (std::size_t n = 0; n < count; ++n)
+		{
+			const std::size_t i = (_collisionCursor + n) % count;
+
+			if (0 != _collisionFlags[i] && !CheckCollision(i, time, deltaTime) && firstDeferred == count)
+			{
+				firstDeferred = i;
+			}
+		}
+
+		_collisionCursor = firstDeferred != count ? firstDeferred : 0;
+	}
+
+	RemoveDead(time);
+}
+
+bool CParticleBatch::CheckCollision(std::size_t index, float time, float frameTime)
+{
+	const int flags = _collisionFlags[index];
+
+	if ((flags & (TRI_WATERTRACE | TRI_COLLIDEALL | TRI_COLLIDEWORLD)) == 0)
+	{
+		return true;
+	}
+
+	Vector origin{_posX[index], _posY[index], _posZ[index]};
+	Vector prevOrigin{_prevX[index], _prevY[index], _prevZ[index]};
+	Vector velocity{_velX[index], _velY[index], _velZ[index]};
+
+	//Time covered by the segment from the last checked origin, longer than a frame if checks were deferred.
+	const float segmentTime = frameTime + _uncheckedTime[index];
+
+	const bool worldOnly = (flags & TRI_COLLIDEALL) == 0;
+
+	//Falling rain and snow can ask the ground grid instead of tracing.
+	const CParticleCollision::Column* column = nullptr;
+
+	if (worldOnly && (Raindrop == _kind || Snowflake == _kind) && velocity.z < 0 && g_cParticleCollision.UseGrid())
+	{
+		if (g_cParticleCollision.QueryColumn(prevOrigin, origin, column) == CParticleCollision::ColumnDeferred)
+		{
+			_uncheckedTime[index] = segmentTime;
+			return false;
+		}
+	}
+
+	float fraction = 1;
+	Vector endPos = origin;
+	Vector normal{0, 0, 1};
+
+	bool inWater = false;
+
+	if (column)
+	{
+		if ((flags & (TRI_COLLIDEALL | TRI_COLLIDEWORLD)) != 0 && origin.z <= column->groundZ)
+		{
+			const float height = prevOrigin.z - origin.z;
+
+			fraction = height > 0 ? std::max(0.0f, prevOrigin.z - column->groundZ) / height : 0;
+			endPos = prevOrigin + (origin - prevOrigin) * fraction;
+			normal = column->normal;
+		}
+
+		inWater = origin.z <= column->waterZ;
+	}
+	else
+	{
+		if ((flags & (TRI_COLLIDEALL | TRI_COLLIDEWORLD)) != 0)
+		{
+			if (!g_cParticleCollision.ConsumeTrace())
+			{
+				_uncheckedTime[index] = segmentTime;
+				return false;
+			}
+
+			pmtrace_t trace;
+
+			gEngfuncs.pEventAPI->EV_SetTraceHull(2);
+			gEngfuncs.pEventAPI->EV_PlayerTrace(prevOrigin, origin, worldOnly ? (PM_WORLD_ONLY | PM_STUDIO_BOX) : PM_STUDIO_BOX, -1, &trace);
+
+			//Collided with something other than world, ignore.
+			if (trace.fraction != 1.0 && (worldOnly || 0 == trace.ent))
+			{
+				fraction = trace.fraction;
+				endPos = trace.endpos;
+				normal = trace.plane.normal;
+			}
+		}
+
+		if (fraction == 1 && (flags & TRI_WATERTRACE) != 0 && 0 == _inWater[index])
+		{
+			inWater = gEngfuncs.PM_PointContents(origin, nullptr) == CONTENTS_WATER;
+		}
+	}
+
+	_uncheckedTime[index] = 0;
+
+	if (fraction != 1)
+	{
+		if (worldOnly)
+		{
+			velocity = velocity * 0.6;
+
+			if (velocity.Length() < 10)
+			{
+				_collisionFlags[index] = 0;
+				velocity = Vector(0, 0, 0);
+				origin = endPos;
+			}
+		}
+
+		origin = prevOrigin + velocity * (fraction * segmentTime);
+
+		float bounce = 0;
+
+		bool dead = false;
+
+		//Weather particles have no gravity, so any vertical velocity means they didn't come to rest.
+		if (normal.z <= 0.9 || velocity.z != 0)
+		{
+			if ((flags & TRI_COLLIDEKILL) != 0)
+			{
+				_dieTime[index] = time;
+				dead = true;
+			}
+			else
+			{
+				bounce = _bounceFactor[index] * 0.5f;
+
+				if (bounce != 0)
+				{
+					const float dot = DotProduct(normal, velocity) * -2;
+					velocity = velocity + normal * dot;
+				}
+			}
+		}
+		else
+		{
+			//Particle fell on an (almost) flat surface and has no velocity to bounce back up; disable collisions from now on.
+			velocity = Vector(0, 0, 0);
+			_collisionFlags[index] = 0;
+		}
+
+		if (!dead && bounce != 1)
+		{
+			velocity = velocity * bounce;
+		}
+
+		_posX[index] = origin.x;
+		_posY[index] = origin.y;
+		_posZ[index] = origin.z;
+		_velX[index] = velocity.x;
+		_velY[index] = velocity.y;
+		_velZ[index] = velocity.z;
+
+		Touch(index, time, normal);
+	}
+	else
+	{
+		_posX[index] = origin.x;
+		_posY[index] = origin.y;
+		_posZ[index] = origin.z;
+		_velX[index] = velocity.x;
+		_velY[index] = velocity.y;
+		_velZ[index] = velocity.z;
+
+		if ((flags & TRI_WATERTRACE) != 0 && 0 == _inWater[index] && inWater)
+		{
+			Touch(index, time, Vector(0, 0, 1));
+
+			_inWater[index] = 1;
+
+			if ((flags & TRI_COLLIDEKILL) != 0)
+			{
+				_dieTime[index] = time;
+			}
+		}
+	}
+
+	_prevX[index] = _posX[index];
+	_prevY[index] = _posY[index];
+	_prevZ[index] = _posZ[index];
+
+	return true;
+}
+
+void CParticleBatch::Touch(std::size_t index, float time, const Vector& normal)
+{
+	if (0 != _touched[index])
+	{
+		return;
+	}
+
+	_touched[index] = 1;
+
+	switch (_kind)
+	{
+	case Raindrop:
+		if (_impactCallback)
+		{
+			_impactCallback(_impactId[index], Vector(_posX[index], _posY[index], _posZ[index]), normal);
+		}
+		break;
+
+	case Snowflake:
+		//Stick to the surface and melt away.
+		_originalBrightness[index] = _brightness[index];
+		_velX[index] = _velY[index] = _velZ[index] = 0;
+		_dieTime[index] = time + SnowflakeMeltTime;
+		_timeCreated[index] = time;
+		break;
+
+	default:
+		break;
+	}
+}
+
+template<typename T>
+void CParticleBatch::Compact(std::vector<T>& values, const std::vector<unsigned int>& survivors)
+{
+	for (std::size_t i = 0; i < survivors.size(); ++i)
+	{
+		values[i] = values[survivors[i]];
+	}
+
+	values.resize(survivors.size());
+}
+
+void CParticleBatch::RemoveDead(float time)
+{
+	const std::size_t count = Count();
+
+	_survivors.clear();
+
+	for (std::size_t i = 0; i < count; ++i)
+	{
+		if (0 == _dieTime[i] || time < _dieTime[i])
+		{
+			_survivors.push_back(static_cast<unsigned int>(i));
+		}
+	}
+
+	if (_survivors.size() == count)
+	{
+		return;
+	}
+
+	Compact(_posX, _survivors);
+	Compact(_posY, _survivors);
+	Compact(_posZ, _survivors);
+	Compact(_prevX, _survivors);
+	Compact(_prevY, _survivors);
+	Compact(_prevZ, _survivors);
+	Compact(_velX, _survivors);
+	Compact(_velY, _survivors);
+	Compact(_velZ, _survivors);
+	Compact(_size, _survivors);
+	Compact(_originalSize, _survivors);
+	Compact(_brightness, _survivors);
+	Compact(_originalBrightness, _survivors);
+	Compact(_timeCreated, _survivors);
+	Compact(_dieTime, _survivors);
+	Compact(_distanceSquared, _survivors);
+
+	Compact(_nextPVSCheck, _survivors);
+	Compact(_inPVS, _survivors);
+	Compact(_collisionFlags, _survivors);
+	Compact(_bounceFactor, _survivors);
+	Compact(_touched, _survivors);
+	Compact(_inWater, _survivors);
+	Compact(_uncheckedTime, _survivors);
+	Compact(_targetBrightness, _survivors);
+	Compact(_spiral, _survivors);
+	Compact(_spiralTime, _survivors);
+	Compact(_spiralPhase, _survivors);
+	Compact(_impactId, _survivors);
+
+	Compact(_sprite, _survivors);
+	Compact(_stretchY, _survivors);
+	Compact(_colorR, _survivors);
+	Compact(_colorG, _survivors);
+	Compact(_colorB, _survivors);
+	Compact(_renderMode, _survivors);
+	Compact(_lightFlag, _survivors);
+
+	_recycleCursor = 0;
+}
+
+void CParticleBatch::CollectVisible(float time, const Vector& viewOrigin, int batch, std::vector<ParticleDrawItem>& items)
+{
+	const std::size_t count = Count();
+
+	//All weather particles are culled by PVS only.
+	for (std::size_t i = 0; i < count; ++i)
+	{
+		if (time >= _nextPVSCheck[i])
+		{
+			const float radius = _size[i] / 5.0f;
+			Vector mins{_posX[i] - radius, _posY[i] - radius, _posZ[i] - radius};
+			Vector maxs{_posX[i] + radius, _posY[i] + radius, _posZ[i] + radius};
+
+			_inPVS[i] = gEngfuncs.pTriAPI->BoxInPVS(mins, maxs) != 0 ? 1 : 0;
+			_nextPVSCheck[i] = time + PVSCheckInterval;
+		}
+	}
+
+	{
+		const float* const posX = _posX.data();
+		const float* const posY = _posY.data();
+		const float* const posZ = _posZ.data();
+		float* const distanceSquared = _distanceSquared.data();
+
+		for (std::size_t i = 0; i < count; ++i)
+		{
+			const float dx = viewOrigin.x - posX[i];
+			const float dy = viewOrigin.y - posY[i];
+			const float dz = viewOrigin.z - posZ[i];
+			distanceSquared[i] = dx * dx + dy * dy + dz * dz;
+		}
+	}
+
+	for (std::size_t i = 0; i < count; ++i)
+	{
+		if (0 != _inPVS[i])
+		{
+			items.push_back({_distanceSquared[i], batch, static_cast<int>(i)});
+		}
+	}
+}
+
+void CParticleBatch::Draw(int index, const DrawContext& context) const
+{
+	Vector origin{_posX[index], _posY[index], _posZ[index]};
+	const Vector color{_colorR[index], _colorG[index], _colorB[index]};
+	const int lightFlag = _lightFlag[index];
+
+	Vector resultColor;
+
+	if ((lightFlag & LIGHT_NONE) != 0)
+	{
+		resultColor = color;
+	}
+	else
+	{
+		Vector light;
+		gEngfuncs.pTriAPI->LightAtPoint(origin, light);
+
+		if ((lightFlag & LIGHT_COLOR) != 0)
+		{
+			resultColor.x = light.x * color.x / 255.0f;
+			resultColor.y = light.y * color.y / 255.0f;
+			resultColor.z = light.z * color.z / 255.0f;
+		}
+		else if ((lightFlag & LIGHT_INTENSITY) != 0)
+		{
+			const float intensity = (light.x + light.y + light.z) / 3.0f;
+			resultColor = color * (intensity / 255.0f);
+		}
+	}
+
+	resultColor.x = std::min(std::max(resultColor.x, 0.f), 255.f);
+	resultColor.y = std::min(std::max(resultColor.y, 0.f), 255.f);
+	resultColor.z = std::min(std::max(resultColor.z, 0.f), 255.f);
+
+	Vector right, up;
+
+	if (Raindrop == _kind)
+	{
+		//Raindrops lean with their velocity relative to the view.
+		const float roll = atan((_velX[index] * context.viewRight.x + _velY[index] * context.viewRight.y + _velZ[index] * context.viewRight.z) / _velZ[index]) * (180.0 / M_PI);
+
+		Vector forward;
+		gEngfuncs.pfnAngleVectors(Vector(0, context.viewAngles.y, roll), forward, right, up);
+	}
+	else
+	{
+		right = context.facePlayerRight;
+		up = context.facePlayerUp;
+	}
+
+	const float radius = _size[index];
+	const Vector width = right * radius;
+	const Vector height = up * radius * _stretchY[index];
+
+	const Vector lowLeft = origin - (width * 0.5) - (up * radius * 0.5);
+
+	const Vector lowRight = lowLeft + width;
+	const Vector topLeft = lowLeft + height;
+	const Vector topRight = lowRight + height;
+
+	gEngfuncs.pTriAPI->SpriteTexture(_sprite[index], 0);
+	gEngfuncs.pTriAPI->RenderMode(_renderMode[index]);
+	gEngfuncs.pTriAPI->CullFace(TRI_NONE);
+
+	gEngfuncs.pTriAPI->Begin(TRI_QUADS);
+	gEngfuncs.pTriAPI->Color4f(resultColor.x / 255, resultColor.y / 255, resultColor.z / 255, _brightness[index] / 255);
+
+	gEngfuncs.pTriAPI->TexCoord2f(0, 0);
+	gEngfuncs.pTriAPI->Vertex3fv(topLeft);
+
+	gEngfuncs.pTriAPI->TexCoord2f(0, 1);
+	gEngfuncs.pTriAPI->Vertex3fv(lowLeft);
+
+	gEngfuncs.pTriAPI->TexCoord2f(1, 1);
+	gEngfuncs.pTriAPI->Vertex3fv(lowRight);
+
+	gEngfuncs.pTriAPI->TexCoord2f(1, 0);
+	gEngfuncs.pTriAPI->Vertex3fv(topRight);
+
+	gEngfuncs.pTriAPI->End();
+
+	gEngfuncs.pTriAPI->RenderMode(kRenderNormal);
+	gEngfuncs.pTriAPI->CullFace(TRI_FRONT);
+}
+
+void CParticleBatch::Clear()
+{
+	_posX.clear();
+	_posY.clear();
+	_posZ.clear();
+	_prevX.clear();
+	_prevY.clear();
+	_prevZ.clear();
+	_velX.clear();
+	_velY.clear();
+	_velZ.clear();
+	_size.clear();
+	_originalSize.clear();
+	_brightness.clear();
+	_originalBrightness.clear();
+	_timeCreated.clear();
+	_dieTime.clear();
+	_distanceSquared.clear();
+
+	_nextPVSCheck.clear();
+	_inPVS.clear();
+	_collisionFlags.clear();
+	_bounceFactor.clear();
+	_touched.clear();
+	_inWater.clear();
+	_uncheckedTime.clear();
+	_targetBrightness.clear();
+	_spiral.clear();
+	_spiralTime.clear();
+	_spiralPhase.clear();
+	_impactId.clear();
+
+	_sprite.clear();
+	_stretchY.clear();
+	_colorR.clear();
+	_colorG.clear();
+	_colorB.clear();
+	_renderMode.clear();
+	_lightFlag.clear();
+
+	_recycleCursor = 0;
+	_collisionCursor = 0;
+}
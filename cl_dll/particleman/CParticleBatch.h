@@ -0,0 +1,153 @@
+#pragma once
+#ifndef PARTICLEBATCH_H
+#define PARTICLEBATCH_H
+
+#include <cstddef>
+#include <vector>
+
+struct model_s;
+
+/**
+*	@brief Entry in the per-frame draw order, shared by CBaseParticle instances and batched particles.
+*/
+struct ParticleDrawItem
+{
+	float distanceSquared;
+	int batch; //-1 for CBaseParticle instances
+	int index;
+};
+
+/**
+*	@brief Structure-of-arrays storage and simulation for the weather particles.
+*	Each batch holds one kind of particle, so the per-frame loops don't branch on the type
+*	and run over plain float arrays the compiler can vectorize with SSE2 or NEON.
+*	The simulation matches the raindrop, wind puff and snowflake classes in environment.cpp,
+*	which remain the path used when batching is disabled.
+*/
+class CParticleBatch
+{
+public:
+	enum Kind
+	{
+		Raindrop = 0,
+		WindPuff,
+		Snowflake,
+		KindCount
+	};
+
+	/**
+	*	@brief Called when a raindrop hits the world or enters water.
+	*	@param impactId Id given to the raindrop when it was added.
+	*/
+	using ImpactCallback = void (*)(int impactId, const Vector& origin, const Vector& normal);
+
+	struct SpawnParams
+	{
+		Vector origin;
+		Vector velocity;
+		model_s* sprite = nullptr;
+		float size = 0;
+		float brightness = 0;
+		float targetBrightness = 0; //Snowflakes fade in up to this brightness
+		float stretchY = 1;
+		Vector color;
+		int renderMode = 0;
+		int lightFlag = 0;
+		int collisionFlags = 0;
+		float bounceFactor = 1;
+		float dieTime = 0;
+		int impactId = -1;
+		bool spiral = false;
+		float spiralTime = 0;
+	};
+
+	struct DrawContext
+	{
+		Vector viewAngles; //Angles the raindrops are rotated by
+		Vector viewRight;
+		Vector facePlayerRight; //Basis for particles facing the player
+		Vector facePlayerUp;
+	};
+
+	explicit CParticleBatch(Kind kind);
+
+	Kind GetKind() const { return _kind; }
+	std::size_t Count() const { return _posX.size(); }
+	std::size_t GetRecycledParticles() const { return _recycledParticles; }
+
+	void SetParticleLimit(std::size_t limit) { _particleLimit = limit; }
+
+	static void SetImpactCallback(ImpactCallback callback) { _impactCallback = callback; }
+
+	void Add(const SpawnParams& params);
+
+	/**
+	*	@brief Advances all particles and removes the ones that died.
+	*/
+	void Simulate(float time, float oldTime, bool paused);
+
+	/**
+	*	@brief Appends the visible particles with their squared distance to the viewer.
+	*/
+	void CollectVisible(float time, const Vector& viewOrigin, int batch, std::vector<ParticleDrawItem>& items);
+
+	void Draw(int index, const DrawContext& context) const;
+
+	void Clear();
+
+private:
+	/**
+	*	@return false if the check was deferred because this frame's trace budget ran out.
+	*/
+	bool CheckCollision(std::size_t index, float time, float frameTime);
+	void Touch(std::size_t index, float time, const Vector& normal);
+	void RemoveDead(float time);
+
+	template<typename T>
+	static void Compact(std::vector<T>& values, const std::vector<unsigned int>& survivors);
+
+	static ImpactCallback _impactCallback;
+
+	Kind _kind;
+
+	std::size_t _particleLimit = 0;
+	std::size_t _recycleCursor = 0;
+	std::size_t _collisionCursor = 0;
+	std::size_t _recycledParticles = 0;
+
+	//Hot data touched every frame.
+	std::vector<float> _posX, _posY, _posZ;
+	std::vector<float> _prevX, _prevY, _prevZ;
+	std::vector<float> _velX, _velY, _velZ;
+	std::vector<float> _size;
+	std::vector<float> _originalSize;
+	std::vector<float> _brightness;
+	std::vector<float> _originalBrightness;
+	std::vector<float> _timeCreated;
+	std::vector<float> _dieTime;
+	std::vector<float> _distanceSquared;
+
+	//Visibility, collision and kind specific state.
+	std::vector<float> _nextPVSCheck;
+	std::vector<unsigned char> _inPVS;
+	std::vector<int> _collisionFlags;
+	std::vector<float> _bounceFactor;
+	std::vector<unsigned char> _touched;
+	std::vector<unsigned char> _inWater;
+	std::vector<float> _uncheckedTime;
+	std::vector<float> _targetBrightness;
+	std::vector<unsigned char> _spiral;
+	std::vector<float> _spiralTime;
+	std::vector<float> _spiralPhase;
+	std::vector<int> _impactId;
+
+	//Render data, only read when drawing.
+	std::vector<model_s*> _sprite;
+	std::vector<float> _stretchY;
+	std::vector<float> _colorR, _colorG, _colorB;
+	std::vector<int> _renderMode;
+	std::vector<int> _lightFlag;
+
+	std::vector<unsigned int> _survivors;
+};
+#endif
@@ -0,0 +1,196 @@
+#include <algorithm>
+#include <cmath>
+
+#include "hud.h"
+#include "cl_util.h"
+
+#include "event_api.h"
+
+#include "particleman.h"
+#include "particleman_internal.h"
+#include "CParticleCollision.h"
+
+#include "pm_defs.h"
+#include "pmtrace.h"
+
+//Columns are traced from this far above the highest particle that needed them.
+constexpr float ColumnTraceHeadroom = 256;
+constexpr float ColumnTraceDepth = 8192;
+constexpr float NoSurface = -99999;
+
+void CParticleCollision::BeginFrame(const Vector& viewOrigin, int quality, int traceBudget)
+{
+	_viewOrigin = viewOrigin;
+	_viewCellX = static_cast<int>(std::floor(viewOrigin.x / CellSize));
+	_viewCellY = static_cast<int>(std::floor(viewOrigin.y / CellSize));
+
+	_quality = quality;
+	_tracesLeft = traceBudget;
+	_consumerTracesLeft = traceBudget;
+	_unservedParticles = 0;
+
+	_tracesUsed = 0;
+	_deferredChecks = 0;
+	_gridAnswers = 0;
+	_columnsBuilt = 0;
+}
+
+void CParticleCollision::ShareBudget(std::size_t particleCount)
+{
+	_unservedParticles = particleCount;
+}
+
+void CParticleCollision::BeginConsumer(std::size_t particleCount)
+{
+	if (_unservedParticles == 0 || particleCount >= _unservedParticles)
+	{
+		_consumerTracesLeft = _tracesLeft;
+		_unservedParticles = 0;
+		return;
+	}
+
+	//Round up so a consumer with any particles gets at least one trace while the budget lasts.
+	const long long share = (static_cast<long long>(std::max(0, _tracesLeft)) * particleCount + _unservedParticles - 1) / _unservedParticles;
+
+	_consumerTracesLeft = static_cast<int>(share);
+	_unservedParticles -= particleCount;
+}
+
+bool CParticleCollision::ConsumeTrace()
+{
+	if (_quality != QualityExact)
+	{
+		if (_consumerTracesLeft <= 0)
+		{
+			++_deferredChecks;
+			return false;
+		}
+
+		--_tracesLeft;
+		--_consumerTracesLeft;
+	}
+
+	++_tracesUsed;
+	return true;
+}
+
+void CParticleCollision::BuildColumn(Column& column, int cellX, int cellY, float topZ)
+{
+	++_columnsBuilt;
+
+	column.cellX = cellX;
+	column.cellY = cellY;
+	column.built = true;
+	column.topZ = topZ;
+	column.groundZ = NoSurface;
+	column.waterZ = NoSurface;
+	column.normal = Vector(0, 0, 1);
+
+	Vector start{(cellX + 0.5f) * CellSize, (cellY + 0.5f) * CellSize, topZ};
+	Vector end{start.x, start.y, topZ - ColumnTraceDepth};
+
+	pmtrace_t trace;
+
+	gEngfuncs.pEventAPI->EV_SetTraceHull(2);
+	gEngfuncs.pEventAPI->EV_PlayerTrace(start, end, PM_WORLD_ONLY | PM_STUDIO_BOX, -1, &trace);
+
+	//Started inside a wall or outside the map, nothing can be said about this column.
+	column.usable = 0 == trace.startsolid && 0 == trace.allsolid;
+
+	if (!column.usable)
+	{
+		return;
+	}
+
+	if (trace.fraction < 1.0)
+	{
+		column.groundZ = trace.endpos[2];
+		column.normal = trace.plane.normal;
+	}
+
+	Vector point{start.x, start.y, (trace.fraction < 1.0 ? column.groundZ : end.z) + 1};
+
+	if (gEngfuncs.PM_PointContents(point, nullptr) != CONTENTS_WATER)
+	{
+		return;
+	}
+
+	//Find the water surface between the bottom and the top of the column.
+	float low = point.z;
+	float high = topZ;
+
+	if (gEngfuncs.PM_PointContents(start, nullptr) == CONTENTS_WATER)
+	{
+		column.waterZ = topZ;
+		return;
+	}
+
+	while (high - low > 2)
+	{
+		point.z = (low + high) * 0.5f;
+
+		if (gEngfuncs.PM_PointContents(point, nullptr) == CONTENTS_WATER)
+		{
+			low = point.z;
+		}
+		else
+		{
+			high = point.z;
+		}
+	}
+
+	column.waterZ = low;
+}
+
+CParticleCollision::ColumnResult CParticleCollision::QueryColumn(const Vector& prevOrigin, const Vector& origin, const Column*& column)
+{
+	const int cellX = static_cast<int>(std::floor(origin.x / CellSize));
+	const int cellY = static_cast<int>(std::floor(origin.y / CellSize));
+
+	//Cells further away would share a slot with cells closer to the viewer.
+	if (std::abs(cellX - _viewCellX) >= GridSize / 2 || std::abs(cellY - _viewCellY) >= GridSize / 2)
+	{
+		return ColumnUnknown;
+	}
+
+	//Particles moving sideways can cross into other columns, the column only describes vertical motion.
+	if (static_cast<int>(std::floor(prevOrigin.x / CellSize)) != cellX || static_cast<int>(std::floor(prevOrigin.y / CellSize)) != cellY)
+	{
+		if (fabs(prevOrigin.x - origin.x) + fabs(prevOrigin.y - origin.y) > CellSize * 0.5f)
+		{
+			return ColumnUnknown;
+		}
+	}
+
+	Column& slot = _columns[(cellX & (GridSize - 1)) + (cellY & (GridSize - 1)) * GridSize];
+
+	const float highestZ = std::max(prevOrigin.z, origin.z);
+
+	if (!slot.built || slot.cellX != cellX || slot.cellY != cellY || slot.topZ < highestZ)
+	{
+		if (!ConsumeTrace())
+		{
+			return ColumnDeferred;
+		}
+
+		BuildColumn(slot, cellX, cellY, std::max(highestZ, _viewOrigin.z) + ColumnTraceHeadroom);
+	}
+
+	//Below the surface the column found, e.g. indoors under a roof.
+	if (!slot.usable || prevOrigin.z < slot.groundZ - 1)
+	{
+		return ColumnUnknown;
+	}
+
+	++_gridAnswers;
+	column = &slot;
+	return ColumnAnswered;
+}
+
+void CParticleCollision::Reset()
+{
+	for (auto& column : _columns)
+	{
+		column.built = false;
+	}
+}
@@ -0,0 +1,96 @@
+#pragma once
+#ifndef PARTICLECOLLISION_H
+#define PARTICLECOLLISION_H
+
+/**
+*	@brief Limits the number of particle collision traces per frame and caches the ground below the viewer.
+*	Particles that don't get a trace keep their previous origin, so the next trace covers the whole way they moved.
+*	The grid stores one downward trace per column around the viewer. Columns are built on first use
+*	and addressed modulo the grid size, so moving around replaces far away columns as they're needed.
+*/
+class CParticleCollision
+{
+public:
+	enum Quality
+	{
+		QualityGrid = 0, //Falling rain and snow use the ground grid, everything else uses budgeted traces
+		QualityBudgeted, //Exact traces, limited per frame
+		QualityExact	 //Exact traces for every particle every frame
+	};
+
+	enum ColumnResult
+	{
+		ColumnDeferred = 0, //Out of budget, check again next frame
+		ColumnAnswered,		//groundZ, normal and waterZ are valid
+		ColumnUnknown		//The grid can't answer, trace instead
+	};
+
+	struct Column
+	{
+		int cellX;
+		int cellY;
+		bool built;
+		bool usable;
+		float topZ;
+		float groundZ;
+		float waterZ;
+		Vector normal;
+	};
+
+	static constexpr int GridSize = 64;
+	static constexpr float CellSize = 32;
+
+	void BeginFrame(const Vector& viewOrigin, int quality, int traceBudget);
+
+	/**
+	*	@brief Sets the number of particles of all consumers that will ask for traces this frame.
+	*/
+	void ShareBudget(std::size_t particleCount);
+
+	/**
+	*	@brief Limits the following traces to this consumer's share of what's left of the budget,
+	*	in proportion to its particle count. Traces a consumer doesn't use are left to the ones after it.
+	*/
+	void BeginConsumer(std::size_t particleCount);
+
+	/**
+	*	@brief Takes one trace from this frame's budget.
+	*	@return false if the budget ran out, the caller should try again next frame.
+	*/
+	bool ConsumeTrace();
+
+	bool IsBudgetExhausted() const { return _quality != QualityExact && _consumerTracesLeft <= 0; }
+	bool UseGrid() const { return _quality == QualityGrid; }
+
+	/**
+	*	@brief Looks up the ground below a particle moving from prevOrigin to origin.
+	*/
+	ColumnResult QueryColumn(const Vector& prevOrigin, const Vector& origin, const Column*& column);
+
+	void Reset();
+
+	int GetTracesUsed() const { return _tracesUsed; }
+	int GetDeferredChecks() const { return _deferredChecks; }
+	int GetGridAnswers() const { return _gridAnswers; }
+	int GetColumnsBuilt() const { return _columnsBuilt; }
+
+private:
+	void BuildColumn(Column& column, int cellX, int cellY, float topZ);
+
+	Column _columns[GridSize * GridSize] = {};
+
+	Vector _viewOrigin;
+	int _viewCellX = 0;
+	int _viewCellY = 0;
+
+	int _quality = QualityBudgeted;
+	int _tracesLeft = 0;
+	int _consumerTracesLeft = 0;
+	std::size_t _unservedParticles = 0;
+
+	int _tracesUsed = 0;
+	int _deferredChecks = 0;
+	int _gridAnswers = 0;
+	int _columnsBuilt = 0;
+};
+#endif
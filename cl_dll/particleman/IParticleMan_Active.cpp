@@ -13,6 +13,7 @@
 *
 ****/
 
+#include <algorithm>
 #include <vector>
 
 #include "hud.h"
@@ -24,6 +25,7 @@
 #include "IParticleMan_Active.h"
 
 CFrustum g_cFrustum;
+CParticleCollision g_cParticleCollision;
 float g_flGravity;
 float g_flOldTime;
 Vector g_vViewAngles;
@@ -31,6 +33,10 @@ Vector g_vViewAngles;
 static bool g_iRenderMode = true;
 
 static cvar_t* cl_pmanstats = nullptr;
+static cvar_t* cl_particle_max = nullptr;
+static cvar_t* cl_particle_stats = nullptr;
+static cvar_t* cl_particle_collision = nullptr;
+static cvar_t* cl_particle_trace_budget = nullptr;
 
 static std::vector<ForceMember> g_pForceList;
 
@@ -68,6 +74,11 @@ void IParticleMan_Active::SetUp(cl_enginefunc_t* pEnginefuncs)
 	//std::memcpy(&gEngfuncs, pEnginefuncs, sizeof(gEngfuncs));
 
 	cl_pmanstats = gEngfuncs.pfnRegisterVariable("cl_pmanstats", "0", 0);
+	cl_particle_max = gEngfuncs.pfnRegisterVariable("cl_particle_max", "0", FCVAR_ARCHIVE);
+	cl_particle_stats = gEngfuncs.pfnRegisterVariable("cl_particle_stats", "0", 0);
+	//0: ground grid for rain and snow, 1: exact traces within the budget, 2: exact traces for every particle.
+	cl_particle_collision = gEngfuncs.pfnRegisterVariable("cl_particle_collision", "1", FCVAR_ARCHIVE);
+	cl_particle_trace_budget = gEngfuncs.pfnRegisterVariable("cl_particle_trace_budget", "512", FCVAR_ARCHIVE);
 }
 
 CBaseParticle* IParticleMan_Active::CreateParticle(Vector org, Vector normal, model_s* sprite, float size, float brightness, const char* classname)
@@ -84,6 +95,7 @@ CBaseParticle* IParticleMan_Active::CreateParticle(Vector org, Vector normal, mo
 void IParticleMan_Active::ResetParticles()
 {
 	CMiniMem::Instance()->Reset();
+	g_cParticleCollision.Reset();
 	g_pForceList.clear();
 }
 
@@ -129,8 +141,20 @@ void IParticleMan_Active::Update()
 		memory->ApplyForce(member.m_vOrigin, member.m_vDirection, member.m_flRadius, member.m_flStrength);
 	}
 
+	if (nullptr != cl_particle_max)
+	{
+		memory->SetParticleLimit(static_cast<std::size_t>(std::max(0.f, cl_particle_max->value)));
+	}
+
 	g_cFrustum.CalculateFrustum();
 
+	{
+		const int quality = nullptr != cl_particle_collision ? static_cast<int>(cl_particle_collision->value) : CParticleCollision::QualityBudgeted;
+		const int traceBudget = nullptr != cl_particle_trace_budget ? static_cast<int>(cl_particle_trace_budget->value) : 0;
+
+		g_cParticleCollision.BeginFrame(gEngfuncs.GetLocalPlayer()->origin, quality, std::max(1, traceBudget));
+	}
+
 	memory->ProcessAll();
 
 	if (nullptr != cl_pmanstats && cl_pmanstats->value == 1)
@@ -138,5 +162,17 @@ void IParticleMan_Active::Update()
 		//TODO: engine doesn't support printing size_t, use local printf
 		gEngfuncs.Con_NPrintf(15, "Number of Particles: %d", static_cast<int>(CMiniMem::Instance()->GetTotalParticles()));
 		gEngfuncs.Con_NPrintf(16, "Particles Drawn: %d", static_cast<int>(CMiniMem::Instance()->GetDrawnParticles()));
+		gEngfuncs.Con_NPrintf(17, "Particles Recycled: %d", static_cast<int>(CMiniMem::Instance()->GetRecycledParticles()));
+		gEngfuncs.Con_NPrintf(18, "Particle Pool: %d KB", static_cast<int>(CMiniMem::Instance()->GetPooledBytes() / 1024));
+	}
+
+	if (nullptr != cl_particle_stats && cl_particle_stats->value == 1)
+	{
+		gEngfuncs.Con_NPrintf(19, "Batched Particles: %d (%d drawn)", static_cast<int>(memory->GetBatchedParticles()), static_cast<int>(memory->GetDrawnBatchedParticles()));
+		gEngfuncs.Con_NPrintf(20, "Particle Simulate: %.3f ms", memory->GetSimulateTime());
+		gEngfuncs.Con_NPrintf(21, "Particle Sort: %.3f ms", memory->GetSortTime());
+		gEngfuncs.Con_NPrintf(22, "Particle Draw: %.3f ms", memory->GetDrawTime());
+		gEngfuncs.Con_NPrintf(23, "Collision Traces: %d (%d deferred)", g_cParticleCollision.GetTracesUsed(), g_cParticleCollision.GetDeferredChecks());
+		gEngfuncs.Con_NPrintf(24, "Collision Grid: %d answers, %d columns built", g_cParticleCollision.GetGridAnswers(), g_cParticleCollision.GetColumnsBuilt());
 	}
 }
@@ -27,10 +27,12 @@
 #include <cstddef>
 
 #include "CFrustum.h"
+#include "CParticleCollision.h"
 
 constexpr std::size_t MaxForceElements = 128;
 
 extern CFrustum g_cFrustum;
+extern CParticleCollision g_cParticleCollision;
 extern float g_flGravity;
 extern float g_flOldTime;
 extern Vector g_vViewAngles;
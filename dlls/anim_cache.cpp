@@ -0,0 +1,250 @@
+#include "extdll.h"
+#include "util.h"
+#include "activity.h"
+#include "animation.h"
+#include "studio.h"
+#include "monsterevent.h"
+#include "anim_cache.h"
+
+#include <algorithm>
+#include <cctype>
+
+CAnimationCache g_AnimationCache;
+
+CAnimationCache::CAnimationCache(): _lastModel(NULL), _lastTables(NULL)
+{
+	ResetStats();
+}
+
+CAnimationCache::~CAnimationCache()
+{
+	Clear();
+}
+
+void CAnimationCache::Clear()
+{
+	for( std::map<const studiohdr_t *, ModelTables *>::iterator it = _models.begin(); it != _models.end(); ++it )
+		delete it->second;
+	_models.clear();
+	_lastModel = NULL;
+	_lastTables = NULL;
+}
+
+unsigned int CAnimationCache::HashLabel( const char *label )
+{
+	unsigned int hash = 2166136261u;
+	while( *label )
+	{
+		hash ^= (unsigned char)tolower( (unsigned char)*label++ );
+		hash *= 16777619u;
+	}
+	return hash;
+}
+
+CAnimationCache::ModelTables *CAnimationCache::Build( studiohdr_t *pstudiohdr )
+{
+	_builds++;
+
+	ModelTables *tables = new ModelTables;
+	strncpy( tables->name, pstudiohdr->name, sizeof( tables->name ) - 1 );
+	tables->name[sizeof( tables->name ) - 1] = '\0';
+	tables->length = pstudiohdr->length;
+	tables->numseq = pstudiohdr->numseq;
+	tables->activityLookups = 0;
+	tables->sequenceLookups = 0;
+	tables->eventLookups = 0;
+
+	const mstudioseqdesc_t *pseqdesc = (mstudioseqdesc_t *)( (byte *)pstudiohdr + pstudiohdr->seqindex );
+
+	// Group the sequences by activity, keeping the model order inside each group
+	std::vector<int> order( pstudiohdr->numseq );
+	for( int i = 0; i < pstudiohdr->numseq; i++ )
+		order[i] = i;
+	std::stable_sort( order.begin(), order.end(), [pseqdesc]( int a, int b ) {
+		return pseqdesc[a].activity < pseqdesc[b].activity;
+	});
+
+	tables->sequences.reserve( pstudiohdr->numseq );
+	tables->cumulativeWeights.reserve( pstudiohdr->numseq );
+	for( int i = 0; i < pstudiohdr->numseq; )
+	{
+		const int activity = pseqdesc[order[i]].activity;
+
+		ActivityRange range;
+		range.first = (int)tables->sequences.size();
+		range.count = 0;
+		range.totalWeight = 0;
+		range.heaviest = ACTIVITY_NOT_AVAILABLE;
+
+		int heaviestWeight = 0;
+		for( ; i < pstudiohdr->numseq && pseqdesc[order[i]].activity == activity; i++ )
+		{
+			const int seq = order[i];
+			const int weight = pseqdesc[seq].actweight;
+			range.totalWeight += weight;
+			range.count++;
+			tables->sequences.push_back( seq );
+			tables->cumulativeWeights.push_back( range.totalWeight );
+
+			if( weight > heaviestWeight )
+			{
+				heaviestWeight = weight;
+				range.heaviest = seq;
+			}
+		}
+		tables->activities[activity] = range;
+	}
+
+	int labelSlots = 16;
+	while( labelSlots < pstudiohdr->numseq * 2 )
+		labelSlots *= 2;
+	LabelSlot empty = { 0, -1 };
+	tables->labels.assign( labelSlots, empty );
+	for( int i = 0; i < pstudiohdr->numseq; i++ )
+	{
+		const unsigned int hash = HashLabel( pseqdesc[i].label );
+		int slot = hash & ( labelSlots - 1 );
+		while( tables->labels[slot].sequence != -1 )
+			slot = ( slot + 1 ) & ( labelSlots - 1 );
+		tables->labels[slot].hash = hash;
+		tables->labels[slot].sequence = i;
+	}
+
+	tables->eventStart.resize( pstudiohdr->numseq + 1 );
+	for( int i = 0; i < pstudiohdr->numseq; i++ )
+	{
+		tables->eventStart[i] = (int)tables->events.size();
+
+		const mstudioevent_t *pevent = (mstudioevent_t *)( (byte *)pstudiohdr + pseqdesc[i].eventindex );
+		for( int j = 0; j < pseqdesc[i].numevents; j++ )
+		{
+			// Client-side events are never sent to the server AI
+			if( pevent[j].event >= EVENT_CLIENT )
+				continue;
+
+			EventRef ref;
+			ref.frame = pevent[j].frame;
+			ref.index = j;
+			tables->events.push_back( ref );
+		}
+		std::stable_sort( tables->events.begin() + tables->eventStart[i], tables->events.end(), []( const EventRef &a, const EventRef &b ) {
+			return a.frame < b.frame;
+		});
+	}
+	tables->eventStart[pstudiohdr->numseq] = (int)tables->events.size();
+
+	return tables;
+}
+
+CAnimationCache::ModelTables *CAnimationCache::Tables( studiohdr_t *pstudiohdr )
+{
+	ModelTables *tables;
+	if( pstudiohdr == _lastModel )
+	{
+		tables = _lastTables;
+	}
+	else
+	{
+		std::map<const studiohdr_t *, ModelTables *>::iterator it = _models.find( pstudiohdr );
+		if( it == _models.end() )
+			it = _models.insert( std::make_pair( (const studiohdr_t *)pstudiohdr, Build( pstudiohdr ) ) ).first;
+		tables = it->second;
+	}
+
+	// A model loaded at the same address after a cache flush was missed
+	if( tables->length != pstudiohdr->length || tables->numseq != pstudiohdr->numseq )
+	{
+		delete tables;
+		tables = Build( pstudiohdr );
+		_models[pstudiohdr] = tables;
+	}
+
+	_lastModel = pstudiohdr;
+	_lastTables = tables;
+	return tables;
+}
+
+const CAnimationCache::ActivityRange *CAnimationCache::FindActivity( ModelTables *tables, int activity )
+{
+	tables->activityLookups++;
+	std::map<int, ActivityRange>::const_iterator it = tables->activities.find( activity );
+	if( it == tables->activities.end() )
+		return NULL;
+	return &it->second;
+}
+
+int CAnimationCache::LookupActivity( studiohdr_t *pstudiohdr, int activity )
+{
+	ModelTables *tables = Tables( pstudiohdr );
+	const ActivityRange *range = FindActivity( tables, activity );
+	if( !range )
+		return ACTIVITY_NOT_AVAILABLE;
+
+	// Without weights the linear search ended up with the last sequence of the activity
+	if( range->totalWeight <= 0 )
+		return tables->sequences[range->first + range->count - 1];
+
+	const int pick = RANDOM_LONG( 0, range->totalWeight - 1 );
+	const int *first = &tables->cumulativeWeights[range->first];
+	const int *found = std::upper_bound( first, first + range->count, pick );
+	return tables->sequences[range->first + ( found - first )];
+}
+
+int CAnimationCache::LookupActivityHeaviest( studiohdr_t *pstudiohdr, int activity )
+{
+	const ActivityRange *range = FindActivity( Tables( pstudiohdr ), activity );
+	return range ? range->heaviest : ACTIVITY_NOT_AVAILABLE;
+}
+
+int CAnimationCache::LookupSequence( studiohdr_t *pstudiohdr, const char *label )
+{
+	ModelTables *tables = Tables( pstudiohdr );
+	tables->sequenceLookups++;
+
+	const mstudioseqdesc_t *pseqdesc = (mstudioseqdesc_t *)( (byte *)pstudiohdr + pstudiohdr->seqindex );
+	const unsigned int hash = HashLabel( label );
+	const int mask = (int)tables->labels.size() - 1;
+	for( int slot = hash & mask; tables->labels[slot].sequence != -1; slot = ( slot + 1 ) & mask )
+	{
+		const LabelSlot &entry = tables->labels[slot];
+		if( entry.hash == hash && stricmp( pseqdesc[entry.sequence].label, label ) == 0 )
+			return entry.sequence;
+	}
+	return -1;
+}
+
+int CAnimationCache::SequenceEvents( studiohdr_t *pstudiohdr, int sequence, const EventRef *&events )
+{
+	ModelTables *tables = Tables( pstudiohdr );
+	tables->eventLookups++;
+
+	const int first = tables->eventStart[sequence];
+	const int count = tables->eventStart[sequence + 1] - first;
+	events = count ? &tables->events[first] : NULL;
+	return count;
+}
+
+void CAnimationCache::ReportStats()
+{
+	ALERT( at_console, "Animation tables built: %u, models cached: %d\n", _builds, (int)_models.size() );
+	for( std::map<const studiohdr_t *, ModelTables *>::const_iterator it = _models.begin(); it != _models.end(); ++it )
+	{
+		const ModelTables *tables = it->second;
+		ALERT( at_console, "%s: %d sequences, %d activities, %u activity lookups, %u sequence lookups, %u event lookups\n",
+			tables->name, tables->numseq, (int)tables->activities.size(), tables->activityLookups, tables->sequenceLookups, tables->eventLookups );
+	}
+}
+
+void CAnimationCache::ResetStats()
+{
+	_builds = 0;
+	for( std::map<const studiohdr_t *, ModelTables *>::iterator it = _models.begin(); it != _models.end(); ++it )
+		it->second->activityLookups = it->second->sequenceLookups = it->second->eventLookups = 0;
+}
+
+void DumpAnimationCache()
+{
+	g_AnimationCache.ReportStats();
+	if( CMD_ARGC() > 1 && FStrEq( CMD_ARGV( 1 ), "reset" ) )
+		g_AnimationCache.ResetStats();
+}
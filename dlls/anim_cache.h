@@ -0,0 +1,90 @@
+#pragma once
+#ifndef ANIM_CACHE_H
+#define ANIM_CACHE_H
+
+#include <map>
+#include <vector>
+
+#include "studio.h"
+
+// Per model lookup tables for activities and sequence names, built on the first lookup.
+// Sequences of each activity are kept with cumulative weights, so a weighted pick is a single random number and a binary search.
+// Sequence labels are hashed case insensitively, the first sequence with a given label wins like in the linear search.
+// Events handled by the server are kept per sequence sorted by frame, so the events of a frame interval are found by binary search.
+// Model pointers are only valid for the current map, so the cache is dropped on map change.
+class CAnimationCache
+{
+public:
+	struct EventRef
+	{
+		int frame;
+		int index;	// position in the sequence event list
+	};
+
+	CAnimationCache();
+	~CAnimationCache();
+
+	int LookupActivity( studiohdr_t *pstudiohdr, int activity );
+	int LookupActivityHeaviest( studiohdr_t *pstudiohdr, int activity );
+	int LookupSequence( studiohdr_t *pstudiohdr, const char *label );
+	int SequenceEvents( studiohdr_t *pstudiohdr, int sequence, const EventRef *&events );
+
+	void Clear();
+
+	void ReportStats();
+	void ResetStats();
+
+private:
+	CAnimationCache( const CAnimationCache & );
+	CAnimationCache &operator=( const CAnimationCache & );
+
+	struct ActivityRange
+	{
+		int first;
+		int count;
+		int totalWeight;
+		int heaviest;
+	};
+
+	struct LabelSlot
+	{
+		unsigned int hash;
+		int sequence;
+	};
+
+	struct ModelTables
+	{
+		char name[64];
+		int length;
+		int numseq;
+
+		std::map<int, ActivityRange> activities;
+		std::vector<int> sequences;
+		std::vector<int> cumulativeWeights;
+		std::vector<LabelSlot> labels;
+		std::vector<int> eventStart;
+		std::vector<EventRef> events;
+
+		unsigned int activityLookups;
+		unsigned int sequenceLookups;
+		unsigned int eventLookups;
+	};
+
+	static unsigned int HashLabel( const char *label );
+
+	ModelTables *Tables( studiohdr_t *pstudiohdr );
+	ModelTables *Build( studiohdr_t *pstudiohdr );
+	const ActivityRange *FindActivity( ModelTables *tables, int activity );
+
+	std::map<const studiohdr_t *, ModelTables *> _models;
+	const studiohdr_t *_lastModel;
+	ModelTables *_lastTables;
+
+	unsigned int _builds;
+};
+
+extern CAnimationCache g_AnimationCache;
+
+void DumpAnimationCache();
+
+#endif
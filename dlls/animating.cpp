@@ -160,10 +160,30 @@ void CBaseAnimating::DispatchAnimEvents( float flInterval )
 
 	int latestAnimEventFrame = 0;
 	bool handledEvent = false;
-	while( ( index = GetAnimationEvent( pmodel, pev, &event, flStart, flEnd, index, latestAnimEventFrame, m_minAnimEventFrame ) ) != 0 )
+
+	AnimationEvent_t events[MAX_DISPATCHED_ANIM_EVENTS];
+	const int sequence = pev->sequence;
+	const int eventCount = GetAnimationEvents( pmodel, pev, events, MAX_DISPATCHED_ANIM_EVENTS, flStart, flEnd, m_minAnimEventFrame );
+	for( int i = 0; i < Q_min( eventCount, (int)MAX_DISPATCHED_ANIM_EVENTS ); i++ )
 	{
 		handledEvent = true;
-		HandleAnimEvent( &event );
+		if( events[i].frame > latestAnimEventFrame )
+			latestAnimEventFrame = events[i].frame;
+		HandleAnimEvent( &events[i].monsterEvent );
+		index = events[i].index + 1;
+
+		// The handler switched the sequence, carry on the old way: the rest of the events come from the new sequence
+		if( pev->sequence != sequence )
+			break;
+	}
+
+	if( pev->sequence != sequence || eventCount > MAX_DISPATCHED_ANIM_EVENTS )
+	{
+		while( ( index = GetAnimationEvent( pmodel, pev, &event, flStart, flEnd, index, latestAnimEventFrame, m_minAnimEventFrame ) ) != 0 )
+		{
+			handledEvent = true;
+			HandleAnimEvent( &event );
+		}
 	}
 	if (m_fSequenceLoops)
 		m_minAnimEventFrame = 0;
@@ -20,6 +20,10 @@
 #include "animation.h"
 #include "scriptevent.h"
 #include "studio.h"
+#include "anim_cache.h"
+
+#include <algorithm>
+#include <vector>
 #define VectorCopy(a,b) {(b)[0]=(a)[0];(b)[1]=(a)[1];(b)[2]=(a)[2];}
 
 #pragma warning( disable : 4244 )
@@ -55,23 +59,7 @@ int LookupActivity( void *pmodel, entvars_t *pev, int activity )
 	if( !pstudiohdr )
 		return 0;
 
-	mstudioseqdesc_t *pseqdesc;
-
-	pseqdesc = (mstudioseqdesc_t *)( (byte *)pstudiohdr + pstudiohdr->seqindex );
-
-	int weighttotal = 0;
-	int seq = ACTIVITY_NOT_AVAILABLE;
-	for( int i = 0; i < pstudiohdr->numseq; i++ )
-	{
-		if( pseqdesc[i].activity == activity )
-		{
-			weighttotal += pseqdesc[i].actweight;
-			if( !weighttotal || RANDOM_LONG( 0, weighttotal - 1 ) < pseqdesc[i].actweight )
-				seq = i;
-		}
-	}
-
-	return seq;
+	return g_AnimationCache.LookupActivity( pstudiohdr, activity );
 }
 
 int LookupActivityHeaviest( void *pmodel, entvars_t *pev, int activity )
@@ -82,25 +70,7 @@ int LookupActivityHeaviest( void *pmodel, entvars_t *pev, int activity )
 	if( !pstudiohdr )
 		return 0;
 
-	mstudioseqdesc_t *pseqdesc;
-
-	pseqdesc = (mstudioseqdesc_t *)( (byte *)pstudiohdr + pstudiohdr->seqindex );
-
-	int weight = 0;
-	int seq = ACTIVITY_NOT_AVAILABLE;
-	for( int i = 0; i < pstudiohdr->numseq; i++ )
-	{
-		if( pseqdesc[i].activity == activity )
-		{
-			if( pseqdesc[i].actweight > weight )
-			{
-				weight = pseqdesc[i].actweight;
-				seq = i;
-			}
-		}
-	}
-
-	return seq;
+	return g_AnimationCache.LookupActivityHeaviest( pstudiohdr, activity );
 }
 
 void GetEyePosition( void *pmodel, float *vecEyePosition )
@@ -126,17 +96,7 @@ int LookupSequence( void *pmodel, const char *label )
 	if( !pstudiohdr )
 		return 0;
 
-	mstudioseqdesc_t *pseqdesc;
-
-	pseqdesc = (mstudioseqdesc_t *)( (byte *)pstudiohdr + pstudiohdr->seqindex );
-
-	for( int i = 0; i < pstudiohdr->numseq; i++ )
-	{
-		if( stricmp( pseqdesc[i].label, label ) == 0 )
-			return i;
-	}
-
-	return -1;
+	return g_AnimationCache.LookupSequence( pstudiohdr, label );
 }
 
 int IsSoundEvent( int eventNumber )
@@ -278,6 +238,77 @@ int GetAnimationEvent( void *pmodel, entvars_t *pev, MonsterEvent_t *pMonsterEve
 	return 0;
 }
 
+int GetAnimationEvents( void *pmodel, entvars_t *pev, AnimationEvent_t *pEvents, int maxEvents, float flStart, float flEnd, int minAnimEventFrame )
+{
+	studiohdr_t *pstudiohdr;
+
+	pstudiohdr = (studiohdr_t *)pmodel;
+	if( !pstudiohdr || pev->sequence < 0 || pev->sequence >= pstudiohdr->numseq || !pEvents )
+		return 0;
+
+	const CAnimationCache::EventRef *refs;
+	const int numRefs = g_AnimationCache.SequenceEvents( pstudiohdr, pev->sequence, refs );
+	if( numRefs == 0 )
+		return 0;
+
+	mstudioseqdesc_t *pseqdesc;
+	mstudioevent_t *pevent;
+
+	pseqdesc = (mstudioseqdesc_t *)( (byte *)pstudiohdr + pstudiohdr->seqindex ) + (int)pev->sequence;
+	pevent = (mstudioevent_t *)( (byte *)pstudiohdr + pseqdesc->eventindex );
+
+	if( pseqdesc->numframes > 1 )
+	{
+		flStart *= ( pseqdesc->numframes - 1 ) / 256.0f;
+		flEnd *= (pseqdesc->numframes - 1) / 256.0f;
+	}
+	else
+	{
+		flStart = 0.0f;
+		flEnd = 1.0f;
+	}
+
+	// Events are sorted by frame, so both the interval and the part wrapped around the end of a looping sequence are ranges
+	const float flFirst = Q_max( flStart, (float)minAnimEventFrame );
+	const int first = std::partition_point( refs, refs + numRefs, [flFirst]( const CAnimationCache::EventRef &ref ) {
+		return ref.frame < flFirst;
+	}) - refs;
+	const int last = std::partition_point( refs + first, refs + numRefs, [flEnd]( const CAnimationCache::EventRef &ref ) {
+		return ref.frame < flEnd;
+	}) - refs;
+
+	int wrapped = 0;
+	if( ( pseqdesc->flags & STUDIO_LOOPING ) && flEnd >= pseqdesc->numframes - 1 )
+	{
+		const float flWrapEnd = flEnd - pseqdesc->numframes + 1;
+		wrapped = std::partition_point( refs, refs + numRefs, [flWrapEnd]( const CAnimationCache::EventRef &ref ) {
+			return ref.frame < flWrapEnd;
+		}) - refs;
+	}
+
+	static std::vector<CAnimationCache::EventRef> found;
+	found.clear();
+	found.insert( found.end(), refs, refs + wrapped );
+	if( last > Q_max( first, wrapped ) )
+		found.insert( found.end(), refs + Q_max( first, wrapped ), refs + last );
+
+	// Handlers expect the model order
+	std::sort( found.begin(), found.end(), []( const CAnimationCache::EventRef &a, const CAnimationCache::EventRef &b ) {
+		return a.index < b.index;
+	});
+
+	const int count = Q_min( (int)found.size(), maxEvents );
+	for( int i = 0; i < count; i++ )
+	{
+		mstudioevent_t &event = pevent[found[i].index];
+		pEvents[i].monsterEvent.event = event.event;
+		pEvents[i].monsterEvent.options = event.options;
+		pEvents[i].frame = event.frame;
+		pEvents[i].index = found[i].index;
+	}
+	return (int)found.size();
+}
+
 float SetController( void *pmodel, entvars_t *pev, int iController, float flValue )
 {
 	studiohdr_t *pstudiohdr;
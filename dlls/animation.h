@@ -43,6 +43,19 @@ int GetBodyCount( void *pmodel );
 int GetBodygroupNumModels( void *pmodel, int iGroup );
 
 int GetAnimationEvent(void *pmodel, entvars_t *pev, MonsterEvent_t *pMonsterEvent, float flStart, float flEnd, int index, int& latestAnimEventFrame , int minAnimEventFrame);
+
+typedef struct
+{
+	MonsterEvent_t monsterEvent;
+	int frame;
+	int index;	// position in the sequence event list
+} AnimationEvent_t;
+
+#define MAX_DISPATCHED_ANIM_EVENTS	16
+
+// All events GetAnimationEvent would return for the interval, in the same order.
+// Returns the number of events found, only the first maxEvents are written out.
+int GetAnimationEvents(void *pmodel, entvars_t *pev, AnimationEvent_t *pEvents, int maxEvents, float flStart, float flEnd, int minAnimEventFrame);
 int ExtractBbox( void *pmodel, int sequence, float *mins, float *maxs );
 
 // From /engine/studio.h
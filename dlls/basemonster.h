@@ -159,6 +159,8 @@ public:
 	int IDefaultRelationship( int classify );
 	
 	static int IDefaultRelationship(int classify1, int classify2);
+	// Rebuilds the relationship table and drops cached classify values on next use
+	static void InvalidateRelationships();
 	
 	virtual void MonsterInit( void );
 	virtual void MonsterInitDead( void );	// Call after animation/pose is set up
@@ -400,6 +402,7 @@ public:
 	void SetMyFieldOfView(const float defaultFieldOfView );
 
 	int Classify();
+	int ComputeClassify();
 	virtual int DefaultClassify();
 	virtual const char* ReverseRelationshipModel() { return NULL; }
 
@@ -479,6 +482,11 @@ public:
 
 	const EntTemplate* m_cachedEntTemplate;
 	bool m_entTemplateChecked;
+
+	// Classify() result, valid while m_reverseRelationship matches and the generation is current
+	int m_cachedClassify;
+	BOOL m_cachedClassifyReverse;
+	unsigned int m_cachedClassifyGeneration;
 };
 
 #define FREEROAM_MAPDEFAULT 0
@@ -338,6 +338,9 @@ private:
 	int m_crabCount;
 
 	int m_SpitSprite;
+
+	SoundScriptHandle m_footstepLeftSound;
+	SoundScriptHandle m_footstepRightSound;
 };
 
 LINK_ENTITY_TO_CLASS( monster_bigmomma, CBigMomma )
@@ -551,11 +554,11 @@ void CBigMomma::HandleAnimEvent( MonsterEvent_t *pEvent )
 			break;
 		case BIG_AE_STEP1:		// Footstep left
 		case BIG_AE_STEP3:		// Footstep back left
-			EmitSoundScript(footstepLeftSoundScript);
+			EmitSoundScript(m_footstepLeftSound, footstepLeftSoundScript);
 			break;
 		case BIG_AE_STEP4:		// Footstep back right
 		case BIG_AE_STEP2:		// Footstep right
-			EmitSoundScript(footstepRightSoundScript);
+			EmitSoundScript(m_footstepRightSound, footstepRightSoundScript);
 			break;
 		case BIG_AE_MORTAR_ATTACK1:
 			LaunchMortar();
@@ -750,6 +753,8 @@ void CBigMomma::Precache()
 	RegisterAndPrecacheSoundScript(attackHitSoundScript, NPC::attackHitSoundScript);
 	RegisterAndPrecacheSoundScript(footstepLeftSoundScript);
 	RegisterAndPrecacheSoundScript(footstepRightSoundScript);
+	m_footstepLeftSound = ResolveSoundScript(footstepLeftSoundScript);
+	m_footstepRightSound = ResolveSoundScript(footstepRightSoundScript);
 	RegisterAndPrecacheSoundScript(birthSoundScript);
 	RegisterAndPrecacheSoundScript(sackSoundScript);
 	RegisterAndPrecacheSoundScript(layHeadcrabSoundScript);
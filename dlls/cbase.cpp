@@ -23,6 +23,10 @@
 #include	"game.h"
 #include	"pm_shared.h"
 #include	"ent_templates.h"
+#include	"spatial_hash.h"
+#include	"template_name_cache.h"
+#include	"locus_cache.h"
+#include	"anim_cache.h"
 
 bool g_fIsXash3D = false;
 
@@ -103,6 +107,16 @@ void OnFreeEntPrivateData(edict_s* pEdict)
 		ClearStringPool();
 		ClearPrecachedModels();
 		ClearPrecachedSounds();
+		g_EntitySpatialHash.Clear();
+		g_EntityNameIndex.Clear();
+		g_TemplateNameCache.Clear();
+		g_LocusCache.Clear();
+		g_AnimationCache.Clear();
+	}
+	else
+	{
+		g_EntitySpatialHash.Remove(pEdict);
+		g_EntityNameIndex.Remove(pEdict);
 	}
 }
 
@@ -201,6 +215,10 @@ int DispatchSpawn( edict_t *pent )
 
 		if( pEntity )
 		{
+			// Entities that never link to the world still should be found by the spatial queries
+			g_EntitySpatialHash.Update( pent );
+			g_EntityNameIndex.Update( pent );
+
 			if( g_pGameRules && !g_pGameRules->IsAllowedToSpawn( pEntity ) )
 				return -1;	// return that this entity should be deleted
 			if( pEntity->pev->flags & FL_KILLME )
@@ -247,6 +265,10 @@ void DispatchKeyValue( edict_t *pentKeyvalue, KeyValueData *pkvd )
 
 	EntvarsKeyvalue( VARS( pentKeyvalue ), pkvd );
 
+	// This may be a targetname change coming from trigger_changevalue
+	if( pkvd->fHandled )
+		g_EntityNameIndex.Update( pentKeyvalue );
+
 	// If the key was an entity variable, or there's no class set yet, don't look for the object, it may
 	// not exist yet.
 	if ( pkvd->fHandled || pkvd->szClassName == NULL )
@@ -424,6 +446,7 @@ int DispatchRestore( edict_t *pent, SAVERESTOREDATA *pSaveData, int globalEntity
 
 		// Again, could be deleted, get the pointer again.
 		pEntity = (CBaseEntity *)GET_PRIVATE( pent );
+		g_EntityNameIndex.Update( pent );
 #if 0
 		if( pEntity && pEntity->pev->globalname && globalEntity ) 
 		{
@@ -475,6 +498,9 @@ void DispatchObjectCollsionBox( edict_t *pent )
 	}
 	else
 		SetObjectCollisionBox( &pent->v );
+
+	// Engine calls this each time the edict gets linked, so it's the place to track entity movement
+	g_EntitySpatialHash.Update( pent );
 }
 
 void SaveWriteFields( SAVERESTOREDATA *pSaveData, const char *pname, void *pBaseData, TYPEDESCRIPTION *pFields, int fieldCount )
@@ -765,10 +791,25 @@ const char* CBaseEntity::GetSoundScriptNameForMyTemplate(const char *name)
 	return name;
 }
 
+SoundScriptHandle CBaseEntity::ResolveSoundScript(const char *name)
+{
+	if (!name)
+		return SoundScriptHandle();
+
+	int slot;
+	if (g_TemplateNameCache.Find(CTemplateNameCache::KIND_SOUNDSCRIPT, name, m_entTemplate, m_ownerEntTemplate, slot))
+		return SoundScriptHandle(slot);
+
+	const SoundScriptHandle handle = g_SoundScriptSystem.FindSoundScript(GetSoundScriptNameForMyTemplate(name));
+	// Scripts that are not registered yet may appear later, so only found ones are remembered
+	if (handle.IsValid())
+		g_TemplateNameCache.Store(CTemplateNameCache::KIND_SOUNDSCRIPT, name, m_entTemplate, m_ownerEntTemplate, handle.index);
+	return handle;
+}
+
 const SoundScript* CBaseEntity::GetSoundScript(const char *name)
 {
-	name = GetSoundScriptNameForMyTemplate(name);
-	return g_SoundScriptSystem.GetSoundScript(name);
+	return g_SoundScriptSystem.GetSoundScript(ResolveSoundScript(name));
 }
 
 bool CBaseEntity::EmitSoundScript(const SoundScript *soundScript, const SoundScriptParamOverride paramsOverride, int flags)
@@ -801,6 +842,23 @@ bool CBaseEntity::EmitSoundScript(const char *name, const SoundScriptParamOverri
 	return false;
 }
 
+bool CBaseEntity::EmitSoundScript(SoundScriptHandle handle, const SoundScriptParamOverride paramsOverride, int flags)
+{
+	const SoundScript* soundScript = g_SoundScriptSystem.GetSoundScript(handle);
+	if (soundScript)
+	{
+		return EmitSoundScript(soundScript, paramsOverride, flags);
+	}
+	return false;
+}
+
+bool CBaseEntity::EmitSoundScript(SoundScriptHandle& handle, const char *name, const SoundScriptParamOverride paramsOverride, int flags)
+{
+	if (!handle.IsValid())
+		handle = ResolveSoundScript(name);
+	return EmitSoundScript(handle, paramsOverride, flags);
+}
+
 void CBaseEntity::StopSoundScript(const SoundScript* soundScript)
 {
 	if (soundScript)
@@ -924,10 +982,29 @@ const char* CBaseEntity::GetVisualNameForMyTemplate(const char *name, string_t*
 	return name;
 }
 
+VisualHandle CBaseEntity::ResolveVisual(const char *name)
+{
+	if (!name)
+		return VisualHandle();
+
+	int slot;
+	if (g_TemplateNameCache.Find(CTemplateNameCache::KIND_VISUAL, name, m_entTemplate, m_ownerEntTemplate, slot))
+		return VisualHandle(slot);
+
+	const VisualHandle handle = g_VisualSystem.FindVisual(GetVisualNameForMyTemplate(name));
+	if (handle.IsValid())
+		g_TemplateNameCache.Store(CTemplateNameCache::KIND_VISUAL, name, m_entTemplate, m_ownerEntTemplate, handle.index);
+	return handle;
+}
+
 const Visual* CBaseEntity::GetVisual(const char *name)
 {
-	name = GetVisualNameForMyTemplate(name);
-	return g_VisualSystem.GetVisual(name);
+	return g_VisualSystem.GetVisual(ResolveVisual(name));
+}
+
+const Visual* CBaseEntity::GetVisual(VisualHandle handle)
+{
+	return g_VisualSystem.GetVisual(handle);
 }
 
 const Visual* CBaseEntity::RegisterVisual(const NamedVisual &defaultVisual, bool precache, string_t* usedTemplate)
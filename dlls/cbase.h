@@ -22,6 +22,7 @@
 #include "visuals.h"
 #include "grapple_target.h"
 #include "classify.h"
+#include "entity_name_index.h"
 /*
 
 Class Hierachy
@@ -262,9 +263,13 @@ public:
 
 	static const char* GetSoundScriptNameForTemplate(const char* name, string_t templateName);
 	const char* GetSoundScriptNameForMyTemplate(const char* name);
+	SoundScriptHandle ResolveSoundScript(const char* name);
 	const SoundScript* GetSoundScript(const char* name);
 	bool EmitSoundScript(const SoundScript* soundScript, const SoundScriptParamOverride paramsOverride = SoundScriptParamOverride(), int flags = 0);
 	bool EmitSoundScript(const char* name, const SoundScriptParamOverride paramsOverride = SoundScriptParamOverride(), int flags = 0);
+	bool EmitSoundScript(SoundScriptHandle handle, const SoundScriptParamOverride paramsOverride = SoundScriptParamOverride(), int flags = 0);
+	// Emits through a handle resolved in Precache, resolving the name if the handle isn't known yet (e.g. after restore)
+	bool EmitSoundScript(SoundScriptHandle& handle, const char* name, const SoundScriptParamOverride paramsOverride = SoundScriptParamOverride(), int flags = 0);
 	void StopSoundScript(const SoundScript* soundScript);
 	void StopSoundScript(const char* name);
 	void EmitSoundScriptAmbient(const Vector& vecOrigin, const SoundScript* soundScript, const SoundScriptParamOverride paramsOverride = SoundScriptParamOverride(), int flags = 0);
@@ -277,7 +282,9 @@ public:
 
 	static const char* GetVisualNameForTemplate(const char* name, string_t templateName);
 	const char* GetVisualNameForMyTemplate(const char* name, string_t* usedTemplate = nullptr);
+	VisualHandle ResolveVisual(const char* name);
 	const Visual* GetVisual(const char* name);
+	const Visual* GetVisual(VisualHandle handle);
 	const Visual* RegisterVisual(const NamedVisual& defaultVisual, bool precache = true, string_t* usedTemplate = nullptr);
 	void AssignEntityOverrides(EntityOverrides entityOverrides);
 	EntityOverrides GetProjectileOverrides() const;
@@ -289,6 +296,10 @@ public:
 	// allow engine to allocate instance data
 	void *operator new( size_t stAllocateBlock, entvars_t *pev )
 	{
+#if !CLIENT_DLL
+		// names are usually assigned right after the allocation, so keep an eye on this entity for the rest of the frame
+		g_EntityNameIndex.MarkPending( ENT( pev ) );
+#endif
 		return (void *)ALLOC_PRIVATE( ENT( pev ), stAllocateBlock );
 	};
 
@@ -42,6 +42,9 @@
 #include "nodes.h"
 #include "game.h"
 #include "common_soundscripts.h"
+#include "spatial_hash.h"
+#include "sight_cache.h"
+#include "spawn_points.h"
 
 extern DLL_GLOBAL ULONG		g_ulModelIndexPlayer;
 extern DLL_GLOBAL BOOL		g_fGameOver;
@@ -874,6 +877,11 @@ void ServerActivate( edict_t *pEdictList, int edictCount, int clientMax )
 	// Link user messages here to make sure first client can get them...
 	LinkUserMessages();
 
+	// All entities are spawned or restored at this point
+	g_EntitySpatialHash.Rebuild();
+	g_EntityNameIndex.Rebuild();
+	g_SpawnPointRegistry.Clear();
+
 	// fix all of the node graph pointers before the game starts.
 	if( WorldGraph.m_fGraphPresent && !WorldGraph.m_fGraphPointersSet )
 	{
@@ -950,6 +958,9 @@ void StartFrame( void )
 
 	gpGlobals->teamplay = teamplay.value;
 	g_ulFrameCount++;
+
+	g_SightCache.BeginFrame();
+	g_EntityNameIndex.BeginFrame();
 }
 
 int PM_IsThereSnowTexture();
@@ -38,6 +38,8 @@
 #include "common_soundscripts.h"
 #include "visuals_utils.h"
 #include "ent_templates.h"
+#include "sight_cache.h"
+#include "fx_flags.h"
 
 extern DLL_GLOBAL Vector		g_vecAttackDir;
 extern DLL_GLOBAL int			g_iSkillLevel;
@@ -1452,7 +1454,6 @@ BOOL CBaseMonster::FInViewCone( Vector *pOrigin )
 //=========================================================
 BOOL CBaseEntity::FVisible( CBaseEntity *pEntity )
 {
-	TraceResult tr;
 	Vector		vecLookerOrigin;
 	Vector		vecTargetOrigin;
 
@@ -1472,16 +1473,8 @@ BOOL CBaseEntity::FVisible( CBaseEntity *pEntity )
 	vecLookerOrigin = pev->origin + pev->view_ofs;//look through the caller's 'eyes'
 	vecTargetOrigin = pEntity->EyePosition();
 
-	UTIL_TraceLine( vecLookerOrigin, vecTargetOrigin, ignore_monsters, ignore_glass, ENT( pev )/*pentIgnore*/, &tr );
-
-	if( tr.flFraction != 1.0f )
-	{
-		return FALSE;// Line of sight is not established
-	}
-	else
-	{
-		return TRUE;// line of sight is valid.
-	}
+	// The trace is shared with other checks between the same entities during this frame
+	return g_SightCache.CheckLineOfSight( this, pEntity, vecLookerOrigin, vecTargetOrigin ) ? TRUE : FALSE;
 }
 
 //=========================================================
@@ -1653,7 +1646,7 @@ static float DamageByBulletType(int bulletType, float defaultDamage)
 	}
 }
 
-static void DoBulletTraceAttack(entvars_t *pevInflictor, entvars_t *pevAttacker, TraceResult& tr, const Vector& vecDir, const Vector& vecSrc, const Vector& vecEnd, int iBulletType, int iDamage, float defaultDamage, bool decalsPredicted = false)
+static void DoBulletTraceAttack(entvars_t *pevInflictor, entvars_t *pevAttacker, TraceResult& tr, const Vector& vecDir, const Vector& vecSrc, const Vector& vecEnd, int iBulletType, int iDamage, float defaultDamage, bool decalsPredicted = false, bool effectsInVolley = false)
 {
 	CBaseEntity *pEntity = CBaseEntity::Instance( tr.pHit );
 
@@ -1661,8 +1654,11 @@ static void DoBulletTraceAttack(entvars_t *pevInflictor, entvars_t *pevAttacker,
 	{
 		pEntity->TraceAttack( pevInflictor, pevAttacker, iDamage, vecDir, &tr, DMG_BULLET | ( ( iDamage > 16 ) ? DMG_ALWAYSGIB : DMG_NEVERGIB ) );
 
-		TEXTURETYPE_PlaySound( &tr, vecSrc, vecEnd, iBulletType );
-		DecalGunshot( &tr, iBulletType );
+		if (!effectsInVolley)
+		{
+			TEXTURETYPE_PlaySound( &tr, vecSrc, vecEnd, iBulletType );
+			DecalGunshot( &tr, iBulletType );
+		}
 	}
 	else
 	{
@@ -1680,7 +1676,7 @@ static void DoBulletTraceAttack(entvars_t *pevInflictor, entvars_t *pevAttacker,
 		{
 			pEntity->TraceAttack( pevInflictor, pevAttacker, DamageByBulletType(iBulletType, defaultDamage), vecDir, &tr, DMG_BULLET );
 
-			if (!decalsPredicted)
+			if (!decalsPredicted && !effectsInVolley)
 			{
 				TEXTURETYPE_PlaySound( &tr, vecSrc, vecEnd, iBulletType );
 				DecalGunshot( &tr, iBulletType );
@@ -1689,6 +1685,95 @@ static void DoBulletTraceAttack(entvars_t *pevInflictor, entvars_t *pevAttacker,
 	}
 }
 
+// Collects tracers and impact effects of the pellets fired by monsters and sends them in BulletVolley messages
+// instead of separate temp entities, texture sounds, decals and bubble trails per pellet.
+// The client expands the message with the same helpers the player weapon events use.
+// The message goes to the PAS of the shooter. The legacy decals and impact sounds went to the PAS of each impact,
+// so a client that can hear an impact but not the shooter doesn't get it. Checking each end point against
+// the shooter's PAS would not find those clients, because every impact is in line of sight of the shooter.
+class CBulletVolley
+{
+public:
+	CBulletVolley( const Vector& vecSrc, int iBulletType ): _vecSrc(vecSrc), _bulletType(iBulletType), _count(0) {}
+
+	void AddPellet( TraceResult& tr, const Vector& vecSrc, const Vector& vecEnd, bool tracer )
+	{
+		Pellet& pellet = _pellets[_count];
+		pellet.vecEnd = tr.vecEndPos;
+		pellet.flags = tracer ? BULLET_VOLLEY_TRACER : 0;
+		pellet.textureType = 0;
+
+		if( tr.flFraction != 1.0f )
+		{
+			pellet.flags |= BULLET_VOLLEY_HIT;
+			pellet.vecNormal = tr.vecPlaneNormal;
+
+			bool isSky;
+			pellet.textureType = TEXTURETYPE_FromTrace( &tr, vecSrc, vecEnd, &isSky );
+
+			if( g_pGameRules->PlayTextureSounds() )
+			{
+				pellet.flags |= BULLET_VOLLEY_SOUND;
+
+				// the object will already play a damaged sound
+				if( !FNullEnt( tr.pHit ) && FClassnameIs( VARS( tr.pHit ), "func_breakable" ) )
+					pellet.flags |= BULLET_VOLLEY_QUIET_SOUND;
+				else if( pellet.textureType == CHAR_TEX_COMPUTER && RANDOM_LONG( 0, 1 ) )
+					pellet.flags |= BULLET_VOLLEY_SPARKS;
+			}
+
+			// the same check as in DecalGunshot
+			if( !isSky && UTIL_IsValidEntity( tr.pHit ) && ( VARS( tr.pHit )->solid == SOLID_BSP || VARS( tr.pHit )->movetype == MOVETYPE_PUSHSTEP ) )
+				pellet.flags |= BULLET_VOLLEY_DECAL;
+		}
+
+		if( ++_count == BULLET_VOLLEY_MAX_PELLETS )
+			Flush();
+	}
+
+	void Flush()
+	{
+		if( !_count )
+			return;
+
+		extern int gmsgBulletVolley;
+		MESSAGE_BEGIN( MSG_PAS, gmsgBulletVolley, _vecSrc );
+			WRITE_VECTOR( _vecSrc );
+			WRITE_BYTE( _bulletType );
+			WRITE_BYTE( _count );
+			for( int i = 0; i < _count; ++i )
+			{
+				const Pellet& pellet = _pellets[i];
+				WRITE_BYTE( pellet.flags );
+				WRITE_VECTOR( pellet.vecEnd );
+				if( pellet.flags & BULLET_VOLLEY_HIT )
+				{
+					WRITE_CHAR( pellet.textureType );
+					WRITE_CHAR( (int)( pellet.vecNormal.x * 127.0f ) );
+					WRITE_CHAR( (int)( pellet.vecNormal.y * 127.0f ) );
+					WRITE_CHAR( (int)( pellet.vecNormal.z * 127.0f ) );
+				}
+			}
+		MESSAGE_END();
+
+		_count = 0;
+	}
+
+private:
+	struct Pellet
+	{
+		Vector vecEnd;
+		Vector vecNormal;
+		int flags;
+		char textureType;
+	};
+
+	Vector _vecSrc;
+	int _bulletType;
+	int _count;
+	Pellet _pellets[BULLET_VOLLEY_MAX_PELLETS];
+};
+
 /*
 ================
 FireBullets
@@ -1713,6 +1798,10 @@ void CBaseEntity::FireBullets( ULONG cShots, Vector vecSrc, Vector vecDirShootin
 
 	UTIL_MuzzleLight(vecSrc);
 
+	// BULLET_NONE attacks have their own effects and player tracers start at the gun, keep them on the legacy path
+	const bool sendVolley = sv_bulletvolleys.value != 0 && iBulletType != BULLET_NONE && !IsPlayer();
+	CBulletVolley volley( vecSrc, iBulletType );
+
 	for( ULONG iShot = 1; iShot <= cShots; iShot++ )
 	{
 		// get circular gaussian spread
@@ -1731,7 +1820,19 @@ void CBaseEntity::FireBullets( ULONG cShots, Vector vecSrc, Vector vecDirShootin
 		vecEnd = vecSrc + vecDir * flDistance;
 		UTIL_TraceLine( vecSrc, vecEnd, dont_ignore_monsters, ENT( pev )/*pentIgnore*/, &tr );
 
-		if( iTracerFreq != 0 && ( tracerCount++ % iTracerFreq ) == 0 )
+		const bool tracer = iTracerFreq != 0 && ( tracerCount++ % iTracerFreq ) == 0;
+
+		if( sendVolley )
+		{
+			if( tr.flFraction != 1.0f )
+			{
+				DoBulletTraceAttack(pev, pevAttacker, tr, vecDir, vecSrc, vecEnd, iBulletType, iDamage, gSkillData.monDmg9MM, false, true);
+			}
+			volley.AddPellet( tr, vecSrc, vecEnd, tracer );
+			continue;
+		}
+
+		if( tracer )
 		{
 			Vector vecTracerSrc;
 
@@ -1759,6 +1860,7 @@ void CBaseEntity::FireBullets( ULONG cShots, Vector vecSrc, Vector vecDirShootin
 		// make bullet trails
 		UTIL_BubbleTrail( vecSrc, tr.vecEndPos, (int)( ( flDistance * tr.flFraction ) / 64.0f ) );
 	}
+	volley.Flush();
 	ApplyMultiDamage( pev, pevAttacker );
 }
 
@@ -5,6 +5,7 @@
 #include "grapple_target.h"
 #include "icase_compare.h"
 #include "classify.h"
+#include "template_name_cache.h"
 
 #include <set>
 #include <utility>
@@ -439,6 +440,8 @@ void EntTemplateSystem::EnsureVisualReplacementForTemplate(const char* templateN
 			std::string replacement = GenerateResourceName(it->first, visualName);
 			entTemplate->SetVisualReplacement(visualName, replacement);
 			g_VisualSystem.EnsureVisualExists(replacement);
+			// Entities of this template may have resolved the visual to the default one already
+			g_TemplateNameCache.Clear();
 		}
 	}
 }
@@ -0,0 +1,288 @@
+#include "extdll.h"
+#include "util.h"
+#include "cbase.h"
+#include "game.h"
+#include "entity_name_index.h"
+
+#include <algorithm>
+
+CEntityNameIndex g_EntityNameIndex;
+
+CEntityNameIndex::CEntityNameIndex(): _targetnameGeneration(0)
+{
+	ResetStats();
+}
+
+void CEntityNameIndex::Clear()
+{
+	for( int field = 0; field < FIELD_COUNT; field++ )
+	{
+		for( int i = 0; i < BUCKET_COUNT; i++ )
+			_buckets[field][i].clear();
+	}
+	_entities.clear();
+	_pending.clear();
+	_targetnameGeneration++;
+}
+
+void CEntityNameIndex::Rebuild()
+{
+	Clear();
+
+	edict_t *pEdict = INDEXENT( 0 );
+	if( !pEdict )
+		return;
+
+	EnsureCapacity( gpGlobals->maxEntities - 1 );
+	for( int i = 1; i < gpGlobals->maxEntities; i++ )
+		Sync( i, &pEdict[i] );
+}
+
+void CEntityNameIndex::BeginFrame()
+{
+	edict_t *pEdict = INDEXENT( 0 );
+	if( !pEdict )
+		return;
+
+	// Entities created during the last frame got their names after the allocation, read them one last time
+	FlushPending();
+	for( size_t i = 0; i < _pending.size(); i++ )
+		_entities[_pending[i]].pending = false;
+	_pending.clear();
+
+	// Names assigned directly to existing entities must be reported with Update,
+	// in developer mode check that nobody forgot to
+	if( g_psv_developer && g_psv_developer->value )
+	{
+		EnsureCapacity( gpGlobals->maxEntities - 1 );
+		for( int i = 1; i < gpGlobals->maxEntities; i++ )
+		{
+			if( Sync( i, &pEdict[i] ) )
+			{
+				_frameResyncs++;
+				ALERT( at_warning, "Entity name index missed a name change of %s \"%s\" (%d)\n",
+					STRING( pEdict[i].v.classname ), STRING( pEdict[i].v.targetname ), i );
+			}
+		}
+	}
+}
+
+void CEntityNameIndex::Update( edict_t *pent )
+{
+	if( !pent )
+		return;
+
+	const int index = ENTINDEX( pent );
+	if( index <= 0 )
+		return;
+
+	EnsureCapacity( index );
+	Sync( index, pent );
+}
+
+void CEntityNameIndex::MarkPending( edict_t *pent )
+{
+	if( !pent )
+		return;
+
+	const int index = ENTINDEX( pent );
+	if( index <= 0 )
+		return;
+
+	EnsureCapacity( index );
+	if( !_entities[index].pending )
+	{
+		_entities[index].pending = true;
+		_pending.push_back( index );
+	}
+}
+
+void CEntityNameIndex::Remove( edict_t *pent )
+{
+	if( !pent )
+		return;
+
+	const int index = ENTINDEX( pent );
+	if( index <= 0 || index >= (int)_entities.size() )
+		return;
+
+	for( int field = 0; field < FIELD_COUNT; field++ )
+		Unlink( index, field );
+}
+
+bool CEntityNameIndex::IsActive() const
+{
+	return sv_nameindex.value != 0;
+}
+
+unsigned int CEntityNameIndex::TargetnameGeneration()
+{
+	FlushPending();
+	return _targetnameGeneration;
+}
+
+unsigned int CEntityNameIndex::HashString( const char *psz )
+{
+	unsigned int hash = 2166136261u;
+	while( *psz )
+	{
+		hash ^= (unsigned char)*psz++;
+		hash *= 16777619u;
+	}
+	return hash;
+}
+
+string_t CEntityNameIndex::FieldValue( const edict_t *pent, int field )
+{
+	if( pent->free || !pent->pvPrivateData )
+		return iStringNull;
+	return field == FIELD_TARGETNAME ? pent->v.targetname : pent->v.classname;
+}
+
+void CEntityNameIndex::EnsureCapacity( int index )
+{
+	if( index >= (int)_entities.size() )
+	{
+		EntityNames names;
+		for( int field = 0; field < FIELD_COUNT; field++ )
+		{
+			names.name[field] = iStringNull;
+			names.bucket[field] = -1;
+		}
+		names.pending = false;
+		_entities.resize( Q_max( index + 1, gpGlobals->maxEntities ), names );
+	}
+}
+
+void CEntityNameIndex::Link( int index, int field, string_t name )
+{
+	EntityNames &names = _entities[index];
+	names.name[field] = name;
+
+	if( FStringNull( name ) || !*STRING( name ) )
+		return;
+
+	if( field == FIELD_TARGETNAME )
+		_targetnameGeneration++;
+
+	const int bucket = HashString( STRING( name ) ) & ( BUCKET_COUNT - 1 );
+	std::vector<int> &entries = _buckets[field][bucket];
+	entries.insert( std::lower_bound( entries.begin(), entries.end(), index ), index );
+	names.bucket[field] = bucket;
+}
+
+void CEntityNameIndex::Unlink( int index, int field )
+{
+	EntityNames &names = _entities[index];
+	if( names.bucket[field] >= 0 )
+	{
+		std::vector<int> &entries = _buckets[field][names.bucket[field]];
+		std::vector<int>::iterator it = std::lower_bound( entries.begin(), entries.end(), index );
+		if( it != entries.end() && *it == index )
+			entries.erase( it );
+		names.bucket[field] = -1;
+		if( field == FIELD_TARGETNAME )
+			_targetnameGeneration++;
+	}
+	names.name[field] = iStringNull;
+}
+
+bool CEntityNameIndex::Sync( int index, edict_t *pent )
+{
+	bool changed = false;
+	for( int field = 0; field < FIELD_COUNT; field++ )
+	{
+		const string_t name = FieldValue( pent, field );
+		if( name == _entities[index].name[field] )
+			continue;
+
+		Unlink( index, field );
+		Link( index, field, name );
+		changed = true;
+	}
+	return changed;
+}
+
+void CEntityNameIndex::FlushPending()
+{
+	edict_t *pEdict = INDEXENT( 0 );
+	for( size_t i = 0; i < _pending.size(); i++ )
+		Sync( _pending[i], &pEdict[_pending[i]] );
+}
+
+bool CEntityNameIndex::FindEntityByString( edict_t *pStart, const char *szKeyword, const char *szValue, edict_t *&pResult )
+{
+	if( !IsActive() )
+		return false;
+
+	int field;
+	if( FStrEq( szKeyword, "targetname" ) )
+		field = FIELD_TARGETNAME;
+	else if( FStrEq( szKeyword, "classname" ) )
+		field = FIELD_CLASSNAME;
+	else
+		return false;
+
+	_queryCount++;
+
+	edict_t *pEdictList = INDEXENT( 0 );
+	if( !pEdictList || !szValue || !*szValue )
+	{
+		_fallbackCount++;
+		return false;
+	}
+
+	FlushPending();
+
+	pResult = NULL;
+	const int startIndex = pStart ? ENTINDEX( pStart ) : 0;
+	const std::vector<int> &entries = _buckets[field][HashString( szValue ) & ( BUCKET_COUNT - 1 )];
+	for( std::vector<int>::const_iterator it = std::upper_bound( entries.begin(), entries.end(), startIndex ); it != entries.end(); ++it )
+	{
+		_candidatesVisited++;
+
+		edict_t *pent = &pEdictList[*it];
+		const string_t name = FieldValue( pent, field );
+		if( name != _entities[*it].name[field] )
+			_staleCandidates++;
+		if( !FStringNull( name ) && FStrEq( STRING( name ), szValue ) )
+		{
+			pResult = pent;
+			break;
+		}
+	}
+	return true;
+}
+
+void CEntityNameIndex::ReportStats()
+{
+	int indexed[FIELD_COUNT] = { 0, 0 };
+	size_t largestBucket = 0;
+	for( int field = 0; field < FIELD_COUNT; field++ )
+	{
+		for( int i = 0; i < BUCKET_COUNT; i++ )
+		{
+			indexed[field] += (int)_buckets[field][i].size();
+			largestBucket = Q_max( largestBucket, _buckets[field][i].size() );
+		}
+	}
+
+	ALERT( at_console, "Indexed entities: %d by targetname, %d by classname, largest bucket %d\n",
+		indexed[FIELD_TARGETNAME], indexed[FIELD_CLASSNAME], (int)largestBucket );
+	ALERT( at_console, "Queries: %u, fallbacks: %u\n", _queryCount, _fallbackCount );
+	if( _queryCount > _fallbackCount )
+		ALERT( at_console, "Candidates per query: %.2f\n", (float)_candidatesVisited / ( _queryCount - _fallbackCount ) );
+	ALERT( at_console, "Stale candidates: %u, missed name changes: %u\n", _staleCandidates, _frameResyncs );
+}
+
+void CEntityNameIndex::ResetStats()
+{
+	_queryCount = _fallbackCount = _candidatesVisited = _staleCandidates = _frameResyncs = 0;
+}
+
+void DumpEntityNameIndex()
+{
+	g_EntityNameIndex.ReportStats();
+	if( CMD_ARGC() > 1 && FStrEq( CMD_ARGV( 1 ), "reset" ) )
+		g_EntityNameIndex.ResetStats();
+}
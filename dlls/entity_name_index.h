@@ -0,0 +1,78 @@
+#pragma once
+#ifndef ENTITY_NAME_INDEX_H
+#define ENTITY_NAME_INDEX_H
+
+#include <vector>
+
+// Index of entities by targetname and classname contents.
+// Each hash bucket keeps edict indices sorted, so lookups return entities in the same order the engine scan would.
+// Entities are re-read on spawn, restore, keyvalue changes and when code reports a name change,
+// new entities are re-read on every lookup during the frame they were created in and once more at the next frame start.
+// Code that renames an existing entity must call Update, in developer mode the index is checked against the edicts every frame.
+// Candidates are always compared against the current name, so a stale entry can't produce a wrong match.
+class CEntityNameIndex
+{
+public:
+	enum
+	{
+		FIELD_TARGETNAME = 0,
+		FIELD_CLASSNAME,
+		FIELD_COUNT
+	};
+
+	CEntityNameIndex();
+
+	void Clear();
+	void Rebuild();
+	void BeginFrame();
+	void Update( edict_t *pent );
+	void MarkPending( edict_t *pent );
+	void Remove( edict_t *pent );
+
+	bool IsActive() const;
+
+	// Changes whenever an indexed targetname changes, so callers can keep what a name resolved to until then
+	unsigned int TargetnameGeneration();
+
+	// Returns false if the query can't be served by the index and the caller should fall back to the edict scan
+	bool FindEntityByString( edict_t *pStart, const char *szKeyword, const char *szValue, edict_t *&pResult );
+
+	void ReportStats();
+	void ResetStats();
+
+	static const int BUCKET_COUNT = 1024;
+
+private:
+	struct EntityNames
+	{
+		string_t name[FIELD_COUNT];
+		int bucket[FIELD_COUNT];
+		bool pending;
+	};
+
+	static unsigned int HashString( const char *psz );
+	static string_t FieldValue( const edict_t *pent, int field );
+
+	void EnsureCapacity( int index );
+	void Link( int index, int field, string_t name );
+	void Unlink( int index, int field );
+	bool Sync( int index, edict_t *pent );
+	void FlushPending();
+
+	std::vector<int> _buckets[FIELD_COUNT][BUCKET_COUNT];
+	std::vector<EntityNames> _entities;
+	std::vector<int> _pending;
+	unsigned int _targetnameGeneration;
+
+	unsigned int _queryCount;
+	unsigned int _fallbackCount;
+	unsigned int _candidatesVisited;
+	unsigned int _staleCandidates;
+	unsigned int _frameResyncs;
+};
+
+extern CEntityNameIndex g_EntityNameIndex;
+
+void DumpEntityNameIndex();
+
+#endif
@@ -855,6 +855,7 @@ void CBreakable::DieToActivator( CBaseEntity* pActivator )
 
 	// Don't fire something that could fire myself
 	pev->targetname = 0;
+	g_EntityNameIndex.Update( edict() );
 	pev->effects |= EF_NODRAW;
 	pev->takedamage = DAMAGE_NO;
 
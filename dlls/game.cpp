@@ -16,11 +16,13 @@
 #include "eiface.h"
 #include "util.h"
 #include "game.h"
+#include "skill.h"
 #include "mod_features.h"
 #include "parsetext.h"
 #include "weapon_ids.h"
 #include "saverestore.h"
 #include "locus.h"
+#include "locus_cache.h"
 #include "ammo_amounts.h"
 #include "inventory.h"
 #include "soundscripts.h"
@@ -29,6 +31,18 @@
 #include "followers.h"
 #include "savetitles.h"
 #include "vcs_info.h"
+#include "spatial_hash.h"
+#include "sight_cache.h"
+#include "route_search.h"
+#include "node_locator.h"
+#include "entity_name_index.h"
+#include "spawn_points.h"
+#include "string_pool.h"
+#include "template_name_cache.h"
+#include "anim_cache.h"
+#include "save_layout.h"
+#include "cbase.h"
+#include "basemonster.h"
 
 ModFeatures g_modFeatures;
 
@@ -667,6 +681,7 @@ static cvar_t build_commit = { "sv_game_build_commit", g_VCSInfo_Commit };
 static cvar_t build_branch = { "sv_game_build_branch", g_VCSInfo_Commit };
 
 cvar_t displaysoundlist = {"displaysoundlist","0"};
+cvar_t maxworldsounds = {"sv_maxworldsounds","1024"};
 
 // multiplayer server rules
 cvar_t fragsleft	= { "mp_fragsleft","0", FCVAR_SERVER | FCVAR_UNLOGGED };	  // Don't spam console/log files/users with this changing
@@ -758,12 +773,14 @@ cvar_t *g_psv_developer;
 #define DECLARE_SKILL_VALUE(name, defaultValue) \
 cvar_t name ## 1 = { #name "1", defaultValue, 0, 0, 0 }; \
 cvar_t name ## 2 = { #name "2", defaultValue, 0, 0, 0 }; \
-cvar_t name ## 3 = { #name "3", defaultValue, 0, 0, 0 };
+cvar_t name ## 3 = { #name "3", defaultValue, 0, 0, 0 }; \
+static skill_cvar_t name ## _skill( #name, &name ## 1, &name ## 2, &name ## 3 );
 
 #define DECLARE_SKILL_VALUE3(name, defaultValue1, defaultValue2, defaultValue3) \
 cvar_t name ## 1 = { #name "1", defaultValue1, 0, 0, 0 }; \
 cvar_t name ## 2 = { #name "2", defaultValue2, 0, 0, 0 }; \
-cvar_t name ## 3 = { #name "3", defaultValue3, 0, 0, 0 };
+cvar_t name ## 3 = { #name "3", defaultValue3, 0, 0, 0 }; \
+static skill_cvar_t name ## _skill( #name, &name ## 1, &name ## 2, &name ## 3 );
 
 #define REGISTER_SKILL_CVARS(name) \
 CVAR_REGISTER( &name ## 1 ); \
@@ -1391,6 +1408,12 @@ cvar_t* violence_agibs = NULL;
 
 cvar_t sv_pushable_fixed_tick_fudge = { "sv_pushable_fixed_tick_fudge", "15" };
 cvar_t sv_busters = { "sv_busters", "0" };
+cvar_t sv_spatialhash = { "sv_spatialhash", "1" };
+cvar_t sv_sightcache = { "sv_sightcache", "1" };
+cvar_t sv_nodegrid = { "sv_nodegrid", "1" };
+cvar_t sv_nameindex = { "sv_nameindex", "1" };
+cvar_t sv_bulletvolleys = { "sv_bulletvolleys", "1" }; // monster pellets are sent to the shooter's PAS, not the PAS of each impact
+cvar_t sv_locuscache = { "sv_locuscache", "1" };
 
 extern void RegisterAmmoTypes();
 extern void ReportRegisteredAmmoTypes();
@@ -1401,6 +1424,7 @@ extern void LoadWarpballTemplates();
 void GameDLLInit( void )
 {
 	ReadServerFeatures();
+	CBaseMonster::InvalidateRelationships();
 	ReadEnabledMonsters();
 	ReadEnabledWeapons();
 	ReadMaxAmmos();
@@ -1435,6 +1459,7 @@ void GameDLLInit( void )
 	CVAR_REGISTER( &build_branch );
 
 	CVAR_REGISTER( &displaysoundlist );
+	CVAR_REGISTER( &maxworldsounds );
 	CVAR_REGISTER( &allow_spectators );
 #if FEATURE_USE_THROUGH_WALLS_CVAR
 	CVAR_REGISTER( &use_through_walls );
@@ -1504,6 +1529,12 @@ void GameDLLInit( void )
 	CVAR_REGISTER( &pickup_policy );
 
 	CVAR_REGISTER( &sv_busters );
+	CVAR_REGISTER( &sv_spatialhash );
+	CVAR_REGISTER( &sv_sightcache );
+	CVAR_REGISTER( &sv_nodegrid );
+	CVAR_REGISTER( &sv_nameindex );
+	CVAR_REGISTER( &sv_bulletvolleys );
+	CVAR_REGISTER( &sv_locuscache );
 
 #if FEATURE_GRENADE_JUMP_CVAR
 	CVAR_REGISTER( &grenade_jump );
@@ -2032,6 +2063,7 @@ void GameDLLInit( void )
 	g_engfuncs.pfnAddServerCommand("entities_count", Cmd_NumberOfEntities);
 	g_engfuncs.pfnAddServerCommand("set_global_state", Cmd_SetGlobalState);
 	g_engfuncs.pfnAddServerCommand("set_global_value", Cmd_SetGlobalValue);
+	g_engfuncs.pfnAddServerCommand("skill_reload", ReloadSkillData);
 	g_engfuncs.pfnAddServerCommand("calc_ratio", Cmd_CalcRatio);
 	g_engfuncs.pfnAddServerCommand("calc_position", Cmd_CalcPosition);
 	g_engfuncs.pfnAddServerCommand("calc_velocity", Cmd_CalcVelocity);
@@ -2043,6 +2075,17 @@ void GameDLLInit( void )
 	g_engfuncs.pfnAddServerCommand("dump_sound_replacements", ReportSoundReplacements);
 	g_engfuncs.pfnAddServerCommand("dump_soundscripts", DumpSoundScripts);
 	g_engfuncs.pfnAddServerCommand("dump_visuals", DumpVisuals);
+	g_engfuncs.pfnAddServerCommand("dump_spatialhash", DumpEntitySpatialHash);
+	g_engfuncs.pfnAddServerCommand("dump_sightcache", DumpSightCache);
+	g_engfuncs.pfnAddServerCommand("dump_routestats", DumpRouteStats);
+	g_engfuncs.pfnAddServerCommand("dump_nearestnode", DumpNodeLocator);
+	g_engfuncs.pfnAddServerCommand("dump_nameindex", DumpEntityNameIndex);
+	g_engfuncs.pfnAddServerCommand("dump_spawnpoints", DumpSpawnPoints);
+	g_engfuncs.pfnAddServerCommand("dump_locus", DumpLocusCache);
+	g_engfuncs.pfnAddServerCommand("dump_stringpool", DumpStringPool);
+	g_engfuncs.pfnAddServerCommand("dump_templatenames", DumpTemplateNameCache);
+	g_engfuncs.pfnAddServerCommand("dumpanimcache", DumpAnimationCache);
+	g_engfuncs.pfnAddServerCommand("dump_saverestore", DumpSaveLayoutCache);
 }
 
 bool ItemsPickableByTouch()
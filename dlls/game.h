@@ -153,6 +153,7 @@ int ItemsPhysicsFix();
 const char* FixedAmmoName(const char* ammoName);
 
 extern cvar_t displaysoundlist;
+extern cvar_t maxworldsounds;
 
 // multiplayer server rules
 extern cvar_t teamplay;
@@ -194,6 +195,13 @@ extern cvar_t npckill;
 extern cvar_t sv_bunnyhop;
 extern cvar_t sv_pushable_fixed_tick_fudge;
 extern cvar_t sv_busters;
+extern cvar_t sv_spatialhash;
+extern cvar_t sv_sightcache;
+extern cvar_t sv_nodegrid;
+extern cvar_t sv_nameindex;
+extern cvar_t sv_bulletvolleys;
+extern cvar_t sv_locuscache;
+extern cvar_t findnearestnodefix;
 
 extern cvar_t keepinventory;
 
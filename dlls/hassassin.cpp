@@ -116,6 +116,8 @@ public:
 	static const NamedSoundScript shotSoundScript;
 	static const NamedSoundScript cloakSoundScript;
 	static const NamedSoundScript footstepSoundScript;
+
+	SoundScriptHandle m_footstepSound;
 };
 
 LINK_ENTITY_TO_CLASS( monster_human_assassin, CHAssassin )
@@ -424,6 +426,7 @@ void CHAssassin::Precache()
 	RegisterAndPrecacheSoundScript(shotSoundScript);
 	RegisterAndPrecacheSoundScript(footstepSoundScript);
 	RegisterAndPrecacheSoundScript(cloakSoundScript);
+	m_footstepSound = ResolveSoundScript(footstepSoundScript);
 
 	m_iShell = PRECACHE_MODEL( "models/shell.mdl" );// brass shell
 }	
@@ -831,7 +834,7 @@ void CHAssassin::RunAI( void )
 		iStep = !iStep;
 		if( iStep )
 		{
-			EmitSoundScript(footstepSoundScript);
+			EmitSoundScript(m_footstepSound, footstepSoundScript);
 		}
 	}
 }
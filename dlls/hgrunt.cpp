@@ -863,7 +863,7 @@ void CHGrunt::Shotgun( void )
 void CHGrunt::PlayFirstBurstSounds()
 {
 	// the first round of the three round burst plays the sound and puts a sound in the world sound list.
-	EmitSoundScript(burst9mmSoundScript);
+	EmitSoundScript(m_burst9mmSound, burst9mmSoundScript);
 }
 
 void CHGrunt::PlayReloadSound()
@@ -878,7 +878,7 @@ void CHGrunt::PlayGrenadeLaunchSound()
 
 void CHGrunt::PlayShogtunSound()
 {
-	EmitSoundScript(shotgunSoundScript);
+	EmitSoundScript(m_shotgunSound, shotgunSoundScript);
 }
 
 void CHGrunt::HandleAnimEvent( MonsterEvent_t *pEvent )
@@ -1111,6 +1111,11 @@ void CHGrunt::Precache()
 	RegisterAndPrecacheSoundScript(useSoundScript);
 	RegisterAndPrecacheSoundScript(unuseSoundScript);
 
+	m_painSound = ResolveSoundScript(painSoundScript);
+	m_dieSound = ResolveSoundScript(dieSoundScript);
+	m_burst9mmSound = ResolveSoundScript(burst9mmSoundScript);
+	m_shotgunSound = ResolveSoundScript(shotgunSoundScript);
+
 	// get voice pitch
 	if( RANDOM_LONG( 0, 1 ) )
 		m_voicePitch = 109 + RANDOM_LONG( 0, 7 );
@@ -1210,7 +1215,7 @@ void CHGrunt::PainSound( void )
 
 void CHGrunt::PlayPainSound()
 {
-	EmitSoundScript(painSoundScript);
+	EmitSoundScript(m_painSound, painSoundScript);
 }
 
 //=========================================================
@@ -1218,7 +1223,7 @@ void CHGrunt::PlayPainSound()
 //=========================================================
 void CHGrunt::DeathSound( void )
 {
-	EmitSoundScript(dieSoundScript);
+	EmitSoundScript(m_dieSound, dieSoundScript);
 }
 
 float CHGrunt::SentenceVolume()
@@ -2448,6 +2453,7 @@ void CHGruntRepel::RepelUse( CBaseEntity *pActivator, CBaseEntity *pCaller, USE_
 	SetBits(pEntity->pev->spawnflags, flagsToSet);
 
 	pEntity->pev->targetname = pev->message;
+	g_EntityNameIndex.Update( pEntity->edict() );
 	pEntity->pev->netname = pev->netname;
 	pEntity->pev->weapons = pev->weapons;
 	pEntity->pev->health = pev->health;
@@ -174,6 +174,12 @@ public:
 
 	static const NamedSoundScript useSoundScript;
 	static const NamedSoundScript unuseSoundScript;
+
+protected:
+	SoundScriptHandle m_painSound;
+	SoundScriptHandle m_dieSound;
+	SoundScriptHandle m_burst9mmSound;
+	SoundScriptHandle m_shotgunSound;
 };
 
 class CHGruntRepel : public CFollowingMonster
@@ -10,6 +10,7 @@
 #include "util.h"
 #include "cbase.h"
 #include "locus.h"
+#include "locus_cache.h"
 #include "effects.h"
 #include "decals.h"
 
@@ -18,17 +19,49 @@ bool IsLikelyNumber(const char* szText)
 	return (*szText >= '0' && *szText <= '9') || *szText == '-';
 }
 
-bool TryCalcLocus_Position(CBaseEntity *pEntity, CBaseEntity *pLocus, const char *szText, Vector& result, bool showError)
+// Reads a number from the text, or finds the entity it refers to.
+// Returns true if the text was a number and was written to pVector or pRatio.
+static bool EvaluateLocusText(CBaseEntity *pEntity, CBaseEntity *pLocus, const char *szText, Vector* pVector, float* pRatio, CBaseEntity*& pCalc)
 {
+	pCalc = NULL;
+	if (g_LocusCache.IsActive())
+	{
+		CLocusCache::Expression& expr = g_LocusCache.Compile(szText, pEntity);
+		if (expr.kind == CLocusCache::KIND_NUMBER)
+		{
+			if (pVector)
+				*pVector = expr.VectorValue();
+			if (pRatio)
+				*pRatio = expr.ratio;
+			return true;
+		}
+		pCalc = g_LocusCache.Resolve(expr, pLocus);
+		return false;
+	}
+
 	if (IsLikelyNumber(szText))
-	{ // it's a vector
-		Vector tmp;
-		UTIL_StringToRandomVector( (float *)tmp, szText );
-		result = tmp;
+	{
+		if (pVector)
+		{
+			Vector tmp;
+			UTIL_StringToRandomVector( (float *)tmp, szText );
+			*pVector = tmp;
+		}
+		if (pRatio)
+			*pRatio = atof( szText );
 		return true;
 	}
 
-	CBaseEntity *pCalc = UTIL_FindEntityByTargetname(NULL, szText, pLocus);
+	pCalc = UTIL_FindEntityByTargetname(NULL, szText, pLocus);
+	return false;
+}
+
+bool TryCalcLocus_Position(CBaseEntity *pEntity, CBaseEntity *pLocus, const char *szText, Vector& result, bool showError)
+{
+	CBaseEntity *pCalc;
+	if (EvaluateLocusText(pEntity, pLocus, szText, &result, NULL, pCalc))
+		return true;
+
 	if (pCalc != NULL)
 	{
 		return pCalc->CalcPosition( pLocus, &result );
@@ -45,15 +78,10 @@ bool TryCalcLocus_Position(CBaseEntity *pEntity, CBaseEntity *pLocus, const char
 
 bool TryCalcLocus_Velocity(CBaseEntity *pEntity, CBaseEntity *pLocus, const char *szText, Vector& result, bool showError)
 {
-	if (IsLikelyNumber(szText))
-	{ // it's a vector
-		Vector tmp;
-		UTIL_StringToRandomVector( (float *)tmp, szText );
-		result = tmp;
+	CBaseEntity *pCalc;
+	if (EvaluateLocusText(pEntity, pLocus, szText, &result, NULL, pCalc))
 		return true;
-	}
 
-	CBaseEntity *pCalc = UTIL_FindEntityByTargetname(NULL, szText, pLocus);
 	if (pCalc != NULL)
 	{
 		return pCalc->CalcVelocity( pLocus, &result );
@@ -70,13 +98,9 @@ bool TryCalcLocus_Velocity(CBaseEntity *pEntity, CBaseEntity *pLocus, const char
 
 bool TryCalcLocus_Ratio(CBaseEntity *pLocus, const char *szText, float& result, bool showError)
 {
-	if (IsLikelyNumber(szText))
-	{ // assume it's a float
-		result = atof( szText );
+	CBaseEntity *pCalc;
+	if (EvaluateLocusText(NULL, pLocus, szText, NULL, &result, pCalc))
 		return true;
-	}
-
-	CBaseEntity *pCalc = UTIL_FindEntityByTargetname(NULL, szText, pLocus);
 
 	if (pCalc != NULL)
 	{
@@ -92,15 +116,10 @@ bool TryCalcLocus_Ratio(CBaseEntity *pLocus, const char *szText, float& result,
 
 bool TryCalcLocus_Color(CBaseEntity *pEntity, CBaseEntity *pLocus, const char *szText, Vector& result, bool showError)
 {
-	if (IsLikelyNumber(szText))
-	{ // it's a vector
-		Vector tmp;
-		UTIL_StringToRandomVector( (float *)tmp, szText );
-		result = tmp;
+	CBaseEntity *pCalc;
+	if (EvaluateLocusText(pEntity, pLocus, szText, &result, NULL, pCalc))
 		return true;
-	}
 
-	CBaseEntity *pCalc = UTIL_FindEntityByTargetname(NULL, szText, pLocus);
 	if (pCalc != NULL)
 	{
 		result = pCalc->pev->rendercolor;
@@ -386,6 +405,7 @@ void CLocusBeam::Use( CBaseEntity *pActivator, CBaseEntity *pCaller, USE_TYPE us
 		pBeam->pev->nextthink = gpGlobals->time + m_fDuration;
 	}
 	pBeam->pev->targetname = m_iszTargetName;
+	g_EntityNameIndex.Update( pBeam->edict() );
 
 	if (pev->target)
 	{
@@ -1281,6 +1301,7 @@ void CLocusVariable::Use( CBaseEntity *pActivator, CBaseEntity *pCaller, USE_TYP
 		pMark->pev->movedir = vecDir;
 		pMark->pev->frags = fRatio;
 		pMark->pev->targetname = m_iszTargetName;
+		g_EntityNameIndex.Update( pMark->edict() );
 		pMark->pev->nextthink = gpGlobals->time + m_fDuration;
 
 		FireTargets(STRING(m_iszFireOnSpawn), pMark, this);
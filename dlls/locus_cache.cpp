@@ -0,0 +1,203 @@
+#include "extdll.h"
+#include "util.h"
+#include "cbase.h"
+#include "game.h"
+#include "locus.h"
+#include "string_pool.h"
+#include "entity_name_index.h"
+#include "locus_cache.h"
+
+#include <algorithm>
+
+CLocusCache g_LocusCache;
+
+Vector CLocusCache::Expression::VectorValue() const
+{
+	if( !isRange )
+		return vector;
+	return Vector( RANDOM_FLOAT( vector.x, vectorMax.x ), RANDOM_FLOAT( vector.y, vectorMax.y ), RANDOM_FLOAT( vector.z, vectorMax.z ) );
+}
+
+CLocusCache::CLocusCache(): _entries( ENTRY_COUNT ), _generation(1)
+{
+	ResetStats();
+}
+
+bool CLocusCache::IsActive() const
+{
+	return sv_locuscache.value != 0;
+}
+
+unsigned int CLocusCache::EntryIndex( const char *text )
+{
+	const unsigned int key = (unsigned int)( (size_t)text >> 2 );
+	return ( key * 2654435761u ) & ( ENTRY_COUNT - 1 );
+}
+
+CLocusCache::Expression &CLocusCache::Compile( const char *text, CBaseEntity *pRequester )
+{
+	_evaluations++;
+
+	Expression &expr = _entries[EntryIndex( text )];
+	if( expr.generation != _generation || expr.key != text || strcmp( expr.text, text ) != 0 )
+	{
+		_compiles++;
+
+		expr.key = text;
+		expr.text = g_StringPool.Intern( text );
+		expr.vector = expr.vectorMax = g_vecZero;
+		expr.isRange = false;
+		expr.ratio = 0.0f;
+		if( IsLikelyNumber( text ) )
+		{
+			expr.kind = KIND_NUMBER;
+			expr.isRange = UTIL_StringToVectorRange( expr.vector, expr.vectorMax, text );
+			expr.ratio = atof( text );
+		}
+		else if( UTIL_TargetnameIsActivator( text ) || UTIL_IsPlayerReference( text ) )
+			expr.kind = KIND_ACTIVATOR;
+		else
+			expr.kind = KIND_ENTITY;
+		expr.hTarget = NULL;
+		expr.targetResolved = false;
+		expr.nameGeneration = 0;
+		expr.requester = 0;
+		expr.evaluations = 0;
+		expr.generation = _generation;
+	}
+
+	if( pRequester )
+		expr.requester = pRequester->entindex();
+	expr.evaluations++;
+	return expr;
+}
+
+CBaseEntity *CLocusCache::Resolve( Expression &expr, CBaseEntity *pLocus )
+{
+	if( expr.kind == KIND_ACTIVATOR )
+		return UTIL_FindEntityByTargetname( NULL, expr.text, pLocus );
+	if( expr.kind != KIND_ENTITY )
+		return NULL;
+
+	_targetLookups++;
+
+	// Without the index there's nothing that tells us about renamed entities
+	if( !g_EntityNameIndex.IsActive() )
+		return UTIL_FindEntityByTargetname( NULL, expr.text );
+
+	const unsigned int nameGeneration = g_EntityNameIndex.TargetnameGeneration();
+	if( expr.targetResolved && expr.nameGeneration == nameGeneration )
+	{
+		CBaseEntity *pTarget = expr.hTarget;
+		if( !pTarget )
+		{
+			_targetHits++;
+			return NULL;
+		}
+		if( FStrEq( STRING( pTarget->pev->targetname ), expr.text ) )
+		{
+			_targetHits++;
+			return pTarget;
+		}
+	}
+
+	CBaseEntity *pTarget = UTIL_FindEntityByTargetname( NULL, expr.text );
+	expr.hTarget = pTarget;
+	expr.targetResolved = true;
+	expr.nameGeneration = nameGeneration;
+	return pTarget;
+}
+
+void CLocusCache::Clear()
+{
+	_generation++;
+	if( _generation == 0 )
+	{
+		_entries.assign( ENTRY_COUNT, Expression() );
+		_generation = 1;
+	}
+}
+
+void CLocusCache::ReportStats()
+{
+	ALERT( at_console, "Locus evaluations: %u, compiles: %u\n", _evaluations, _compiles );
+	ALERT( at_console, "Target lookups: %u, served from cache: %u", _targetLookups, _targetHits );
+	if( _targetLookups )
+		ALERT( at_console, " (%.1f%% hit)", (float)_targetHits * 100.0f / _targetLookups );
+	ALERT( at_console, "\n" );
+}
+
+void CLocusCache::ResetStats()
+{
+	_evaluations = _compiles = _targetLookups = _targetHits = 0;
+}
+
+static bool ExpressionRequesterLess( const CLocusCache::Expression *a, const CLocusCache::Expression *b )
+{
+	if( a->requester != b->requester )
+		return a->requester < b->requester;
+	return strcmp( a->text, b->text ) < 0;
+}
+
+// Prints the compiled texts grouped by the entity that evaluated them, with what each one points to.
+// Targets are calc entities themselves, so following their index through the list walks the locus graph.
+void CLocusCache::ReportExpressions()
+{
+	std::vector<const Expression *> expressions;
+	for( size_t i = 0; i < _entries.size(); i++ )
+	{
+		if( _entries[i].generation == _generation )
+			expressions.push_back( &_entries[i] );
+	}
+	std::sort( expressions.begin(), expressions.end(), ExpressionRequesterLess );
+
+	for( size_t i = 0; i < expressions.size(); i++ )
+	{
+		const Expression &expr = *expressions[i];
+
+		if( expr.requester > 0 )
+		{
+			edict_t *pent = INDEXENT( expr.requester );
+			const bool valid = pent && !pent->free;
+			ALERT( at_console, "#%d %s \"%s\": ", expr.requester,
+				valid ? STRING( pent->v.classname ) : "(freed)", valid ? STRING( pent->v.targetname ) : "" );
+		}
+		else
+			ALERT( at_console, "(unknown): " );
+
+		ALERT( at_console, "\"%s\" ", expr.text );
+		switch( expr.kind )
+		{
+		case KIND_NUMBER:
+			if( expr.isRange )
+				ALERT( at_console, "= (%g %g %g) .. (%g %g %g)", expr.vector.x, expr.vector.y, expr.vector.z, expr.vectorMax.x, expr.vectorMax.y, expr.vectorMax.z );
+			else
+				ALERT( at_console, "= (%g %g %g)", expr.vector.x, expr.vector.y, expr.vector.z );
+			break;
+		case KIND_ACTIVATOR:
+			ALERT( at_console, "-> locus" );
+			break;
+		default:
+		{
+			EHANDLE hTarget = expr.hTarget;
+			CBaseEntity *pTarget = hTarget;
+			if( pTarget )
+				ALERT( at_console, "-> #%d %s", pTarget->entindex(), STRING( pTarget->pev->classname ) );
+			else if( expr.targetResolved )
+				ALERT( at_console, "-> (missing)" );
+			else
+				ALERT( at_console, "-> (unresolved)" );
+			break;
+		}
+		}
+		ALERT( at_console, ", %u evaluations\n", expr.evaluations );
+	}
+}
+
+void DumpLocusCache()
+{
+	g_LocusCache.ReportExpressions();
+	g_LocusCache.ReportStats();
+	if( CMD_ARGC() > 1 && FStrEq( CMD_ARGV( 1 ), "reset" ) )
+		g_LocusCache.ResetStats();
+}
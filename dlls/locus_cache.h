@@ -0,0 +1,72 @@
+#pragma once
+#ifndef LOCUS_CACHE_H
+#define LOCUS_CACHE_H
+
+#include <vector>
+
+// Compiled form of the texts passed to TryCalcLocus_* functions.
+// A text is parsed once into a constant vector (or range) and ratio, a reference to the locus or player,
+// or a targetname whose entity is kept until a targetname changes in the entity name index.
+// Entries are keyed by the caller's string pointer and checked against the text like CTemplateNameCache,
+// so a reused buffer can't return the expression of a different text.
+class CLocusCache
+{
+public:
+	enum
+	{
+		KIND_NUMBER = 0,
+		KIND_ACTIVATOR,
+		KIND_ENTITY,
+	};
+
+	struct Expression
+	{
+		const char *key;
+		const char *text;
+		int kind;
+		Vector vector;
+		Vector vectorMax;
+		bool isRange;
+		float ratio;
+		EHANDLE hTarget;
+		bool targetResolved;
+		unsigned int nameGeneration;
+		int requester; // entity index of the last entity that evaluated the text, 0 if unknown
+		unsigned int evaluations;
+		unsigned int generation;
+
+		Vector VectorValue() const;
+	};
+
+	CLocusCache();
+
+	bool IsActive() const;
+
+	Expression &Compile( const char *text, CBaseEntity *pRequester );
+	CBaseEntity *Resolve( Expression &expr, CBaseEntity *pLocus );
+
+	void Clear();
+
+	void ReportStats();
+	void ResetStats();
+	void ReportExpressions();
+
+	static const int ENTRY_COUNT = 1024;
+
+private:
+	static unsigned int EntryIndex( const char *text );
+
+	std::vector<Expression> _entries;
+	unsigned int _generation;
+
+	unsigned int _evaluations;
+	unsigned int _compiles;
+	unsigned int _targetLookups;
+	unsigned int _targetHits;
+};
+
+extern CLocusCache g_LocusCache;
+
+void DumpLocusCache();
+
+#endif
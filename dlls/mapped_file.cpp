@@ -0,0 +1,121 @@
+#include "extdll.h"
+#include "mapped_file.h"
+
+#if !XASH_WIN32 && !defined(__DOS__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define MAPPED_FILE_POSIX 1
+#endif
+
+CMappedFile::CMappedFile(): _data(NULL), _size(0), _mapped(false)
+#if XASH_WIN32
+	, _mapping(NULL)
+#endif
+{
+}
+
+CMappedFile::~CMappedFile()
+{
+	Close();
+}
+
+bool CMappedFile::Open( const char *pszPath )
+{
+	Close();
+
+#if XASH_WIN32
+	HANDLE file = CreateFileA( pszPath, GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_DELETE, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL );
+	if( file == INVALID_HANDLE_VALUE )
+		return false;
+
+	const DWORD size = GetFileSize( file, NULL );
+	if( size != INVALID_FILE_SIZE && size > 0 && size <= INT_MAX )
+	{
+		HANDLE mapping = CreateFileMappingA( file, NULL, PAGE_WRITECOPY, 0, 0, NULL );
+		if( mapping )
+		{
+			void *data = MapViewOfFile( mapping, FILE_MAP_COPY, 0, 0, 0 );
+			if( data )
+			{
+				_data = (unsigned char *)data;
+				_size = (int)size;
+				_mapped = true;
+				_mapping = mapping;
+			}
+			else
+			{
+				CloseHandle( mapping );
+			}
+		}
+	}
+	CloseHandle( file );
+	return _data != NULL;
+#elif MAPPED_FILE_POSIX
+	const int fd = open( pszPath, O_RDONLY );
+	if( fd < 0 )
+		return false;
+
+	struct stat st;
+	if( fstat( fd, &st ) == 0 && st.st_size > 0 && st.st_size <= INT_MAX )
+	{
+		void *data = mmap( NULL, st.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0 );
+		if( data != MAP_FAILED )
+		{
+			_data = (unsigned char *)data;
+			_size = (int)st.st_size;
+			_mapped = true;
+		}
+	}
+	close( fd );
+	return _data != NULL;
+#else
+	FILE *file = fopen( pszPath, "rb" );
+	if( !file )
+		return false;
+
+	fseek( file, 0, SEEK_END );
+	const long size = ftell( file );
+	fseek( file, 0, SEEK_SET );
+	if( size > 0 )
+	{
+		_data = (unsigned char *)malloc( size );
+		if( _data && fread( _data, 1, size, file ) == (size_t)size )
+		{
+			_size = (int)size;
+		}
+		else
+		{
+			free( _data );
+			_data = NULL;
+		}
+	}
+	fclose( file );
+	return _data != NULL;
+#endif
+}
+
+void CMappedFile::Close()
+{
+	if( !_data )
+		return;
+
+#if XASH_WIN32
+	if( _mapped )
+	{
+		UnmapViewOfFile( _data );
+		CloseHandle( _mapping );
+		_mapping = NULL;
+	}
+#elif MAPPED_FILE_POSIX
+	if( _mapped )
+		munmap( _data, _size );
+#endif
+	if( !_mapped )
+		free( _data );
+
+	_data = NULL;
+	_size = 0;
+	_mapped = false;
+}
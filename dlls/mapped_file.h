@@ -0,0 +1,38 @@
+#pragma once
+#ifndef MAPPED_FILE_H
+#define MAPPED_FILE_H
+
+// Read-only view of a file on disk. Pages are mapped copy-on-write,
+// so they're shared between processes until someone writes to them.
+// Where mapping is not available the file is read into memory instead.
+class CMappedFile
+{
+public:
+	CMappedFile();
+	~CMappedFile();
+
+	bool Open( const char *pszPath );
+	void Close();
+
+	bool IsOpen() const { return _data != NULL; }
+	bool Contains( const void *p ) const
+	{
+		return _data && (const unsigned char *)p >= _data && (const unsigned char *)p < _data + _size;
+	}
+
+	unsigned char *Data() const { return _data; }
+	int Size() const { return _size; }
+
+private:
+	CMappedFile( const CMappedFile & );
+	CMappedFile &operator=( const CMappedFile & );
+
+	unsigned char *_data;
+	int _size;
+	bool _mapped;
+#if XASH_WIN32
+	void *_mapping;
+#endif
+};
+
+#endif
@@ -809,6 +809,7 @@ CBaseEntity* CMonsterMaker::SpawnMonster(const Vector &placePosition, const Vect
 	{
 		// if I have a netname (overloaded), give the child monster that name as a targetname
 		pevCreate->targetname = pev->netname;
+		g_EntityNameIndex.Update( ENT( pevCreate ) );
 	}
 
 	m_cLiveChildren++;// count this monster
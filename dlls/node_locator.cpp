@@ -0,0 +1,235 @@
+#include <algorithm>
+
+#include "extdll.h"
+#include "util.h"
+#include "cbase.h"
+#include "nodes.h"
+#include "node_locator.h"
+
+CNodeLocator g_NodeLocator;
+
+CNodeLocator::CNodeLocator(): _builtFor(NULL), _builtNodes(0), _cellSize(0.0f), _cacheGeneration(1)
+{
+	_dims[0] = _dims[1] = _dims[2] = 0;
+	memset( _cache, 0, sizeof( _cache ) );
+	ResetStats();
+}
+
+void CNodeLocator::Reset()
+{
+	_builtFor = NULL;
+	_builtNodes = 0;
+	_cellStart.clear();
+	_cellNodes.clear();
+
+	InvalidateCache();
+}
+
+void CNodeLocator::InvalidateCache()
+{
+	_cacheGeneration++;
+	if( _cacheGeneration == 0 )
+	{
+		memset( _cache, 0, sizeof( _cache ) );
+		_cacheGeneration = 1;
+	}
+}
+
+int CNodeLocator::CellCoord( float value, int axis ) const
+{
+	const int coord = (int)floor( ( value - _gridMins[axis] ) / _cellSize );
+	return Q_max( 0, Q_min( coord, _dims[axis] - 1 ) );
+}
+
+void CNodeLocator::Build( const CGraph &graph )
+{
+	_builtFor = graph.m_pNodes;
+	_builtNodes = graph.m_cNodes;
+
+	// Cached answers are node indices of whatever graph the grid was built for
+	InvalidateCache();
+
+	Vector mins( 0, 0, 0 );
+	Vector maxs( 0, 0, 0 );
+	for( int i = 0; i < graph.m_cNodes; i++ )
+	{
+		const Vector &vecOrigin = graph.m_pNodes[i].m_vecOriginPeek;
+		if( i == 0 )
+		{
+			mins = maxs = vecOrigin;
+			continue;
+		}
+		for( int axis = 0; axis < 3; axis++ )
+		{
+			mins[axis] = Q_min( mins[axis], vecOrigin[axis] );
+			maxs[axis] = Q_max( maxs[axis], vecOrigin[axis] );
+		}
+	}
+
+	const Vector size = maxs - mins;
+	_cellSize = Q_max( (float)MIN_GRID_CELL_SIZE, Q_max( size.x, Q_max( size.y, size.z ) ) / MAX_GRID_DIMENSION + 1.0f );
+	_gridMins = mins;
+	for( int axis = 0; axis < 3; axis++ )
+	{
+		_dims[axis] = Q_min( (int)( size[axis] / _cellSize ) + 1, (int)MAX_GRID_DIMENSION );
+	}
+
+	const int cellCount = _dims[0] * _dims[1] * _dims[2];
+	_cellStart.assign( cellCount + 1, 0 );
+	_cellNodes.resize( graph.m_cNodes );
+
+	std::vector<int> nodeCells( graph.m_cNodes );
+	for( int i = 0; i < graph.m_cNodes; i++ )
+	{
+		const Vector &vecOrigin = graph.m_pNodes[i].m_vecOriginPeek;
+		nodeCells[i] = CellIndex( CellCoord( vecOrigin.x, 0 ), CellCoord( vecOrigin.y, 1 ), CellCoord( vecOrigin.z, 2 ) );
+		_cellStart[nodeCells[i] + 1]++;
+	}
+	for( int i = 0; i < cellCount; i++ )
+	{
+		_cellStart[i + 1] += _cellStart[i];
+	}
+
+	std::vector<int> fill( _cellStart.begin(), _cellStart.end() - 1 );
+	for( int i = 0; i < graph.m_cNodes; i++ )
+	{
+		_cellNodes[fill[nodeCells[i]]++] = i;
+	}
+
+	_candidates.reserve( graph.m_cNodes );
+}
+
+void CNodeLocator::AddCell( const CGraph &graph, const Vector &vecOrigin, int afNodeTypes, int x, int y, int z )
+{
+	const int cell = CellIndex( x, y, z );
+	for( int i = _cellStart[cell]; i < _cellStart[cell + 1]; i++ )
+	{
+		const int iNode = _cellNodes[i];
+		const CNode &node = graph.m_pNodes[iNode];
+		if( !( node.m_afNodeInfo & afNodeTypes ) )
+			continue;
+
+		Candidate candidate;
+		candidate.distance = ( vecOrigin - node.m_vecOriginPeek ).Length();
+		candidate.node = iNode;
+		_candidates.push_back( candidate );
+		std::push_heap( _candidates.begin(), _candidates.end() );
+	}
+}
+
+int CNodeLocator::FindNearestNode( CGraph &graph, const Vector &vecOrigin, int afNodeTypes )
+{
+	if( _builtFor != graph.m_pNodes || _builtNodes != graph.m_cNodes )
+		Build( graph );
+
+	const int cacheX = (int)floor( vecOrigin.x / CACHE_CELL_SIZE );
+	const int cacheY = (int)floor( vecOrigin.y / CACHE_CELL_SIZE );
+	const int cacheZ = (int)floor( vecOrigin.z / CACHE_CELL_SIZE );
+	const unsigned int hash = ( (unsigned int)cacheX * 73856093u ) ^ ( (unsigned int)cacheY * 19349663u )
+		^ ( (unsigned int)cacheZ * 83492791u ) ^ ( (unsigned int)afNodeTypes * 2654435761u );
+	CacheEntry &entry = _cache[hash & ( CACHE_ENTRIES - 1 )];
+	if( entry.generation == _cacheGeneration && entry.x == cacheX && entry.y == cacheY && entry.z == cacheZ && entry.nodeTypes == afNodeTypes )
+	{
+		_cacheHits++;
+		return entry.node;
+	}
+	_cacheMisses++;
+
+	int iNearest = -1;
+	if( graph.m_cNodes > 0 )
+	{
+		const int center[3] = { CellCoord( vecOrigin.x, 0 ), CellCoord( vecOrigin.y, 1 ), CellCoord( vecOrigin.z, 2 ) };
+		const int maxRing = Q_max( _dims[0], Q_max( _dims[1], _dims[2] ) );
+		_candidates.clear();
+
+		for( int ring = 0; ring <= maxRing && iNearest == -1; ring++ )
+		{
+			int lo[3], hi[3];
+			for( int axis = 0; axis < 3; axis++ )
+			{
+				lo[axis] = Q_max( center[axis] - ring, 0 );
+				hi[axis] = Q_min( center[axis] + ring, _dims[axis] - 1 );
+			}
+
+			// only the shell of this ring, the inner cells were visited already
+			for( int x = lo[0]; x <= hi[0]; x++ )
+			{
+				const bool edgeX = abs( x - center[0] ) == ring;
+				for( int y = lo[1]; y <= hi[1]; y++ )
+				{
+					const bool edgeY = edgeX || abs( y - center[1] ) == ring;
+					if( edgeY )
+					{
+						for( int z = lo[2]; z <= hi[2]; z++ )
+							AddCell( graph, vecOrigin, afNodeTypes, x, y, z );
+					}
+					else
+					{
+						if( center[2] - ring >= 0 )
+							AddCell( graph, vecOrigin, afNodeTypes, x, y, center[2] - ring );
+						if( ring > 0 && center[2] + ring < _dims[2] )
+							AddCell( graph, vecOrigin, afNodeTypes, x, y, center[2] + ring );
+					}
+				}
+			}
+
+			// Nodes outside of the visited box can't be closer than its nearest open side
+			float flSafeDistance = 999999.0f;
+			for( int axis = 0; axis < 3; axis++ )
+			{
+				if( lo[axis] > 0 )
+					flSafeDistance = Q_min( flSafeDistance, vecOrigin[axis] - ( _gridMins[axis] + lo[axis] * _cellSize ) );
+				if( hi[axis] < _dims[axis] - 1 )
+					flSafeDistance = Q_min( flSafeDistance, _gridMins[axis] + ( hi[axis] + 1 ) * _cellSize - vecOrigin[axis] );
+			}
+
+			while( !_candidates.empty() && _candidates.front().distance <= flSafeDistance )
+			{
+				const int iNode = _candidates.front().node;
+				std::pop_heap( _candidates.begin(), _candidates.end() );
+				_candidates.pop_back();
+
+				_tracesIssued++;
+				if( graph.FNodeVisibleFrom( vecOrigin, iNode ) )
+				{
+					iNearest = iNode;
+					break;
+				}
+			}
+		}
+	}
+
+	entry.x = cacheX;
+	entry.y = cacheY;
+	entry.z = cacheZ;
+	entry.nodeTypes = afNodeTypes;
+	entry.node = iNearest;
+	entry.generation = _cacheGeneration;
+	return iNearest;
+}
+
+void CNodeLocator::ReportStats()
+{
+	const unsigned int total = _cacheHits + _cacheMisses;
+	ALERT( at_console, "Nearest node queries: %u\n", total );
+	ALERT( at_console, "Cache hits: %u, misses: %u", _cacheHits, _cacheMisses );
+	if( total )
+		ALERT( at_console, " (%.1f%% hit)", (float)_cacheHits * 100.0f / total );
+	ALERT( at_console, "\n" );
+	if( _cacheMisses )
+		ALERT( at_console, "Traces per search: %.2f\n", (float)_tracesIssued / _cacheMisses );
+	if( _builtFor )
+		ALERT( at_console, "Grid: %dx%dx%d cells of %.0f units\n", _dims[0], _dims[1], _dims[2], _cellSize );
+}
+
+void CNodeLocator::ResetStats()
+{
+	_cacheHits = _cacheMisses = _tracesIssued = 0;
+}
+
+void DumpNodeLocator()
+{
+	g_NodeLocator.ReportStats();
+	if( CMD_ARGC() > 1 && FStrEq( CMD_ARGV( 1 ), "reset" ) )
+		g_NodeLocator.ResetStats();
+}
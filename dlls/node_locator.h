@@ -0,0 +1,74 @@
+#pragma once
+#ifndef NODE_LOCATOR_H
+#define NODE_LOCATOR_H
+
+#include <vector>
+
+class CGraph;
+
+// Nearest node lookup for the world graph.
+// Nodes are put into a 3D grid, the cells around the point are visited ring by ring
+// and the nodes found so far are checked for visibility from the closest one,
+// as soon as no unvisited cell can hold anything closer. The first visible node is the answer.
+// Answers are cached per 16 unit cell and node type mask.
+class CNodeLocator
+{
+public:
+	CNodeLocator();
+
+	void Reset();
+	int FindNearestNode( CGraph &graph, const Vector &vecOrigin, int afNodeTypes );
+
+	void ReportStats();
+	void ResetStats();
+
+	static const int CACHE_CELL_SIZE = 16;
+	static const int CACHE_ENTRIES = 1024;
+	static const int MAX_GRID_DIMENSION = 64;
+	static const int MIN_GRID_CELL_SIZE = 128;
+
+private:
+	struct Candidate
+	{
+		float distance;
+		int node;
+		bool operator<( const Candidate &other ) const { return distance > other.distance; }
+	};
+
+	struct CacheEntry
+	{
+		int x, y, z;
+		int nodeTypes;
+		int node;
+		unsigned int generation;
+	};
+
+	void Build( const CGraph &graph );
+	void InvalidateCache();
+	void AddCell( const CGraph &graph, const Vector &vecOrigin, int afNodeTypes, int x, int y, int z );
+	int CellIndex( int x, int y, int z ) const { return ( z * _dims[1] + y ) * _dims[0] + x; }
+	int CellCoord( float value, int axis ) const;
+
+	const void *_builtFor;
+	int _builtNodes;
+
+	Vector _gridMins;
+	float _cellSize;
+	int _dims[3];
+	std::vector<int> _cellStart;
+	std::vector<int> _cellNodes;
+	std::vector<Candidate> _candidates;
+
+	CacheEntry _cache[CACHE_ENTRIES];
+	unsigned int _cacheGeneration;
+
+	unsigned int _cacheHits;
+	unsigned int _cacheMisses;
+	unsigned int _tracesIssued;
+};
+
+extern CNodeLocator g_NodeLocator;
+
+void DumpNodeLocator();
+
+#endif
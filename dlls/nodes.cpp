@@ -22,10 +22,19 @@
 #include	"monsters.h"
 #include	"nodes.h"
 #include	"nodes_compat.h"
+#include	"route_search.h"
+#include	"node_locator.h"
+#include	"mapped_file.h"
 #include	"animation.h"
 #include	"doors.h"
 #include	"game.h"
 
+#if !defined(__DOS__)
+#define NODE_ROUTING_THREADS 1
+#include <atomic>
+#include <thread>
+#endif
+
 #define	HULL_STEP_SIZE 16// how far the test hull moves on each step
 #define	NODE_HEIGHT	8	// how high to lift nodes off the ground after we drop them all (make stair/ramp mapping easier)
 
@@ -40,6 +49,93 @@ Vector VecBModelOrigin( entvars_t *pevBModel );
 
 CGraph WorldGraph;
 
+// search state of static queries made before the routing tables are ready
+static float *g_pflClosestSoFar;
+static int *g_piPreviousNode;
+static int g_cSearchNodes;
+
+static void FreeStaticSearchState()
+{
+	delete[] g_pflClosestSoFar;
+	delete[] g_piPreviousNode;
+	g_pflClosestSoFar = NULL;
+	g_piPreviousNode = NULL;
+	g_cSearchNodes = 0;
+}
+
+//=========================================================
+// Layout of the .nod files written by FSaveGraph. Every
+// section starts at an aligned offset listed in the header,
+// so the file can be mapped and the sections that never
+// change after loading (nodes, hash links and routes) are
+// used in place.
+//=========================================================
+#define GRAPH_SECTION_ALIGN 16
+
+enum
+{
+	GRAPH_SECTION_NODES = 0,
+	GRAPH_SECTION_LINKS,
+	GRAPH_SECTION_DIST_INFO,
+	GRAPH_SECTION_RANGES,
+	GRAPH_SECTION_HASH_LINKS,
+	GRAPH_SECTION_ROUTE_INFO,
+	GRAPH_SECTION_COUNT
+};
+
+struct GraphFileSection
+{
+	int offset;
+	int size;
+};
+
+struct GraphFileHeader
+{
+	int version;// same place as in the old files, so older dlls just reject the graph
+	int headerSize;
+	int nodeSize;
+	int distInfoSize;
+	int cNodes;
+	int cLinks;
+	int nRouteInfo;
+	int nHashLinks;
+	int hashPrimes[16];
+	float regionMin[3];
+	float regionMax[3];
+	GraphFileSection sections[GRAPH_SECTION_COUNT];
+};
+
+// CLink without the pointer
+struct GraphFileLink
+{
+	int iSrcNode;
+	int iDestNode;
+	int fHasLinkEnt;
+	char szLinkEntModelname[4];
+	int afLinkInfo;
+	float flWeight;
+};
+
+struct GraphFileRanges
+{
+	int rangeStart[3][NUM_RANGES];
+	int rangeEnd[3][NUM_RANGES];
+};
+
+// Link ents are looked up by model name in FSetGraphPointers. Until then a blocked link
+// only needs a non-NULL pointer, the same way the old graph files kept stale pointers.
+#define UNRESOLVED_LINKENT ( (entvars_t *)-1 )
+
+// the file the world graph was mapped from
+static CMappedFile g_GraphFile;
+
+// frees a graph array unless it points into the mapped file
+static void FreeGraphMemory( void *p )
+{
+	if( !g_GraphFile.Contains( p ) )
+		free( p );
+}
+
 LINK_ENTITY_TO_CLASS( info_node, CNodeEnt )
 LINK_ENTITY_TO_CLASS( info_node_air, CNodeEnt )
 
@@ -69,7 +165,7 @@ void CGraph::InitGraph( void )
 	//
 	if( m_pLinkPool )
 	{
-		free( m_pLinkPool );
+		FreeGraphMemory( m_pLinkPool );
 		m_pLinkPool = NULL;
 	}
 
@@ -77,13 +173,13 @@ void CGraph::InitGraph( void )
 	//
 	if( m_pNodes )
 	{
-		free( m_pNodes );
+		FreeGraphMemory( m_pNodes );
 		m_pNodes = NULL;
 	}
 
 	if( m_di )
 	{
-		free( m_di );
+		FreeGraphMemory( m_di );
 		m_di = NULL;
 	}
 
@@ -91,16 +187,20 @@ void CGraph::InitGraph( void )
 	//
 	if( m_pRouteInfo )
 	{
-		free( m_pRouteInfo );
+		FreeGraphMemory( m_pRouteInfo );
 		m_pRouteInfo = NULL;
 	}
 
 	if( m_pHashLinks )
 	{
-		free( m_pHashLinks );
+		FreeGraphMemory( m_pHashLinks );
 		m_pHashLinks = NULL;
 	}
 
+	// Nothing points into the mapped graph anymore
+	//
+	g_GraphFile.Close();
+
 	// Zero node and link counts
 	//
 	m_cNodes = 0;
@@ -109,6 +209,9 @@ void CGraph::InitGraph( void )
 
 	m_iLastActiveIdleSearch = 0;
 	m_iLastCoverSearch = 0;
+
+	g_RouteSearch.Reset();
+	g_NodeLocator.Reset();
 }
 	
 //=========================================================
@@ -538,10 +641,9 @@ int CGraph::NextNodeInRoute( int iCurrentNode, int iDest, int iHull, int iCap )
 //=========================================================
 int CGraph::FindShortestPath(int *piPath, int pathSize, int iStart, int iDest, int iHull, int afCapMask , bool dynamic)
 {
-	int iVisitNode;
 	int iCurrentNode;
 	int iNumPathNodes;
-	int iHullMask = 0;
+	const int iHullMask = HullMask( iHull );
 
 	if( !m_fGraphPresent || !m_fGraphPointersSet )
 	{
@@ -569,6 +671,7 @@ int CGraph::FindShortestPath(int *piPath, int pathSize, int iStart, int iDest, i
 	if( !dynamic && m_fRoutingComplete )
 	{
 		//ALERT(at_aiconsole, "In m_fRoutingComplete\n");
+		const double startTime = CRouteSearch::Clock();
 		int iCap = CapIndex( afCapMask );
 
 		iNumPathNodes = 0;
@@ -598,110 +701,24 @@ int CGraph::FindShortestPath(int *piPath, int pathSize, int iStart, int iDest, i
 			iCurrentNode = iNext;
 		}
 		//ALERT( at_aiconsole, "SVD: Path with %d nodes.\n", iNumPathNodes );
+		g_RouteSearch.AddStaticQuery( CRouteSearch::Clock() - startTime );
+	}
+	else if( dynamic )
+	{
+		// the current state of link ents matters, so the routing tables can't be used
+		iNumPathNodes = g_RouteSearch.FindPath( *this, piPath, pathSize, iStart, iDest, iHull, iHullMask, afCapMask );
 	}
 	else
 	{
-		int i;
-		CQueuePriority queue;
-
-		switch( iHull )
-		{
-		case NODE_SMALL_HULL:
-			iHullMask = bits_LINK_SMALL_HULL;
-			break;
-		case NODE_HUMAN_HULL:
-			iHullMask = bits_LINK_HUMAN_HULL;
-			break;
-		case NODE_LARGE_HULL:
-			iHullMask = bits_LINK_LARGE_HULL;
-			break;
-		case NODE_FLY_HULL:
-			iHullMask = bits_LINK_FLY_HULL;
-			break;
-		}
-
-		// Mark all the nodes as unvisited.
-		//
-		for ( i = 0; i < m_cNodes; i++)
+		// Routing tables are built from the results of this search, so keep it as is.
+		if( g_cSearchNodes < m_cNodes )
 		{
-			m_pNodes[i].m_flClosestSoFar = -1.0f;
-		}
-
-		m_pNodes[iStart].m_flClosestSoFar = 0.0;
-		m_pNodes[iStart].m_iPreviousNode = iStart;// tag this as the origin node
-		queue.Insert( iStart, 0.0 );// insert start node 
-
-		while( !queue.Empty() )
-		{
-			// now pull a node out of the queue
-			float flCurrentDistance;
-			iCurrentNode = queue.Remove( flCurrentDistance );
-
-			// For straight-line weights, the following Shortcut works. For arbitrary weights,
-			// it doesn't.
-			//
-			if( iCurrentNode == iDest )
-				break;
-
-			CNode *pCurrentNode = &m_pNodes[iCurrentNode];
-
-			for( i = 0; i < pCurrentNode->m_cNumLinks; i++ )
-			{
-				// run through all of this node's neighbors
-				iVisitNode = INodeLink( iCurrentNode, i );
-
-				const int iLink = m_pNodes[iCurrentNode].m_iFirstLink + i;
-				if( ( m_pLinkPool[iLink].m_afLinkInfo & iHullMask ) != iHullMask )
-				{
-					// monster is too large to walk this connection
-					//ALERT( at_aiconsole, "fat ass %d/%d\n",m_pLinkPool[iLink].m_afLinkInfo, iMonsterHull );
-					continue;
-				}
-				// check the connection from the current node to the node we're about to mark visited and push into the queue				
-				if( m_pLinkPool[iLink].m_pLinkEnt != NULL )
-				{
-					// there's a brush ent in the way! Don't mark this node or put it into the queue unless the monster can negotiate it
-					if( !HandleLinkEnt( iCurrentNode, m_pLinkPool[iLink].m_pLinkEnt, afCapMask, dynamic ? NODEGRAPH_DYNAMIC : NODEGRAPH_STATIC ) )
-					{
-						// monster should not try to go this way.
-						continue;
-					}
-				}
-				float flOurDistance = flCurrentDistance + m_pLinkPool[iLink].m_flWeight;
-				if(  m_pNodes[iVisitNode].m_flClosestSoFar < -0.5f
-				   || flOurDistance < m_pNodes[iVisitNode].m_flClosestSoFar - 0.001f )
-				{
-					m_pNodes[iVisitNode].m_flClosestSoFar = flOurDistance;
-					m_pNodes[iVisitNode].m_iPreviousNode = iCurrentNode;
-
-					queue.Insert( iVisitNode, flOurDistance );
-				}
-			}
-		}
-		if( m_pNodes[iDest].m_flClosestSoFar < -0.5f )
-		{
-			// Destination is unreachable, no path found.
-			return 0;
-		}
-
-		// the queue is not empty
-		// now we must walk backwards through the m_iPreviousNode field, and count how many connections there are in the path
-		iCurrentNode = iDest;
-		iNumPathNodes = 1;// count the dest
-
-		while( iCurrentNode != iStart )
-		{
-			iNumPathNodes++;
-			iCurrentNode = m_pNodes[iCurrentNode].m_iPreviousNode;
-		}
-
-		iCurrentNode = iDest;
-		for( i = iNumPathNodes - 1; i >= 0; i-- )
-		{
-			if ( i < pathSize)
-				piPath[i] = iCurrentNode;
-			iCurrentNode = m_pNodes[iCurrentNode].m_iPreviousNode;
+			FreeStaticSearchState();
+			g_pflClosestSoFar = new float[m_cNodes];
+			g_piPreviousNode = new int[m_cNodes];
+			g_cSearchNodes = m_cNodes;
 		}
+		iNumPathNodes = StaticShortestPath( piPath, pathSize, iStart, iDest, iHullMask, afCapMask, g_pflClosestSoFar, g_piPreviousNode, NULL );
 	}
 #if 0
 	if( m_fRoutingComplete )
@@ -739,6 +756,111 @@ int CGraph::FindShortestPath(int *piPath, int pathSize, int iStart, int iDest, i
 	return iNumPathNodes;
 }
 
+//=========================================================
+// CGraph - StaticShortestPath - Dijkstra search the routing
+// tables are built from. The search state is supplied by
+// the caller, so several searches can run at once.
+// pLinkAllowed holds precomputed static answers of link
+// ents for afCapMask, or NULL to ask the link ents.
+//=========================================================
+int CGraph::StaticShortestPath( int *piPath, int pathSize, int iStart, int iDest, int iHullMask, int afCapMask, float *pflClosestSoFar, int *piPreviousNode, const unsigned char *pLinkAllowed )
+{
+	int i;
+	int iVisitNode;
+	int iCurrentNode;
+	int iNumPathNodes;
+	CQueuePriority queue;
+
+	// Mark all the nodes as unvisited.
+	//
+	for( i = 0; i < m_cNodes; i++ )
+	{
+		pflClosestSoFar[i] = -1.0f;
+	}
+
+	pflClosestSoFar[iStart] = 0.0;
+	piPreviousNode[iStart] = iStart;// tag this as the origin node
+	queue.Insert( iStart, 0.0 );// insert start node 
+
+	while( !queue.Empty() )
+	{
+		// now pull a node out of the queue
+		float flCurrentDistance;
+		iCurrentNode = queue.Remove( flCurrentDistance );
+
+		// For straight-line weights, the following Shortcut works. For arbitrary weights,
+		// it doesn't.
+		//
+		if( iCurrentNode == iDest )
+			break;
+
+		CNode *pCurrentNode = &m_pNodes[iCurrentNode];
+
+		for( i = 0; i < pCurrentNode->m_cNumLinks; i++ )
+		{
+			// run through all of this node's neighbors
+			iVisitNode = INodeLink( iCurrentNode, i );
+
+			const int iLink = m_pNodes[iCurrentNode].m_iFirstLink + i;
+			if( ( m_pLinkPool[iLink].m_afLinkInfo & iHullMask ) != iHullMask )
+			{
+				// monster is too large to walk this connection
+				//ALERT( at_aiconsole, "fat ass %d/%d\n",m_pLinkPool[iLink].m_afLinkInfo, iMonsterHull );
+				continue;
+			}
+			// check the connection from the current node to the node we're about to mark visited and push into the queue				
+			if( pLinkAllowed )
+			{
+				if( !pLinkAllowed[iLink] )
+					continue;
+			}
+			else if( m_pLinkPool[iLink].m_pLinkEnt != NULL )
+			{
+				// there's a brush ent in the way! Don't mark this node or put it into the queue unless the monster can negotiate it
+				if( !HandleLinkEnt( iCurrentNode, m_pLinkPool[iLink].m_pLinkEnt, afCapMask, NODEGRAPH_STATIC ) )
+				{
+					// monster should not try to go this way.
+					continue;
+				}
+			}
+			float flOurDistance = flCurrentDistance + m_pLinkPool[iLink].m_flWeight;
+			if(  pflClosestSoFar[iVisitNode] < -0.5f
+			   || flOurDistance < pflClosestSoFar[iVisitNode] - 0.001f )
+			{
+				pflClosestSoFar[iVisitNode] = flOurDistance;
+				piPreviousNode[iVisitNode] = iCurrentNode;
+
+				queue.Insert( iVisitNode, flOurDistance );
+			}
+		}
+	}
+	if( pflClosestSoFar[iDest] < -0.5f )
+	{
+		// Destination is unreachable, no path found.
+		return 0;
+	}
+
+	// the queue is not empty
+	// now we must walk backwards through the previous nodes, and count how many connections there are in the path
+	iCurrentNode = iDest;
+	iNumPathNodes = 1;// count the dest
+
+	while( iCurrentNode != iStart )
+	{
+		iNumPathNodes++;
+		iCurrentNode = piPreviousNode[iCurrentNode];
+	}
+
+	iCurrentNode = iDest;
+	for( i = iNumPathNodes - 1; i >= 0; i-- )
+	{
+		if ( i < pathSize)
+			piPath[i] = iCurrentNode;
+		iCurrentNode = piPreviousNode[iCurrentNode];
+	}
+	return iNumPathNodes;
+}
+
 inline ULONG Hash( void *p, int len )
 {
 	CRC32_t ulCrc;
@@ -779,10 +901,20 @@ void inline UpdateRange( int &minValue, int &maxValue, int Goal, int Best )
 		minValue = Lower;
 }
 
-void CGraph::CheckNode( Vector vecOrigin, int iNode )
+bool CGraph::FNodeVisibleFrom( const Vector &vecOrigin, int iNode )
 {
-	extern cvar_t findnearestnodefix;
+	TraceResult tr;
+
+	Vector vecStart = vecOrigin;
+	if( findnearestnodefix.value )
+		vecStart.z += NODE_HEIGHT;
 
+	UTIL_TraceLine( vecStart, m_pNodes[iNode].m_vecOriginPeek, ignore_monsters, 0, &tr );
+	return tr.flFraction == 1.0f;
+}
+
+void CGraph::CheckNode( Vector vecOrigin, int iNode )
+{
 	// Have we already seen this point before?.
 	//
 	if( m_di[iNode].m_CheckedEvent == m_CheckedCounter )
@@ -794,16 +926,8 @@ void CGraph::CheckNode( Vector vecOrigin, int iNode )
 
 	if( flDist < m_flShortest )
 	{
-		TraceResult tr;
-
-		Vector vecStart = vecOrigin;
-		if (findnearestnodefix.value)
-			vecStart.z += NODE_HEIGHT;
-
 		// make sure that vecOrigin can trace to this node!
-		UTIL_TraceLine( vecStart, m_pNodes[iNode].m_vecOriginPeek, ignore_monsters, 0, &tr );
-
-		if( tr.flFraction == 1.0f )
+		if( FNodeVisibleFrom( vecOrigin, iNode ) )
 		{
 			m_iNearest = iNode;
 			m_flShortest = flDist;
@@ -847,6 +971,9 @@ int CGraph::FindNearestNode( const Vector &vecOrigin, int afNodeTypes )
 		return -1;
 	}
 
+	if( sv_nodegrid.value )
+		return g_NodeLocator.FindNearestNode( *this, vecOrigin, afNodeTypes );
+
 	// Check with the cache
 	//
 	ULONG iHash = ( CACHE_SIZE - 1 ) & Hash( (void *)(const float *)vecOrigin, sizeof(vecOrigin) );
@@ -2383,6 +2510,18 @@ int CGraph::FLoadGraph( const char *szMapName )
 	strcat( szDirName, "/graphs" );
 	CreateDirectoryA( szDirName, NULL );
 
+	// Graphs saved by this dll are mapped and used in place
+	//
+	strcat( szDirName, "/" );
+	strcat( szDirName, szMapName );
+	strcat( szDirName, ".nod" );
+	if( g_GraphFile.Open( szDirName ) )
+	{
+		if( FLoadMappedGraph( g_GraphFile.Data(), g_GraphFile.Size(), true ) )
+			return TRUE;
+		g_GraphFile.Close();
+	}
+
 	strcpy( szFilename, "maps/graphs/" );
 	strcat( szFilename, szMapName );
 	strcat( szFilename, ".nod" );
@@ -2392,6 +2531,14 @@ int CGraph::FLoadGraph( const char *szMapName )
 	if( !aMemFile )
 		return FALSE;
 
+	if( length >= (int)sizeof(int) && *(int *)pMemFile == GRAPH_VERSION_MAPPED )
+	{
+		// not in the game directory, so it can't be mapped
+		const int result = FLoadMappedGraph( aMemFile, length, false );
+		FREE_FILE( aMemFile );
+		return result;
+	}
+
 	// Read the graph version number
 	//
 	length -= sizeof(int);
@@ -2569,14 +2716,137 @@ NoMemory:
 	return FALSE;
 }
 
+//=========================================================
+// CGraph - FLoadMappedGraph - sets the graph up from a .nod
+// file in the sectioned layout. With fInPlace the sections
+// that don't change after loading are used right from
+// pData, which must stay valid until the next InitGraph.
+//=========================================================
+int CGraph::FLoadMappedGraph( byte *pData, int length, bool fInPlace )
+{
+	if( length < (int)sizeof(GraphFileHeader) )
+		return FALSE;
+
+	const GraphFileHeader *pHeader = (const GraphFileHeader *)pData;
+	if( pHeader->version != GRAPH_VERSION_MAPPED )
+		return FALSE;
+
+	if( pHeader->headerSize != sizeof(GraphFileHeader) || pHeader->nodeSize != sizeof(CNode) || pHeader->distInfoSize != sizeof(DIST_INFO) )
+	{
+		ALERT( at_aiconsole, "**ERROR** Graph was written by a different build of the dll\n" );
+		return FALSE;
+	}
+
+	if( pHeader->cNodes < 0 || pHeader->cNodes > MAX_NODES || pHeader->cLinks < 0 || pHeader->nRouteInfo < 0 || pHeader->nHashLinks < 0 )
+	{
+		ALERT( at_aiconsole, "**ERROR** Graph header is corrupted\n" );
+		return FALSE;
+	}
+
+	const int sectionSizes[GRAPH_SECTION_COUNT] = {
+		(int)sizeof(CNode) * pHeader->cNodes,
+		(int)sizeof(GraphFileLink) * pHeader->cLinks,
+		(int)sizeof(DIST_INFO) * pHeader->cNodes,
+		(int)sizeof(GraphFileRanges),
+		(int)sizeof(short) * pHeader->nHashLinks,
+		pHeader->nRouteInfo,
+	};
+
+	for( int i = 0; i < GRAPH_SECTION_COUNT; i++ )
+	{
+		const GraphFileSection &section = pHeader->sections[i];
+		if( section.size != sectionSizes[i] || section.offset < (int)sizeof(GraphFileHeader)
+			|| ( section.offset % GRAPH_SECTION_ALIGN ) != 0 || section.offset > length - section.size )
+		{
+			ALERT( at_aiconsole, "**ERROR** Graph section %d is out of the file\n", i );
+			return FALSE;
+		}
+	}
+
+	m_cNodes = pHeader->cNodes;
+	m_cLinks = pHeader->cLinks;
+	m_nRouteInfo = pHeader->nRouteInfo;
+	m_nHashLinks = pHeader->nHashLinks;
+	memcpy( m_HashPrimes, pHeader->hashPrimes, sizeof(m_HashPrimes) );
+	memcpy( m_RegionMin, pHeader->regionMin, sizeof(m_RegionMin) );
+	memcpy( m_RegionMax, pHeader->regionMax, sizeof(m_RegionMax) );
+
+	const GraphFileRanges *pRanges = (const GraphFileRanges *)( pData + pHeader->sections[GRAPH_SECTION_RANGES].offset );
+	memcpy( m_RangeStart, pRanges->rangeStart, sizeof(m_RangeStart) );
+	memcpy( m_RangeEnd, pRanges->rangeEnd, sizeof(m_RangeEnd) );
+	memset( m_Cache, 0, sizeof(m_Cache) );
+
+	byte *pNodes = pData + pHeader->sections[GRAPH_SECTION_NODES].offset;
+	byte *pHashLinks = pData + pHeader->sections[GRAPH_SECTION_HASH_LINKS].offset;
+	byte *pRouteInfo = pData + pHeader->sections[GRAPH_SECTION_ROUTE_INFO].offset;
+	if( fInPlace && m_cNodes && m_nHashLinks && m_nRouteInfo )
+	{
+		m_pNodes = (CNode *)pNodes;
+		m_pHashLinks = (short *)pHashLinks;
+		m_pRouteInfo = (signed char *)pRouteInfo;
+	}
+	else
+	{
+		m_pNodes = (CNode *)calloc( sizeof(CNode), m_cNodes );
+		m_pHashLinks = (short *)calloc( sizeof(short), m_nHashLinks );
+		m_pRouteInfo = (signed char *)calloc( sizeof(signed char), m_nRouteInfo );
+		if( !m_pNodes || !m_pHashLinks || !m_pRouteInfo )
+		{
+			ALERT( at_aiconsole, "**ERROR**\nCouldn't malloc the graph!\n" );
+			InitGraph();
+			return FALSE;
+		}
+		memcpy( m_pNodes, pNodes, sizeof(CNode) * m_cNodes );
+		memcpy( m_pHashLinks, pHashLinks, sizeof(short) * m_nHashLinks );
+		memcpy( m_pRouteInfo, pRouteInfo, m_nRouteInfo );
+	}
+
+	// Links and sorting info get changed at run time, so they're always copied
+	//
+	m_pLinkPool = (CLink *)calloc( sizeof(CLink), m_cLinks );
+	m_di = (DIST_INFO *)calloc( sizeof(DIST_INFO), m_cNodes );
+	if( !m_pLinkPool || !m_di )
+	{
+		ALERT( at_aiconsole, "**ERROR**\nCouldn't malloc the graph!\n" );
+		InitGraph();
+		return FALSE;
+	}
+
+	const GraphFileLink *pLinks = (const GraphFileLink *)( pData + pHeader->sections[GRAPH_SECTION_LINKS].offset );
+	for( int i = 0; i < m_cLinks; i++ )
+	{
+		CLink &link = m_pLinkPool[i];
+		link.m_iSrcNode = pLinks[i].iSrcNode;
+		link.m_iDestNode = pLinks[i].iDestNode;
+		link.m_pLinkEnt = pLinks[i].fHasLinkEnt ? UNRESOLVED_LINKENT : NULL;
+		memcpy( link.m_szLinkEntModelname, pLinks[i].szLinkEntModelname, sizeof(link.m_szLinkEntModelname) );
+		link.m_afLinkInfo = pLinks[i].afLinkInfo;
+		link.m_flWeight = pLinks[i].flWeight;
+	}
+
+	memcpy( m_di, pData + pHeader->sections[GRAPH_SECTION_DIST_INFO].offset, sizeof(DIST_INFO) * m_cNodes );
+	m_CheckedCounter = 0;
+	for( int i = 0; i < m_cNodes; i++ )
+	{
+		m_di[i].m_CheckedEvent = 0;
+	}
+
+	m_fGraphPresent = TRUE;
+	m_fGraphPointersSet = FALSE;
+	m_fRoutingComplete = TRUE;
+
+	ALERT( at_aiconsole, "Built graph successfully%s\n", g_GraphFile.Contains( m_pNodes ) ? " (mapped)" : "" );
+	return TRUE;
+}
+
 //=========================================================
 // CGraph - FSaveGraph - It's not rocket science.
 // this WILL overwrite existing files.
 //=========================================================
 int CGraph::FSaveGraph( const char *szMapName )
 {
-	int iVersion = GRAPH_VERSION;
 	char szFilename[MAX_PATH];
+	char szTempFilename[MAX_PATH];
 	FILE *file;
 
 	if( !m_fGraphPresent || !m_fGraphPointersSet )
@@ -2597,44 +2867,118 @@ int CGraph::FSaveGraph( const char *szMapName )
 	strcat( szFilename, szMapName );
 	strcat( szFilename, ".nod" );
 
-	file = fopen( szFilename, "wb" );
+	// Other servers may have the old file mapped, so never write over it in place
+	//
+	strcpy( szTempFilename, szFilename );
+	strcat( szTempFilename, ".tmp" );
 
-	ALERT( at_aiconsole, "Created: %s\n", szFilename );
+	file = fopen( szTempFilename, "wb" );
 
 	if( !file )
 	{
 		// couldn't create
-		ALERT( at_aiconsole, "Couldn't Create: %s\n", szFilename );
+		ALERT( at_aiconsole, "Couldn't Create: %s\n", szTempFilename );
 		return FALSE;
 	}
 	else
 	{
-		// write the version
-		fwrite( &iVersion, sizeof(int), 1, file );
-
-		// write the CGraph class
-		fwrite( this, sizeof(CGraph), 1, file );
+		GraphFileHeader header;
+		memset( &header, 0, sizeof(header) );
+		header.version = GRAPH_VERSION_MAPPED;
+		header.headerSize = sizeof(GraphFileHeader);
+		header.nodeSize = sizeof(CNode);
+		header.distInfoSize = sizeof(DIST_INFO);
+		header.cNodes = m_cNodes;
+		header.cLinks = m_cLinks;
+		header.nRouteInfo = m_pRouteInfo ? m_nRouteInfo : 0;
+		header.nHashLinks = m_pHashLinks ? m_nHashLinks : 0;
+		memcpy( header.hashPrimes, m_HashPrimes, sizeof(header.hashPrimes) );
+		memcpy( header.regionMin, m_RegionMin, sizeof(header.regionMin) );
+		memcpy( header.regionMax, m_RegionMax, sizeof(header.regionMax) );
+
+		const int sectionSizes[GRAPH_SECTION_COUNT] = {
+			(int)sizeof(CNode) * m_cNodes,
+			(int)sizeof(GraphFileLink) * m_cLinks,
+			(int)sizeof(DIST_INFO) * m_cNodes,
+			(int)sizeof(GraphFileRanges),
+			(int)sizeof(short) * header.nHashLinks,
+			header.nRouteInfo,
+		};
+		int offset = sizeof(GraphFileHeader);
+		for( int i = 0; i < GRAPH_SECTION_COUNT; i++ )
+		{
+			offset = ( offset + GRAPH_SECTION_ALIGN - 1 ) & ~( GRAPH_SECTION_ALIGN - 1 );
+			header.sections[i].offset = offset;
+			header.sections[i].size = sectionSizes[i];
+			offset += sectionSizes[i];
+		}
 
-		// write the nodes
-		fwrite( m_pNodes, sizeof(CNode), m_cNodes, file );
+		GraphFileLink *pLinks = (GraphFileLink *)calloc( sizeof(GraphFileLink), m_cLinks + 1 );
+		GraphFileRanges *pRanges = (GraphFileRanges *)calloc( sizeof(GraphFileRanges), 1 );
+		if( !pLinks || !pRanges )
+		{
+			free( pLinks );
+			free( pRanges );
+			fclose( file );
+			remove( szTempFilename );
+			return FALSE;
+		}
 
-		// write the links
-		fwrite( m_pLinkPool, sizeof(CLink), m_cLinks, file );
+		for( int i = 0; i < m_cLinks; i++ )
+		{
+			pLinks[i].iSrcNode = m_pLinkPool[i].m_iSrcNode;
+			pLinks[i].iDestNode = m_pLinkPool[i].m_iDestNode;
+			pLinks[i].fHasLinkEnt = m_pLinkPool[i].m_pLinkEnt != NULL;
+			memcpy( pLinks[i].szLinkEntModelname, m_pLinkPool[i].m_szLinkEntModelname, sizeof(pLinks[i].szLinkEntModelname) );
+			pLinks[i].afLinkInfo = m_pLinkPool[i].m_afLinkInfo;
+			pLinks[i].flWeight = m_pLinkPool[i].m_flWeight;
+		}
+		memcpy( pRanges->rangeStart, m_RangeStart, sizeof(pRanges->rangeStart) );
+		memcpy( pRanges->rangeEnd, m_RangeEnd, sizeof(pRanges->rangeEnd) );
+
+		const void *sectionData[GRAPH_SECTION_COUNT] = {
+			m_pNodes,
+			pLinks,
+			m_di,
+			pRanges,
+			m_pHashLinks,
+			m_pRouteInfo,
+		};
+
+		static const byte padding[GRAPH_SECTION_ALIGN] = {0};
+		fwrite( &header, sizeof(header), 1, file );
+		offset = sizeof(header);
+		for( int i = 0; i < GRAPH_SECTION_COUNT; i++ )
+		{
+			fwrite( padding, 1, header.sections[i].offset - offset, file );
+			if( header.sections[i].size )
+				fwrite( sectionData[i], 1, header.sections[i].size, file );
+			offset = header.sections[i].offset + header.sections[i].size;
+		}
 
-		fwrite( m_di, sizeof(DIST_INFO), m_cNodes, file );
+		free( pLinks );
+		free( pRanges );
 
-		// Write the route info.
-		//
-		if( m_pRouteInfo && m_nRouteInfo )
+		const bool written = !ferror( file );
+		fclose( file );
+		if( !written )
 		{
-			fwrite( m_pRouteInfo, sizeof(signed char), m_nRouteInfo, file );
+			ALERT( at_aiconsole, "Couldn't write: %s\n", szTempFilename );
+			remove( szTempFilename );
+			return FALSE;
 		}
 
-		if( m_pHashLinks && m_nHashLinks )
+#if XASH_WIN32
+		remove( szFilename );
+#endif
+		if( rename( szTempFilename, szFilename ) != 0 )
 		{
-			fwrite( m_pHashLinks, sizeof(short), m_nHashLinks, file );
+			ALERT( at_aiconsole, "Couldn't Create: %s\n", szFilename );
+			remove( szTempFilename );
+			return FALSE;
 		}
-		fclose( file );
+
+		ALERT( at_aiconsole, "Created: %s\n", szFilename );
 		return TRUE;
 	}
 }
@@ -3133,93 +3477,165 @@ void CGraph::BuildRegionTables( void )
 	memset( m_Cache, 0, sizeof(m_Cache) );
 }
 
-void CGraph::ComputeStaticRoutingTables( void )
-{
-	int iFrom;
-	int nRoutes = m_cNodes * m_cNodes;
 #define FROM_TO(x,y) ( ( x ) * m_cNodes + ( y ) )
-	short *Routes = new short[nRoutes];
 
+//=========================================================
+// CGraph - BuildStaticRoutes - fills the uncompressed
+// routing table of one hull/capability pair. Only reads
+// the graph, so the pairs can be built in parallel.
+//=========================================================
+void CGraph::BuildStaticRoutes( short *Routes, int iHull, int iCapMask, const unsigned char *pLinkAllowed )
+{
+	int iFrom;
+	const int iHullMask = HullMask( iHull );
 	int *pMyPath = new int[m_cNodes];
-	unsigned short *BestNextNodes = new unsigned short[m_cNodes];
-	signed char *pRoute = new signed char[m_cNodes*2];
+	float *pflClosestSoFar = new float[m_cNodes];
+	int *piPreviousNode = new int[m_cNodes];
 
-	if( Routes && pMyPath && BestNextNodes && pRoute )
+	// Initialize Routing table to uncalculated.
+	//
+	for( iFrom = 0; iFrom < m_cNodes; iFrom++ )
 	{
-		int nTotalCompressedSize = 0;
-		for( int iHull = 0; iHull < MAX_NODE_HULLS; iHull++ )
+		for( int iTo = 0; iTo < m_cNodes; iTo++ )
 		{
-			for( int iCap = 0; iCap < 2; iCap++ )
+			Routes[FROM_TO( iFrom, iTo )] = -1;
+		}
+	}
+
+	for( iFrom = 0; iFrom < m_cNodes; iFrom++ )
+	{
+		for( int iTo = m_cNodes - 1; iTo >= 0; iTo-- )
+		{
+			if( Routes[FROM_TO( iFrom, iTo )] != -1 )
+				continue;
+
+			int cPathSize;
+			if( iFrom == iTo )
 			{
-				int iCapMask;
-				switch( iCap )
+				pMyPath[0] = iFrom;
+				pMyPath[1] = iTo;
+				cPathSize = 2;
+			}
+			else
+			{
+				cPathSize = StaticShortestPath( pMyPath, m_cNodes, iFrom, iTo, iHullMask, iCapMask, pflClosestSoFar, piPreviousNode, pLinkAllowed );
+			}
+
+			// Use the computed path to update the routing table.
+			//
+			if( cPathSize > 1 )
+			{
+				for( int iNode = 0; iNode < cPathSize - 1; iNode++ )
 				{
-				case 0:
-					iCapMask = 0;
-					break;
-				case 1:
-					iCapMask = bits_CAP_OPEN_DOORS | bits_CAP_AUTO_DOORS | bits_CAP_USE;
-					break;
+					int iStart = pMyPath[iNode];
+					int iNext  = pMyPath[iNode + 1];
+					for( int iNode1 = iNode + 1; iNode1 < cPathSize; iNode1++ )
+					{
+						int iEnd = pMyPath[iNode1];
+						Routes[FROM_TO(iStart, iEnd)] = iNext;
+					}
 				}
-
-				// Initialize Routing table to uncalculated.
+#if 0
+				// Well, at first glance, this should work, but actually it's safer
+				// to be told explictly that you can take a series of node in a
+				// particular direction. Some links don't appear to have links in
+				// the opposite direction.
 				//
-				for( iFrom = 0; iFrom < m_cNodes; iFrom++ )
+				for( iNode = cPathSize-1; iNode >= 1; iNode-- )
 				{
-					for( int iTo = 0; iTo < m_cNodes; iTo++ )
+					int iStart = pMyPath[iNode];
+					int iNext = pMyPath[iNode - 1];
+					for( int iNode1 = iNode-1; iNode1 >= 0; iNode1-- )
 					{
-						Routes[FROM_TO( iFrom, iTo )] = -1;
+						int iEnd = pMyPath[iNode1];
+						Routes[FROM_TO( iStart, iEnd )] = iNext;
 					}
 				}
+#endif
+			}
+			else
+			{
+				Routes[FROM_TO( iFrom, iTo )] = iFrom;
+				Routes[FROM_TO( iTo, iFrom )] = iTo;
+			}
+		}
+	}
 
-				for( iFrom = 0; iFrom < m_cNodes; iFrom++ )
-				{
-					for( int iTo = m_cNodes - 1; iTo >= 0; iTo-- )
-					{
-						if( Routes[FROM_TO( iFrom, iTo )] != -1 )
-							continue;
+	delete[] pMyPath;
+	delete[] pflClosestSoFar;
+	delete[] piPreviousNode;
+}
 
-						int cPathSize = FindShortestPath( pMyPath, m_cNodes, iFrom, iTo, iHull, iCapMask );
+static int RoutingCapMask( int iCap )
+{
+	return iCap ? ( bits_CAP_OPEN_DOORS | bits_CAP_AUTO_DOORS | bits_CAP_USE ) : 0;
+}
 
-						// Use the computed path to update the routing table.
-						//
-						if( cPathSize > 1 )
-						{
-							for( int iNode = 0; iNode < cPathSize - 1; iNode++ )
-							{
-								int iStart = pMyPath[iNode];
-								int iNext  = pMyPath[iNode + 1];
-								for( int iNode1 = iNode + 1; iNode1 < cPathSize; iNode1++ )
-								{
-									int iEnd = pMyPath[iNode1];
-									Routes[FROM_TO(iStart, iEnd)] = iNext;
-								}
-							}
-#if 0
-							// Well, at first glance, this should work, but actually it's safer
-							// to be told explictly that you can take a series of node in a
-							// particular direction. Some links don't appear to have links in
-							// the opposite direction.
-							//
-							for( iNode = cPathSize-1; iNode >= 1; iNode-- )
-							{
-								int iStart = pMyPath[iNode];
-								int iNext = pMyPath[iNode - 1];
-								for( int iNode1 = iNode-1; iNode1 >= 0; iNode1-- )
-								{
-									int iEnd = pMyPath[iNode1];
-									Routes[FROM_TO( iStart, iEnd )] = iNext;
-								}
-							}
-#endif
-						}
-						else
-						{
-							Routes[FROM_TO( iFrom, iTo )] = iFrom;
-							Routes[FROM_TO( iTo, iFrom )] = iTo;
-						}
-					}
+void CGraph::ComputeStaticRoutingTables( void )
+{
+	int iFrom;
+	int nRoutes = m_cNodes * m_cNodes;
+	const int nTables = MAX_NODE_HULLS * 2;
+	short *AllRoutes = new short[nRoutes * nTables];
+	unsigned char *pLinkAllowed = new unsigned char[m_cLinks * 2];
+
+	unsigned short *BestNextNodes = new unsigned short[m_cNodes];
+	signed char *pRoute = new signed char[m_cNodes*2];
+
+	if( AllRoutes && pLinkAllowed && BestNextNodes && pRoute )
+	{
+		// Ask link ents here, the workers can't call into entities.
+		//
+		for( int iCap = 0; iCap < 2; iCap++ )
+		{
+			for( int iNode = 0; iNode < m_cNodes; iNode++ )
+			{
+				for( int i = 0; i < m_pNodes[iNode].m_cNumLinks; i++ )
+				{
+					const int iLink = m_pNodes[iNode].m_iFirstLink + i;
+					entvars_t *pevLinkEnt = m_pLinkPool[iLink].m_pLinkEnt;
+					pLinkAllowed[iCap * m_cLinks + iLink] = !pevLinkEnt || HandleLinkEnt( iNode, pevLinkEnt, RoutingCapMask( iCap ), NODEGRAPH_STATIC );
 				}
+			}
+		}
+
+		// Each hull/capability table is independent of the others. The compression below
+		// goes in the original order, so the result doesn't depend on the number of threads.
+		//
+		const double startTime = CRouteSearch::Clock();
+#if NODE_ROUTING_THREADS
+		std::atomic<int> nextTable( 0 );
+		const auto worker = [&]() {
+			for( int iTable = nextTable++; iTable < nTables; iTable = nextTable++ )
+			{
+				BuildStaticRoutes( AllRoutes + iTable * nRoutes, iTable / 2, RoutingCapMask( iTable % 2 ), pLinkAllowed + ( iTable % 2 ) * m_cLinks );
+			}
+		};
+		const int nThreads = Q_min( (int)std::thread::hardware_concurrency(), nTables );
+		std::thread threads[MAX_NODE_HULLS * 2];
+		for( int i = 1; i < nThreads; i++ )
+		{
+			threads[i] = std::thread( worker );
+		}
+		worker();
+		for( int i = 1; i < nThreads; i++ )
+		{
+			threads[i].join();
+		}
+#else
+		for( int iTable = 0; iTable < nTables; iTable++ )
+		{
+			BuildStaticRoutes( AllRoutes + iTable * nRoutes, iTable / 2, RoutingCapMask( iTable % 2 ), pLinkAllowed + ( iTable % 2 ) * m_cLinks );
+		}
+#endif
+		ALERT( at_aiconsole, "Routes computed in %.2f seconds\n", CRouteSearch::Clock() - startTime );
+
+		int nTotalCompressedSize = 0;
+		for( int iHull = 0; iHull < MAX_NODE_HULLS; iHull++ )
+		{
+			for( int iCap = 0; iCap < 2; iCap++ )
+			{
+				const short *Routes = AllRoutes + ( iHull * 2 + iCap ) * nRoutes;
 
 				for( iFrom = 0; iFrom < m_cNodes; iFrom++ )
 				{
@@ -3420,22 +3836,25 @@ void CGraph::ComputeStaticRoutingTables( void )
 		}
 		ALERT( at_aiconsole, "Size of Routes = %d\n", nTotalCompressedSize );
 	}
-	if( Routes )
-		delete[] Routes;
+	if( AllRoutes )
+		delete[] AllRoutes;
+	if( pLinkAllowed )
+		delete[] pLinkAllowed;
 	if( BestNextNodes )
 		delete[] BestNextNodes;
 	if( pRoute )
 		delete[] pRoute;
-	if( pMyPath )
-		delete[] pMyPath;
-	Routes = 0;
+	AllRoutes = 0;
+	pLinkAllowed = 0;
 	BestNextNodes = 0;
 	pRoute = 0;
-	pMyPath = 0;
 #if 0
 	TestRoutingTables();
 #endif
 	m_fRoutingComplete = TRUE;
+
+	// Queries go through the routing tables from now on
+	FreeStaticSearchState();
 }
 
 // Test those routing tables. Doesn't really work, yet.
@@ -116,6 +116,7 @@ typedef struct
 #endif
 #define GRAPH_VERSION (int)_GRAPH_VERSION
 #define GRAPH_VERSION_RETAIL (int)_GRAPH_VERSION_RETAIL
+#define GRAPH_VERSION_MAPPED (int)( _GRAPH_VERSION + 1 ) // sectioned layout written by FSaveGraph, graphs in the two formats above are still loaded
 
 class CGraph
 {
@@ -174,6 +175,7 @@ public:
 	int		LinkVisibleNodes ( CLink *pLinkPool, FILE *file, int *piBadNode );
 	int		RejectInlineLinks ( CLink *pLinkPool, FILE *file );
 	int		FindShortestPath ( int *piPath, int pathSize, int iStart, int iDest, int iHull, int afCapMask, bool dynamic = false );
+	int		StaticShortestPath ( int *piPath, int pathSize, int iStart, int iDest, int iHullMask, int afCapMask, float *pflClosestSoFar, int *piPreviousNode, const unsigned char *pLinkAllowed );
 	int		FindNearestNode ( const Vector &vecOrigin, CBaseEntity *pEntity );
 	int		FindNearestNode ( const Vector &vecOrigin, int afNodeTypes );
 	//int		FindNearestLink ( const Vector &vecTestPoint, int *piNearestLink, BOOL *pfAlongLine );
@@ -191,12 +193,15 @@ public:
 	
 	int		CheckNODFile(const char *szMapName);
 	int		FLoadGraph(const char *szMapName);
+	int		FLoadMappedGraph(byte *pData, int length, bool fInPlace);
 	int		FSaveGraph(const char *szMapName);
 	int		FSetGraphPointers(void);
 	void	CheckNode(Vector vecOrigin, int iNode);
+	bool	FNodeVisibleFrom(const Vector &vecOrigin, int iNode);
 
 	void    BuildRegionTables(void);
 	void    ComputeStaticRoutingTables(void);
+	void    BuildStaticRoutes(short *Routes, int iHull, int iCapMask, const unsigned char *pLinkAllowed);
 	void    TestRoutingTables(void);
 
 	void	HashInsert(int iSrcNode, int iDestNode, int iKey);
@@ -214,6 +219,21 @@ public:
 			return 1; 
 		return 0; 
 	}
+	inline int	HullMask( int iHull )
+	{
+		switch( iHull )
+		{
+		case NODE_SMALL_HULL:
+			return bits_LINK_SMALL_HULL;
+		case NODE_HUMAN_HULL:
+			return bits_LINK_HUMAN_HULL;
+		case NODE_LARGE_HULL:
+			return bits_LINK_LARGE_HULL;
+		case NODE_FLY_HULL:
+			return bits_LINK_FLY_HULL;
+		}
+		return 0;
+	}
 
 
 	inline	CNode &Node( int i )
@@ -43,6 +43,7 @@
 #include "followers.h"
 #include "common_soundscripts.h"
 #include "error_collector.h"
+#include "spawn_points.h"
 
 #if FEATURE_ROPE
 #include "ropes.h"
@@ -230,6 +231,7 @@ int gmsgStreaks = 0;
 int gmsgSmoke = 0;
 int gmsgSparkShower = 0;
 int gmsgParticleShooter = 0;
+int gmsgBulletVolley = 0;
 
 #if FEATURE_NIGHTVISION
 int gmsgNightvision = 0;
@@ -331,6 +333,7 @@ void LinkUserMessages( void )
 	gmsgSmoke = REG_USER_MSG( "Smoke", -1 );
 	gmsgSparkShower = REG_USER_MSG( "SparkShower", 20 );
 	gmsgParticleShooter = REG_USER_MSG( "Particle", 27 );
+	gmsgBulletVolley = REG_USER_MSG( "BulletVolley", -1 );
 
 #if FEATURE_NIGHTVISION
 	gmsgNightvision = REG_USER_MSG( "Nightvision", 1 );
@@ -3544,26 +3547,15 @@ pt_end:
 #endif
 }
 
-#define SF_SPAWNPOINT_OFF 2
-
 // checks if the spot is clear of players
 BOOL IsSpawnPointValid( CBaseEntity *pPlayer, CBaseEntity *pSpot )
 {
-	CBaseEntity *ent = NULL;
-
 	if( FBitSet(pSpot->pev->spawnflags, SF_SPAWNPOINT_OFF) || !pSpot->IsTriggered( pPlayer ) )
 	{
 		return FALSE;
 	}
 
-	while( ( ent = UTIL_FindEntityInSphere( ent, pSpot->pev->origin, 128 ) ) != NULL )
-	{
-		// if ent is a client, don't spawn on 'em
-		if( ent->IsPlayer() && ent != pPlayer )
-			return FALSE;
-	}
-
-	return TRUE;
+	return !g_SpawnPointRegistry.IsOccupied( pPlayer, pSpot->pev->origin );
 }
 
 DLL_GLOBAL CBaseEntity	*g_pLastSpawn;
@@ -3580,50 +3572,46 @@ Returns the entity to spawn at
 USES AND SETS GLOBAL g_pLastSpawn
 ============
 */
-CBaseEntity* SelectRandomSpawnPoint( CBaseEntity* pPlayer, const char* spawnPointName )
+CBaseEntity* SelectRandomSpawnPoint( CBaseEntity* pPlayer, const char* spawnPointName, int maxRandomSteps )
 {
-	edict_t *player = pPlayer->edict();
-
-	CBaseEntity *pSpot = g_pLastSpawn;
-	// Randomize the start spot
-	for( int i = RANDOM_LONG( 1, 9 ); i > 0; i-- )
-		pSpot = UTIL_FindEntityByClassname( pSpot, spawnPointName );
-	if( !SpawnPointIsOn( pSpot ) )  // skip over the null point
-		pSpot = UTIL_FindEntityByClassname( pSpot, spawnPointName );
-
-	CBaseEntity *pFirstSpot = pSpot;
+	std::vector<EHANDLE>& spots = g_SpawnPointRegistry.EnabledSpawnPoints( spawnPointName );
+	const int spotCount = (int)spots.size();
+	if( !spotCount )
+		return NULL;
 
-	do
+	// Start after the last spawn point in edict order, then randomize the start spot
+	int first = 0;
+	if( g_pLastSpawn )
 	{
-		if( pSpot )
+		const int lastIndex = g_pLastSpawn->entindex();
+		for( ; first < spotCount; first++ )
 		{
-			// check if pSpot is valid
-			if( IsSpawnPointValid( pPlayer, pSpot ) )
-			{
-				if( pSpot->pev->origin == Vector( 0, 0, 0 ) )
-				{
-					pSpot = UTIL_FindEntityByClassname( pSpot, spawnPointName );
-					continue;
-				}
+			CBaseEntity *pSpot = spots[first];
+			if( pSpot && pSpot->entindex() > lastIndex )
+				break;
+		}
+	}
+	first = ( first + RANDOM_LONG( 0, Q_max( maxRandomSteps, 1 ) - 1 ) ) % spotCount;
 
-				// if so, go to pSpot
-				return pSpot;
-			}
+	for( int i = 0; i < spotCount; i++ )
+	{
+		CBaseEntity *pSpot = spots[( first + i ) % spotCount];
+		if( !pSpot )
+			continue;
+
+		// check if pSpot is valid
+		if( IsSpawnPointValid( pPlayer, pSpot ) && pSpot->pev->origin != Vector( 0, 0, 0 ) )
+		{
+			// if so, go to pSpot
+			return pSpot;
 		}
-		// increment pSpot
-		pSpot = UTIL_FindEntityByClassname( pSpot, spawnPointName );
-	} while( pSpot != pFirstSpot ); // loop if we're not back to the start
+	}
 
 	// we haven't found a place to spawn yet,  so kill any guy at the first spawn point and spawn there
+	CBaseEntity *pSpot = spots[first];
 	if( SpawnPointIsOn( pSpot ) )
 	{
-		CBaseEntity *ent = NULL;
-		while( ( ent = UTIL_FindEntityInSphere( ent, pSpot->pev->origin, 128 ) ) != NULL )
-		{
-			// if ent is a client, kill em (unless they are ourselves)
-			if( ent->IsPlayer() && !(ent->edict() == player) )
-				ent->TakeDamage( VARS( INDEXENT( 0 ) ), VARS( INDEXENT( 0 ) ), 300, DMG_GENERIC );
-		}
+		g_SpawnPointRegistry.ClearOccupants( pPlayer, pSpot->pev->origin );
 		return pSpot;
 	}
 	return NULL;
@@ -3632,72 +3620,22 @@ CBaseEntity* SelectRandomSpawnPoint( CBaseEntity* pPlayer, const char* spawnPoin
 edict_t *EntSelectSpawnPoint( CBaseEntity *pPlayer )
 {
 	CBaseEntity *pSpot;
-	edict_t *player;
-
-	int nNumRandomSpawnsToTry = 10;
-
-	player = pPlayer->edict();
 
 	// choose a info_player_deathmatch point
 	if( g_pGameRules->IsCoOp() )
 	{
-		pSpot = SelectRandomSpawnPoint(pPlayer, "info_player_coop");
+		pSpot = SelectRandomSpawnPoint(pPlayer, "info_player_coop", 9);
 		if( pSpot )
 			goto ReturnSpot;
 	}
 	if( g_pGameRules->IsDeathmatch() )
 	{
-		if( !g_pLastSpawn )
-		{
-			nNumRandomSpawnsToTry = 0;
-			CBaseEntity* pEnt = 0;
-
-			while( ( pEnt = UTIL_FindEntityByClassname( pEnt, "info_player_deathmatch" )))
-				nNumRandomSpawnsToTry++;
-		}
-
-		pSpot = g_pLastSpawn;
-		// Randomize the start spot
-		for( int i = RANDOM_LONG( 1, nNumRandomSpawnsToTry - 1 ); i > 0; i-- )
-			pSpot = UTIL_FindEntityByClassname( pSpot, "info_player_deathmatch" );
-		if( FNullEnt( pSpot ) )  // skip over the null point
-			pSpot = UTIL_FindEntityByClassname( pSpot, "info_player_deathmatch" );
-
-		CBaseEntity *pFirstSpot = pSpot;
-
-		do 
-		{
-			if( pSpot )
-			{
-				// check if pSpot is valid
-				if( IsSpawnPointValid( pPlayer, pSpot ) )
-				{
-					if( pSpot->pev->origin == Vector( 0, 0, 0 ) )
-					{
-						pSpot = UTIL_FindEntityByClassname( pSpot, "info_player_deathmatch" );
-						continue;
-					}
-
-					// if so, go to pSpot
-					goto ReturnSpot;
-				}
-			}
-			// increment pSpot
-			pSpot = UTIL_FindEntityByClassname( pSpot, "info_player_deathmatch" );
-		} while( pSpot != pFirstSpot ); // loop if we're not back to the start
+		// On the first spawn spread over all spawn points
+		const int nNumRandomSpawnsToTry = g_pLastSpawn ? 9 : (int)g_SpawnPointRegistry.EnabledSpawnPoints( "info_player_deathmatch" ).size() - 1;
 
-		// we haven't found a place to spawn yet,  so kill any guy at the first spawn point and spawn there
-		if( !FNullEnt( pSpot ) )
-		{
-			CBaseEntity *ent = NULL;
-			while( ( ent = UTIL_FindEntityInSphere( ent, pSpot->pev->origin, 128 ) ) != NULL )
-			{
-				// if ent is a client, kill em (unless they are ourselves)
-				if( ent->IsPlayer() && !(ent->edict() == player) )
-					ent->TakeDamage( VARS( INDEXENT( 0 ) ), VARS( INDEXENT( 0 ) ), 300, DMG_GENERIC );
-			}
+		pSpot = SelectRandomSpawnPoint(pPlayer, "info_player_deathmatch", nNumRandomSpawnsToTry);
+		if( pSpot )
 			goto ReturnSpot;
-		}
 	}
 
 	// If startspot is set, (re)spawn there.
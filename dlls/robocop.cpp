@@ -200,6 +200,8 @@ public:
 	static const NamedSoundScript stepSoundScript;
 
 	static constexpr const char* sparkSoundScript = "RoboCop.Spark";
+
+	SoundScriptHandle m_stepSound;
 };
 
 LINK_ENTITY_TO_CLASS( monster_robocop, CRoboCop )
@@ -623,6 +625,7 @@ void CRoboCop::Precache()
 	RegisterAndPrecacheSoundScript(fistSoundScript);
 	RegisterAndPrecacheSoundScript(laserSoundScript);
 	RegisterAndPrecacheSoundScript(stepSoundScript);
+	m_stepSound = ResolveSoundScript(stepSoundScript);
 
 	SoundScriptParamOverride param;
 	param.OverrideChannel(CHAN_VOICE);
@@ -720,7 +723,7 @@ void CRoboCop::HandleAnimEvent( MonsterEvent_t *pEvent )
 	case ROBOCOP_AE_RIGHT_FOOT:
 	case ROBOCOP_AE_LEFT_FOOT:
 		UTIL_ScreenShake( pev->origin, 4.0f, 3.0f, 1.0f, 250.0f );
-		EmitSoundScript(stepSoundScript);
+		EmitSoundScript(m_stepSound, stepSoundScript);
 		break;
 	case ROBOCOP_AE_FIST:
 		FistAttack();
@@ -36,79 +36,21 @@
 const float RopeFrameRate = 100.f;
 const float RopeForceMultiplier = 50.f;
 
-/**
-*	Data for a single rope joint.
-*/
-struct RopeSampleData
-{
-	Vector mPosition;
-	Vector mVelocity;
-	Vector mForce;
-	Vector mExternalForce;
-
-	bool mApplyExternalForce;
-	float mMassReciprocal;
-	float restLength;
-};
-
-#define MAX_LIST_SEGMENTS	5
-RopeSampleData g_pTempList[MAX_LIST_SEGMENTS][MAX_SEGMENTS];
-
-/**
-*	Represents a single joint in a rope. There are numSegments + 1 samples in a rope.
-*/
-class CRopeSample : public CBaseEntity
-{
-public:
-
-	void Spawn();
-	virtual int		Save( CSave &save );
-	virtual int		Restore( CRestore &restore );
-	static	TYPEDESCRIPTION m_SaveData[];
-
-	int ObjectCaps() {
-		if (FBitSet(pev->spawnflags, SF_ROPE_NO_TRANSITION))
-			return CBaseEntity::ObjectCaps() & ~FCAP_ACROSS_TRANSITION;
-		else
-			return CBaseEntity::ObjectCaps();
-	}
-
-	static CRopeSample* CreateSample();
-
-	RopeSampleData& GetData()
-	{
-		return data;
-	}
-
-	RopeSampleData& GetSourceData() {
-		if (swapped)
-			return data2;
-		else
-			return data;
-	}
-	RopeSampleData& GetTargetData() {
-		if (swapped)
-			return data;
-		else
-			return data2;
-	}
-
-	void Swap()
-	{
-		swapped = !swapped;
-	}
+#define ROPE_SLEEP_SPEED	1.0f	// samples slower than this are considered resting
+#define ROPE_SLEEP_THINKS	50		// resting thinks before the simulation stops
 
-	void ResetSwap()
-	{
-		swapped = FALSE;
-	}
+const float RopeSleepThinkInterval = 0.05f;
 
-private:
-	RopeSampleData data;
-	RopeSampleData data2;
-	BOOL swapped;
-};
+static_assert( sizeof( Vector ) == sizeof( float ) * 3, "Rope integration treats Vector arrays as float arrays" );
 
+// Scratch state for RK4Integrate, shared by all ropes
+static Vector g_RopeMidPositions[ MAX_SAMPLES ];
+static Vector g_RopeMidVelocities[ MAX_SAMPLES ];
+static Vector g_RopeForces[ MAX_SAMPLES ];
+static Vector g_RopePositionChanges[ MAX_SAMPLES ];
+static Vector g_RopeVelocityChanges[ MAX_SAMPLES ];
+static Vector g_RopeSpringForces[ MAX_SEGMENTS ];
+static float g_RopeMassReciprocals[ MAX_SAMPLES * 3 ];
 
 class CRopeSegment : public CBaseAnimating
 {
@@ -132,9 +74,10 @@ public:
 		pev->origin = pos;
 	}
 
-	static CRopeSegment* CreateSegment(CRopeSample* pSample, string_t iszModelName , CRope *rope);
+	static CRopeSegment* CreateSegment(int iSample, string_t iszModelName , CRope *rope);
 
-	CRopeSample* GetSample() { return m_Sample; }
+	int GetSample() const { return m_iSample; }
+	void SetSample( int iSample ) { m_iSample = iSample; }
 
 	void ApplyExternalForce( const Vector& vecForce );
 
@@ -154,9 +97,8 @@ public:
 
 
 private:
-	CRopeSample* m_Sample;
+	int m_iSample;
 	string_t mModelName;
-	float mDefaultMass;
 	bool mCauseDamage;
 	bool mCanBeGrabbed;
 	CRope* mMasterRope;
@@ -188,7 +130,13 @@ TYPEDESCRIPTION	CRope::m_SaveData[] =
 	DEFINE_FIELD( CRope, detachDelay, FIELD_FLOAT ),
 	DEFINE_ARRAY( CRope, seg, FIELD_CLASSPTR, MAX_SEGMENTS ),
 	DEFINE_ARRAY( CRope, altseg, FIELD_CLASSPTR, MAX_SEGMENTS ),
-	DEFINE_ARRAY( CRope, m_Samples, FIELD_CLASSPTR, MAX_SAMPLES ),
+	DEFINE_ARRAY( CRope, m_SamplePositions, FIELD_POSITION_VECTOR, MAX_SAMPLES ),
+	DEFINE_ARRAY( CRope, m_SampleVelocities, FIELD_VECTOR, MAX_SAMPLES ),
+	DEFINE_ARRAY( CRope, m_SampleExternalForces, FIELD_VECTOR, MAX_SAMPLES ),
+	DEFINE_ARRAY( CRope, m_SampleMassReciprocals, FIELD_FLOAT, MAX_SAMPLES ),
+	DEFINE_ARRAY( CRope, m_SampleRestLengths, FIELD_FLOAT, MAX_SAMPLES ),
+	DEFINE_FIELD( CRope, m_bSleeping, FIELD_CHARACTER ),
+	DEFINE_FIELD( CRope, m_iQuietThinks, FIELD_INTEGER ),
 	DEFINE_FIELD( CRope, mDisallowPlayerAttachment, FIELD_INTEGER ),
 	DEFINE_FIELD( CRope, mBodyModel, FIELD_STRING ),
 	DEFINE_FIELD( CRope, mEndingModel, FIELD_STRING ),
@@ -197,10 +145,58 @@ TYPEDESCRIPTION	CRope::m_SaveData[] =
 	DEFINE_FIELD( CRope, m_activated, FIELD_CHARACTER ),
 };
 
-IMPLEMENT_SAVERESTORE( CRope, CBaseDelay )
+int CRope::Save( CSave &save )
+{
+	if( !CBaseDelay::Save( save ) )
+		return 0;
+	return save.WriteFields( "CRope", this, m_SaveData, ARRAYSIZE( m_SaveData ) );
+}
+
+int CRope::Restore( CRestore &restore )
+{
+	if( !CBaseDelay::Restore( restore ) )
+		return 0;
+	const int status = restore.ReadFields( "CRope", this, m_SaveData, ARRAYSIZE( m_SaveData ) );
+
+	// Saves made before the samples moved into the rope have none of the sample arrays.
+	// The segments restore after the rope, so the samples are rebuilt on the next think.
+	m_bRebuildSamples = false;
+	if( m_NumSamples > 0 )
+	{
+		m_bRebuildSamples = true;
+		for( int i = 0; i < m_NumSamples; ++i )
+		{
+			if( m_SampleRestLengths[ i ] != 0 )
+			{
+				m_bRebuildSamples = false;
+				break;
+			}
+		}
+	}
+
+	return status;
+}
 
 LINK_ENTITY_TO_CLASS( env_rope, CRope )
 
+// Samples used to be separate entities. Older saves still have them, so they are restored and removed.
+class CRopeSample : public CBaseEntity
+{
+public:
+	int ObjectCaps() { return CBaseEntity::ObjectCaps() & ~FCAP_ACROSS_TRANSITION; }
+	virtual int Restore( CRestore &restore );
+};
+
+int CRopeSample::Restore( CRestore &restore )
+{
+	const int status = CBaseEntity::Restore( restore );
+	SetThink( &CBaseEntity::SUB_Remove );
+	pev->nextthink = gpGlobals->time + 0.1;
+	return status;
+}
+
+LINK_ENTITY_TO_CLASS( rope_sample, CRopeSample )
+
 void CRope::KeyValue( KeyValueData* pkvd )
 {
 	if( FStrEq( pkvd->szKeyName, "segments" ) )
@@ -246,7 +242,6 @@ void CRope::Precache()
 	CBaseDelay::Precache();
 
 	UTIL_PrecacheOther( "rope_segment" );
-	UTIL_PrecacheOther( "rope_sample" );
 
 	PRECACHE_MODEL(STRING(GetBodyModel()));
 	PRECACHE_MODEL(STRING(GetEndingModel()));
@@ -270,6 +265,9 @@ void CRope::Spawn()
 
 	m_NumSamples = m_iSegments + 1;
 
+	m_bSleeping = false;
+	m_iQuietThinks = 0;
+
 	m_activated = false;
 }
 
@@ -294,22 +292,21 @@ void CRope::InitRope()
 {
 	pev->flags |= FL_ALWAYSTHINK;
 
-	for( int uiSample = 0; uiSample < m_NumSamples; ++uiSample )
+	for( int uiSample = 0; uiSample < MAX_SAMPLES; ++uiSample )
 	{
-		m_Samples[ uiSample ] = CRopeSample::CreateSample();
-		UTIL_SetOrigin(m_Samples[ uiSample ]->pev, pev->origin);
-		if (FBitSet(pev->spawnflags, SF_ROPE_NO_TRANSITION))
-			m_Samples[ uiSample ]->pev->spawnflags |= SF_ROPE_NO_TRANSITION;
+		m_SamplePositions[ uiSample ] = pev->origin;
+		m_SampleVelocities[ uiSample ] = g_vecZero;
+		m_SampleExternalForces[ uiSample ] = g_vecZero;
+		m_SampleMassReciprocals[ uiSample ] = 0;
+		m_SampleRestLengths[ uiSample ] = 0;
 	}
 
-	memset( m_Samples + m_NumSamples, 0, sizeof( CRopeSample* ) * ( MAX_SAMPLES - m_NumSamples ) );
-
 	{
-		CRopeSegment* pSegment = seg[ 0 ] = CRopeSegment::CreateSegment( m_Samples[ 0 ], GetBodyModel(), this );
+		CRopeSegment* pSegment = seg[ 0 ] = CRopeSegment::CreateSegment( 0, GetBodyModel(), this );
 
 		pSegment->SetAbsOrigin( pev->origin );
 
-		pSegment = altseg[ 0 ] = CRopeSegment::CreateSegment( m_Samples[ 0 ], GetBodyModel(), this );
+		pSegment = altseg[ 0 ] = CRopeSegment::CreateSegment( 0, GetBodyModel(), this );
 
 		pSegment->SetAbsOrigin( pev->origin );
 	}
@@ -321,14 +318,11 @@ void CRope::InitRope()
 
 	if( m_iSegments > 2 )
 	{
-		CRopeSample** ppCurrentSys = m_Samples;
-
 		for( int uiSeg = 1; uiSeg < m_iSegments - 1; ++uiSeg )
 		{
-			CRopeSample* pSegSample = m_Samples[ uiSeg ];
-			seg[ uiSeg ] = CRopeSegment::CreateSegment( pSegSample, GetBodyModel(), this );
+			seg[ uiSeg ] = CRopeSegment::CreateSegment( uiSeg, GetBodyModel(), this );
 
-			altseg[ uiSeg ] = CRopeSegment::CreateSegment( pSegSample, GetBodyModel(), this );
+			altseg[ uiSeg ] = CRopeSegment::CreateSegment( uiSeg, GetBodyModel(), this );
 
 			CRopeSegment* pCurrent = seg[ uiSeg - 1 ];
 
@@ -345,10 +339,9 @@ void CRope::InitRope()
 		}
 	}
 
-	CRopeSample* pSegSample = m_Samples[ m_iSegments - 1 ];
-	seg[ m_iSegments - 1 ] = CRopeSegment::CreateSegment( pSegSample, GetEndingModel(), this );
+	seg[ m_iSegments - 1 ] = CRopeSegment::CreateSegment( m_iSegments - 1, GetEndingModel(), this );
 
-	altseg[ m_iSegments - 1 ] = CRopeSegment::CreateSegment( pSegSample, GetEndingModel(), this );
+	altseg[ m_iSegments - 1 ] = CRopeSegment::CreateSegment( m_iSegments - 1, GetEndingModel(), this );
 
 	CRopeSegment* pCurrent = seg[ m_iSegments - 2 ];
 
@@ -376,6 +369,17 @@ void CRope::InitRope()
 
 void CRope::RopeThink()
 {
+	if( m_bRebuildSamples )
+		RebuildSamples();
+
+	if( m_bSleeping )
+	{
+		//Nothing is moving, keep the segments where they are.
+		mLastTime = gpGlobals->time;
+		pev->nextthink = gpGlobals->time + RopeSleepThinkInterval;
+		return;
+	}
+
 	m_bToggle = !m_bToggle;
 
 	RunSimOnSamples();
@@ -401,9 +405,66 @@ void CRope::RopeThink()
 		Creak();
 	}
 
+	UpdateSleepState();
+
 	pev->nextthink = gpGlobals->time + (1 / RopeFrameRate);
 }
 
+void CRope::UpdateSleepState()
+{
+	if( mObjectAttached )
+	{
+		m_iQuietThinks = 0;
+		return;
+	}
+
+	for( int uiIndex = 0; uiIndex < m_NumSamples; ++uiIndex )
+	{
+		const Vector& vecVelocity = m_SampleVelocities[ uiIndex ];
+
+		if( m_SampleExternalForces[ uiIndex ] != g_vecZero
+			|| DotProduct( vecVelocity, vecVelocity ) > ROPE_SLEEP_SPEED * ROPE_SLEEP_SPEED )
+		{
+			m_iQuietThinks = 0;
+			return;
+		}
+	}
+
+	if( ++m_iQuietThinks >= ROPE_SLEEP_THINKS )
+	{
+		m_bSleeping = true;
+	}
+}
+
+void CRope::WakeUp()
+{
+	if( m_bSleeping )
+	{
+		m_bSleeping = false;
+		mLastTime = gpGlobals->time;
+		pev->nextthink = gpGlobals->time + 0.01;
+	}
+
+	m_iQuietThinks = 0;
+}
+
+void CRope::RebuildSamples()
+{
+	m_bRebuildSamples = false;
+
+	for( int uiSeg = 0; uiSeg < m_iSegments; ++uiSeg )
+	{
+		seg[ uiSeg ]->SetSample( uiSeg );
+		altseg[ uiSeg ]->SetSample( uiSeg );
+	}
+
+	InitializeRopeSim();
+
+	m_bSleeping = false;
+	m_iQuietThinks = 0;
+	mLastTime = gpGlobals->time;
+}
+
 void CRope::InitializeRopeSim()
 {
 	int uiIndex;
@@ -411,29 +472,20 @@ void CRope::InitializeRopeSim()
 	for( int uiSeg = 0; uiSeg < m_iSegments; ++uiSeg )
 	{
 		CRopeSegment* pSegment = seg[ uiSeg ];
-		CRopeSample* pSample = pSegment->GetSample();
-
-		RopeSampleData& data = pSample->GetData();
 
-		data.mPosition = pSegment->pev->origin;
+		m_SamplePositions[ uiSeg ] = pSegment->pev->origin;
 
-		data.mVelocity				= g_vecZero;
-		data.mForce					= g_vecZero;
-		data.mMassReciprocal		= 1;
-		data.mApplyExternalForce	= false;
-		data.mExternalForce			= g_vecZero;
+		m_SampleVelocities[ uiSeg ]			= g_vecZero;
+		m_SampleMassReciprocals[ uiSeg ]	= 1;
+		m_SampleExternalForces[ uiSeg ]		= g_vecZero;
 
 		Vector vecOrigin, vecAngles;
 		pSegment->GetAttachment( 0, vecOrigin, vecAngles );
-		data.restLength = ( pSegment->pev->origin - vecOrigin ).Length();
+		m_SampleRestLengths[ uiSeg ] = ( pSegment->pev->origin - vecOrigin ).Length();
 	}
 
-	{
-		//Zero out the anchored segment's mass so it stays in place.
-		CRopeSample *pSample = m_Samples[ 0 ];
-
-		pSample->GetData().mMassReciprocal = 0;
-	}
+	//Zero out the anchored segment's mass so it stays in place.
+	m_SampleMassReciprocals[ 0 ] = 0;
 
 	CRopeSegment* pSegment = seg[ m_iSegments - 1 ];
 
@@ -449,21 +501,17 @@ void CRope::InitializeRopeSim()
 
 	vecOrigin = vecGravity * flLength + pSegment->pev->origin;
 
-	CRopeSample* pSample = m_Samples[ m_NumSamples - 1 ];
+	const int iLastSample = m_NumSamples - 1;
 
-	RopeSampleData& data = pSample->GetData();
-
-	data.mPosition = vecOrigin;
+	m_SamplePositions[ iLastSample ] = vecOrigin;
 
 	m_LastEndPos = vecOrigin;
 
-	data.mVelocity = g_vecZero;
-
-	data.mForce = g_vecZero;
+	m_SampleVelocities[ iLastSample ] = g_vecZero;
 
-	data.mMassReciprocal = 0.2;
+	m_SampleMassReciprocals[ iLastSample ] = 0.2;
 
-	data.mApplyExternalForce = false;
+	m_SampleExternalForces[ iLastSample ] = g_vecZero;
 
 	int uiNumSegs = ROPE_IGNORE_SAMPLES;
 
@@ -490,200 +538,137 @@ void CRope::RunSimOnSamples()
 
 	int uiIndex = 0;
 
-	bool swapped = false;
 	while( true )
 	{
 		++uiIndex;
 
-		ComputeForces( m_Samples );
-		RK4Integrate( flDeltaTime );
-
 		mLastTime += 0.007;
 
-		if( gpGlobals->time <= mLastTime )
+		//The samples used to be double buffered and the result of the final, odd step was never read back,
+		//so that step is skipped. It still used up the pending external forces.
+		if( gpGlobals->time <= mLastTime && ( uiIndex % 2 ) != 0 )
 		{
-			if( ( uiIndex % 2 ) != 0 )
-				break;
-		}
-
-		for (int i=0; i<m_NumSamples; ++i)
-		{
-			m_Samples[i]->Swap();
+			for( int uiSample = 0; uiSample < m_NumSamples; ++uiSample )
+			{
+				m_SampleExternalForces[ uiSample ] = g_vecZero;
+			}
+			break;
 		}
-		swapped = !swapped;
-	}
 
-	if (swapped)
-	{
-		for (int i=0; i<m_NumSamples; ++i)
-		{
-			m_Samples[i]->ResetSwap();
-		}
+		RK4Integrate( flDeltaTime );
 	}
 
 	mLastTime = gpGlobals->time;
 }
 
-void CRope::ComputeForces( RopeSampleData* pSystem )
+void CRope::ComputeForces( const Vector* pPositions, const Vector* pVelocities, Vector* pForces, bool bApplyExternalForces )
 {
 	int uiIndex;
-	for( uiIndex = 0; uiIndex < m_NumSamples; ++uiIndex )
-	{
-		ComputeSampleForce( pSystem[ uiIndex ] );
-	}
-
-	for( uiIndex = 0; uiIndex < m_iSegments; ++uiIndex )
-	{
-		ComputeSpringForce( pSystem[ uiIndex ], pSystem[ uiIndex+1 ] );
-	}
-}
 
-void CRope::ComputeForces( CRopeSample** ppSystem )
-{
-	int uiIndex;
+	//Per sample forces: gravity, external forces and drag.
 	for( uiIndex = 0; uiIndex < m_NumSamples; ++uiIndex )
 	{
-		ComputeSampleForce( ppSystem[ uiIndex ]->GetSourceData() );
-	}
+		const Vector& vecVelocity = pVelocities[ uiIndex ];
 
-	for( uiIndex = 0; uiIndex < m_iSegments; ++uiIndex )
-	{
-		ComputeSpringForce( ppSystem[ uiIndex ]->GetSourceData(), ppSystem[ uiIndex+1 ]->GetSourceData() );
-	}
-}
+		Vector vecForce = m_SampleMassReciprocals[ uiIndex ] != 0.0 ? m_Gravity / m_SampleMassReciprocals[ uiIndex ] : g_vecZero;
 
-void CRope::ComputeSampleForce( RopeSampleData& data )
-{
-	data.mForce = g_vecZero;
-
-	if( data.mMassReciprocal != 0.0 )
-	{
-		data.mForce = data.mForce + ( m_Gravity / data.mMassReciprocal );
-	}
+		if( bApplyExternalForces )
+		{
+			vecForce = vecForce + m_SampleExternalForces[ uiIndex ];
+			m_SampleExternalForces[ uiIndex ] = g_vecZero;
+		}
 
-	if( data.mApplyExternalForce )
-	{
-		data.mForce = data.mForce + data.mExternalForce;
+		const float flDrag = DotProduct( m_Gravity, vecVelocity ) >= 0 ? -0.04f : -1.0f;
 
-		data.mExternalForce = g_vecZero;
-		data.mApplyExternalForce = false;
+		pForces[ uiIndex ] = vecForce + vecVelocity * flDrag;
 	}
 
-	if( DotProduct( m_Gravity, data.mVelocity ) >= 0 )
-	{
-		data.mForce = data.mForce + data.mVelocity * -0.04;
-	}
-	else
+	//Spring forces are computed per segment first so neither loop depends on the previous iteration.
+	for( uiIndex = 0; uiIndex < m_iSegments; ++uiIndex )
 	{
-		data.mForce = data.mForce - data.mVelocity;
-	}
-}
+		const Vector vecDist = pPositions[ uiIndex ] - pPositions[ uiIndex + 1 ];
 
-void CRope::ComputeSpringForce( RopeSampleData& first, RopeSampleData& second )
-{
-	Vector vecDist = first.mPosition - second.mPosition;
-
-	const double flDistance = vecDist.Length();
-
-	const double flForce = ( flDistance - first.restLength ) * HOOK_CONSTANT;
+		const float flDistance = vecDist.Length();
 
-	const double flNewRelativeDist = DotProduct( first.mVelocity - second.mVelocity, vecDist ) * SPRING_DAMPING;
+		const float flForce = ( flDistance - m_SampleRestLengths[ uiIndex ] ) * HOOK_CONSTANT;
 
-	vecDist = vecDist.Normalize();
+		const float flNewRelativeDist = DotProduct( pVelocities[ uiIndex ] - pVelocities[ uiIndex + 1 ], vecDist ) * SPRING_DAMPING;
 
-	const double flSpringFactor = -( flNewRelativeDist / flDistance + flForce );
+		const float flSpringFactor = -( flNewRelativeDist / flDistance + flForce );
 
-	const Vector vecForce = flSpringFactor * vecDist;
-
-	first.mForce = first.mForce + vecForce;
+		g_RopeSpringForces[ uiIndex ] = flSpringFactor * vecDist.Normalize();
+	}
 
-	second.mForce = second.mForce - vecForce;
+	for( uiIndex = 0; uiIndex < m_iSegments; ++uiIndex )
+	{
+		pForces[ uiIndex ] = pForces[ uiIndex ] + g_RopeSpringForces[ uiIndex ];
+		pForces[ uiIndex + 1 ] = pForces[ uiIndex + 1 ] - g_RopeSpringForces[ uiIndex ];
+	}
 }
 
 void CRope::RK4Integrate( const float flDeltaTime )
 {
-	const float flDeltas[ MAX_LIST_SEGMENTS - 1 ] =
-	{
-		flDeltaTime * 0.5f,
-		flDeltaTime * 0.5f,
-		flDeltaTime * 0.5f,
-		flDeltaTime
-	};
+	//The stages work on the sample arrays as flat float arrays so the loops can be vectorized.
+	const int iCount = m_NumSamples * 3;
 
-	{
-		RopeSampleData* pTemp1 = g_pTempList[ 0 ];
-		RopeSampleData* pTemp2 = g_pTempList[ 1 ];
+	const float flHalfDelta = flDeltaTime * 0.5f;
 
-		for( int uiIndex = 0; uiIndex < m_NumSamples; ++uiIndex, ++pTemp1, ++pTemp2 )
-		{
-			RopeSampleData& data = m_Samples[ uiIndex ]->GetSourceData();
-
-			pTemp2->mForce = data.mMassReciprocal * data.mForce * flDeltas[ 0 ];
-			pTemp2->mVelocity = data.mVelocity * flDeltas[ 0 ];
-			pTemp2->restLength = data.restLength;
+	float* pflPositions = m_SamplePositions[ 0 ];
+	float* pflVelocities = m_SampleVelocities[ 0 ];
+	float* pflMidPositions = g_RopeMidPositions[ 0 ];
+	float* pflMidVelocities = g_RopeMidVelocities[ 0 ];
+	float* pflPositionChanges = g_RopePositionChanges[ 0 ];
+	float* pflVelocityChanges = g_RopeVelocityChanges[ 0 ];
+	const float* pflForces = g_RopeForces[ 0 ];
 
-			pTemp1->mMassReciprocal = data.mMassReciprocal;
-			pTemp1->mVelocity = data.mVelocity + pTemp2->mForce;
-			pTemp1->mPosition = data.mPosition + pTemp2->mVelocity;
-			pTemp1->restLength = data.restLength;
-		}
-
-		ComputeForces( g_pTempList[ 0 ] );
-	}
-
-	for( int uiStep = 2; uiStep < MAX_LIST_SEGMENTS - 1; ++uiStep )
+	for( int uiIndex = 0; uiIndex < m_NumSamples; ++uiIndex )
 	{
-		RopeSampleData* pTemp1 = g_pTempList[ 0 ];
-		RopeSampleData* pTemp2 = g_pTempList[ uiStep ];
+		g_RopeMassReciprocals[ uiIndex * 3 ] = g_RopeMassReciprocals[ uiIndex * 3 + 1 ] = g_RopeMassReciprocals[ uiIndex * 3 + 2 ] = m_SampleMassReciprocals[ uiIndex ];
+	}
 
-		for( int uiIndex = 0; uiIndex < m_NumSamples; ++uiIndex, ++pTemp1, ++pTemp2 )
-		{
-			RopeSampleData& data = m_Samples[ uiIndex ]->GetSourceData();
+	//First stage, evaluated at the current state.
+	ComputeForces( m_SamplePositions, m_SampleVelocities, g_RopeForces, true );
 
-			pTemp2->mForce = data.mMassReciprocal * pTemp1->mForce * flDeltas[ uiStep - 1 ];
-			pTemp2->mVelocity = pTemp1->mVelocity * flDeltas[ uiStep - 1 ];
-			pTemp2->restLength = data.restLength;
+	for( int i = 0; i < iCount; ++i )
+	{
+		const float flVelocityChange = g_RopeMassReciprocals[ i ] * pflForces[ i ] * flHalfDelta;
+		const float flPositionChange = pflVelocities[ i ] * flHalfDelta;
 
-			pTemp1->mMassReciprocal = data.mMassReciprocal;
-			pTemp1->mVelocity = data.mVelocity + pTemp2->mForce;
-			pTemp1->mPosition = data.mPosition + pTemp2->mVelocity;
-			pTemp1->restLength = data.restLength;
-		}
+		pflVelocityChanges[ i ] = flVelocityChange;
+		pflPositionChanges[ i ] = flPositionChange;
 
-		ComputeForces( g_pTempList[ 0 ] );
+		pflMidVelocities[ i ] = pflVelocities[ i ] + flVelocityChange;
+		pflMidPositions[ i ] = pflPositions[ i ] + flPositionChange;
 	}
 
+	//Second and third stages, both evaluated half a step ahead.
+	for( int uiStep = 0; uiStep < 2; ++uiStep )
 	{
-		RopeSampleData* pTemp1 = g_pTempList[ 0 ];
-		RopeSampleData* pTemp2 = g_pTempList[ 4 ];
+		ComputeForces( g_RopeMidPositions, g_RopeMidVelocities, g_RopeForces, false );
 
-		for( int uiIndex = 0; uiIndex < m_NumSamples; ++uiIndex, ++pTemp1, ++pTemp2 )
+		for( int i = 0; i < iCount; ++i )
 		{
-			RopeSampleData& data = m_Samples[ uiIndex ]->GetSourceData();
+			const float flVelocityChange = g_RopeMassReciprocals[ i ] * pflForces[ i ] * flHalfDelta;
+			const float flPositionChange = pflMidVelocities[ i ] * flHalfDelta;
 
-			pTemp2->mForce = data.mMassReciprocal * pTemp1->mForce * flDeltas[ 3 ];
+			pflVelocityChanges[ i ] += flVelocityChange * 2;
+			pflPositionChanges[ i ] += flPositionChange * 2;
 
-			pTemp2->mVelocity = pTemp1->mVelocity * flDeltas[ 3 ];
+			pflMidVelocities[ i ] = pflVelocities[ i ] + flVelocityChange;
+			pflMidPositions[ i ] = pflPositions[ i ] + flPositionChange;
 		}
 	}
 
-	RopeSampleData* pTemp1 = g_pTempList[ 1 ];
-	RopeSampleData* pTemp2 = g_pTempList[ 2 ];
-	RopeSampleData* pTemp3 = g_pTempList[ 3 ];
-	RopeSampleData* pTemp4 = g_pTempList[ 4 ];
+	//Fourth stage, then combine.
+	ComputeForces( g_RopeMidPositions, g_RopeMidVelocities, g_RopeForces, false );
 
-	for( int uiIndex = 0; uiIndex < m_NumSamples; ++uiIndex, ++pTemp1, ++pTemp2, ++pTemp3, ++pTemp4 )
+	for( int i = 0; i < iCount; ++i )
 	{
-		RopeSampleData& pSource = m_Samples[ uiIndex ]->GetSourceData();
-		RopeSampleData& pTarget = m_Samples[ uiIndex ]->GetTargetData();
-
-		const Vector vecPosChange = 1.0f / 6.0f * ( pTemp1->mVelocity + ( pTemp2->mVelocity + pTemp3->mVelocity ) * 2 + pTemp4->mVelocity );
-
-		const Vector vecVelChange = 1.0f / 6.0f * ( pTemp1->mForce + ( pTemp2->mForce + pTemp3->mForce ) * 2 + pTemp4->mForce );
-
-		pTarget.mPosition = pSource.mPosition + ( vecPosChange );//* flDeltaTime );
+		pflVelocityChanges[ i ] += g_RopeMassReciprocals[ i ] * pflForces[ i ] * flDeltaTime;
+		pflPositionChanges[ i ] += pflMidVelocities[ i ] * flDeltaTime;
 
-		pTarget.mVelocity = pSource.mVelocity + ( vecVelChange );//* flDeltaTime );
+		pflPositions[ i ] += pflPositionChanges[ i ] * ( 1.0f / 6.0f );
+		pflVelocities[ i ] += pflVelocityChanges[ i ] * ( 1.0f / 6.0f );
 	}
 }
 
@@ -726,8 +711,8 @@ void CRope::TraceModels( CRopeSegment** ppPrimarySegs, CRopeSegment** ppHiddenSe
 		Vector vecAngles;
 
 		GetAlignmentAngles(
-			m_Samples[ 0 ]->GetData().mPosition,
-			m_Samples[ 1 ]->GetData().mPosition,
+			m_SamplePositions[ 0 ],
+			m_SamplePositions[ 1 ],
 			vecAngles );
 
 		( *ppPrimarySegs )->pev->angles = vecAngles;
@@ -739,9 +724,9 @@ void CRope::TraceModels( CRopeSegment** ppPrimarySegs, CRopeSegment** ppHiddenSe
 	{
 		for( unsigned int uiSeg = 1; uiSeg < m_iSegments; ++uiSeg )
 		{
-			CRopeSample* pSample = m_Samples[ uiSeg ];
+			const Vector& vecPosition = m_SamplePositions[ uiSeg ];
 
-			Vector vecDist = pSample->GetData().mPosition - ppHiddenSegs[ uiSeg ]->pev->origin;
+			Vector vecDist = vecPosition - ppHiddenSegs[ uiSeg ]->pev->origin;
 
 			vecDist = vecDist.Normalize();
 
@@ -750,7 +735,7 @@ void CRope::TraceModels( CRopeSegment** ppPrimarySegs, CRopeSegment** ppHiddenSe
 
 			const Vector vecTraceDist = vecDist * flTraceDist;
 
-			const Vector vecEnd = pSample->GetData().mPosition + vecTraceDist;
+			const Vector vecEnd = vecPosition + vecTraceDist;
 
 			UTIL_TraceLine( ppHiddenSegs[ uiSeg ]->pev->origin, vecEnd, ignore_monsters, edict(), &tr );
 
@@ -769,17 +754,15 @@ void CRope::TraceModels( CRopeSegment** ppPrimarySegs, CRopeSegment** ppHiddenSe
 
 				Vector vecNormal = tr.vecPlaneNormal.Normalize() * 20000.0;
 
-				RopeSampleData& data = ppPrimarySegs[ uiSeg ]->GetSample()->GetData();
+				const int iSample = ppPrimarySegs[ uiSeg ]->GetSample();
 
-				data.mApplyExternalForce = true;
+				m_SampleExternalForces[ iSample ] = vecNormal;
 
-				data.mExternalForce = vecNormal;
-
-				data.mVelocity = g_vecZero;
+				m_SampleVelocities[ iSample ] = g_vecZero;
 			}
 			else
 			{
-				Vector vecOrigin = pSample->GetData().mPosition;
+				Vector vecOrigin = vecPosition;
 
 				TruncateEpsilon( vecOrigin );
 
@@ -791,14 +774,25 @@ void CRope::TraceModels( CRopeSegment** ppPrimarySegs, CRopeSegment** ppHiddenSe
 	{
 		for( unsigned int uiSeg = 1; uiSeg < m_iSegments; ++uiSeg )
 		{
-			UTIL_TraceLine(
-				ppHiddenSegs[ uiSeg ]->pev->origin,
-				m_Samples[ uiSeg ]->GetData().mPosition,
-				ignore_monsters, edict(), &tr );
+			const Vector& vecPosition = m_SamplePositions[ uiSeg ];
+			const Vector vecMove = vecPosition - ppHiddenSegs[ uiSeg ]->pev->origin;
+
+			//Segments that barely moved can't have entered anything since the last trace.
+			if( DotProduct( vecMove, vecMove ) < 0.01f )
+			{
+				tr.flFraction = 1.0;
+			}
+			else
+			{
+				UTIL_TraceLine(
+					ppHiddenSegs[ uiSeg ]->pev->origin,
+					vecPosition,
+					ignore_monsters, edict(), &tr );
+			}
 
 			if( tr.flFraction == 1.0 )
 			{
-				Vector vecOrigin = m_Samples[ uiSeg ]->GetData().mPosition;
+				Vector vecOrigin = vecPosition;
 
 				TruncateEpsilon( vecOrigin );
 
@@ -815,9 +809,7 @@ void CRope::TraceModels( CRopeSegment** ppPrimarySegs, CRopeSegment** ppHiddenSe
 
 				ppPrimarySegs[ uiSeg ]->SetAbsOrigin( vecOrigin );
 
-				ppPrimarySegs[ uiSeg ]->GetSample()->GetData().mApplyExternalForce = true;
-
-				ppPrimarySegs[ uiSeg ]->GetSample()->GetData().mExternalForce = vecNormal * 40000.0;
+				m_SampleExternalForces[ ppPrimarySegs[ uiSeg ]->GetSample() ] = vecNormal * 40000.0;
 			}
 		}
 	}
@@ -836,21 +828,19 @@ void CRope::TraceModels( CRopeSegment** ppPrimarySegs, CRopeSegment** ppHiddenSe
 
 	if( m_iSegments > 1 )
 	{
-		CRopeSample *pSample = m_Samples[ m_NumSamples - 1 ];
+		const int iLastSample = m_NumSamples - 1;
 
-		UTIL_TraceLine( m_LastEndPos, pSample->GetData().mPosition, ignore_monsters, edict(), &tr );
+		UTIL_TraceLine( m_LastEndPos, m_SamplePositions[ iLastSample ], ignore_monsters, edict(), &tr );
 
 		if( tr.flFraction == 1.0 )
 		{
-			m_LastEndPos = pSample->GetData().mPosition;
+			m_LastEndPos = m_SamplePositions[ iLastSample ];
 		}
 		else
 		{
 			m_LastEndPos = tr.vecEndPos;
 
-			pSample->GetData().mApplyExternalForce = true;
-
-			pSample->GetData().mExternalForce = tr.vecPlaneNormal.Normalize() * 40000.0;
+			m_SampleExternalForces[ iLastSample ] = tr.vecPlaneNormal.Normalize() * 40000.0;
 		}
 
 		CRopeSegment *pSegment = ppPrimarySegs[ m_NumSamples - 2 ];
@@ -1013,7 +1003,7 @@ Vector CRope::GetAttachedObjectsVelocity() const
 	if( !mObjectAttached )
 		return g_vecZero;
 
-	return seg[ mAttachedObjectsSegment ]->GetSample()->GetData().mVelocity;
+	return m_SampleVelocities[ seg[ mAttachedObjectsSegment ]->GetSample() ];
 }
 
 void CRope::ApplyForceFromPlayer( const Vector& vecForce )
@@ -1041,18 +1031,26 @@ void CRope::ApplyForceToSegment( const Vector& vecForce, const int uiSegment )
 	{
 		//Apply force to the last sample.
 
-		RopeSampleData& data = m_Samples[ uiSegment - 1 ]->GetData();
+		ApplyForceToSample( vecForce, uiSegment - 1 );
+	}
+}
 
-		data.mExternalForce = data.mExternalForce + vecForce;
+void CRope::ApplyForceToSample( const Vector& vecForce, const int uiSample )
+{
+	if( vecForce == g_vecZero )
+		return;
 
-		data.mApplyExternalForce = true;
-	}
+	m_SampleExternalForces[ uiSample ] = m_SampleExternalForces[ uiSample ] + vecForce;
+
+	WakeUp();
 }
 
 void CRope::AttachObjectToSegment( CRopeSegment* pSegment )
 {
 	mObjectAttached = true;
 
+	WakeUp();
+
 	detachTime = 0;
 	detachDelay = 2.0f;
 
@@ -1082,9 +1080,7 @@ bool CRope::ShouldCreak() const
 {
 	if( mObjectAttached && m_bMakeSound )
 	{
-		CRopeSample* pSample = seg[ mAttachedObjectsSegment ]->GetSample();
-
-		if( pSample->GetData().mVelocity.Length() > 20.0 )
+		if( m_SampleVelocities[ seg[ mAttachedObjectsSegment ]->GetSample() ].Length() > 20.0 )
 			return RANDOM_LONG( 1, 5 ) == 1;
 	}
 
@@ -1132,7 +1128,7 @@ float CRope::GetRopeLength() const
 
 Vector CRope::GetRopeOrigin() const
 {
-	return m_Samples[ 0 ]->GetData().mPosition;
+	return m_SamplePositions[ 0 ];
 }
 
 bool CRope::IsValidSegmentIndex( const int uiSegment ) const
@@ -1145,7 +1141,7 @@ Vector CRope::GetSegmentOrigin( const int uiSegment ) const
 	if( !IsValidSegmentIndex( uiSegment ) )
 		return g_vecZero;
 
-	return m_Samples[ uiSegment ]->GetData().mPosition;
+	return m_SamplePositions[ uiSegment ];
 }
 
 Vector CRope::GetSegmentAttachmentPoint( const int uiSegment ) const
@@ -1181,8 +1177,8 @@ Vector CRope::GetSegmentDirFromOrigin( const int uiSegmentIndex ) const
 
 	//There is one more sample than there are segments, so this is fine.
 	const Vector vecResult =
-		m_Samples[ uiSegmentIndex + 1 ]->GetData().mPosition -
-		m_Samples[ uiSegmentIndex ]->GetData().mPosition;
+		m_SamplePositions[ uiSegmentIndex + 1 ] -
+		m_SamplePositions[ uiSegmentIndex ];
 
 	return vecResult.Normalize();
 }
@@ -1195,7 +1191,7 @@ Vector CRope::GetAttachedObjectsPosition() const
 	Vector vecResult;
 
 	if( mAttachedObjectsSegment < m_iSegments )
-		vecResult = m_Samples[ mAttachedObjectsSegment ]->GetData().mPosition;
+		vecResult = m_SamplePositions[ mAttachedObjectsSegment ];
 
 	vecResult = vecResult +
 		( mAttachedObjectsOffset * GetSegmentDirFromOrigin( mAttachedObjectsSegment ) );
@@ -1205,51 +1201,10 @@ Vector CRope::GetAttachedObjectsPosition() const
 
 
 
-// Global Savedata for player
-TYPEDESCRIPTION	CRopeSample::m_SaveData[] =
-{
-	DEFINE_FIELD( CRopeSample, data.mPosition, FIELD_VECTOR ),
-	DEFINE_FIELD( CRopeSample, data.mVelocity, FIELD_VECTOR ),
-	DEFINE_FIELD( CRopeSample, data.mForce, FIELD_VECTOR ),
-	DEFINE_FIELD( CRopeSample, data.mExternalForce, FIELD_VECTOR ),
-	DEFINE_FIELD( CRopeSample, data.mApplyExternalForce, FIELD_CHARACTER ),
-	DEFINE_FIELD( CRopeSample, data.mMassReciprocal, FIELD_FLOAT ),
-	DEFINE_FIELD( CRopeSample, data.restLength, FIELD_FLOAT ),
-	DEFINE_FIELD( CRopeSample, data2.mPosition, FIELD_VECTOR ),
-	DEFINE_FIELD( CRopeSample, data2.mVelocity, FIELD_VECTOR ),
-	DEFINE_FIELD( CRopeSample, data2.mForce, FIELD_VECTOR ),
-	DEFINE_FIELD( CRopeSample, data2.mExternalForce, FIELD_VECTOR ),
-	DEFINE_FIELD( CRopeSample, data2.mApplyExternalForce, FIELD_CHARACTER ),
-	DEFINE_FIELD( CRopeSample, data2.mMassReciprocal, FIELD_FLOAT ),
-	DEFINE_FIELD( CRopeSample, data2.restLength, FIELD_FLOAT ),
-	DEFINE_FIELD( CRopeSample, swapped, FIELD_BOOLEAN ),
-};
-
-IMPLEMENT_SAVERESTORE(CRopeSample, CBaseEntity)
-
-LINK_ENTITY_TO_CLASS( rope_sample, CRopeSample )
-
-void CRopeSample::Spawn()
-{
-	pev->classname = MAKE_STRING( "rope_sample" );
-	pev->effects |= EF_NODRAW;
-}
-
-CRopeSample* CRopeSample::CreateSample()
-{
-	CRopeSample* pSample = GetClassPtr<CRopeSample>( NULL );
-
-	pSample->Spawn();
-
-	return pSample;
-}
-
-
 TYPEDESCRIPTION	CRopeSegment::m_SaveData[] =
 {
-	DEFINE_FIELD( CRopeSegment, m_Sample, FIELD_CLASSPTR ),
+	DEFINE_FIELD( CRopeSegment, m_iSample, FIELD_INTEGER ),
 	DEFINE_FIELD( CRopeSegment, mModelName, FIELD_STRING ),
-	DEFINE_FIELD( CRopeSegment, mDefaultMass, FIELD_FLOAT ),
 	DEFINE_FIELD( CRopeSegment, mCauseDamage, FIELD_CHARACTER ),
 	DEFINE_FIELD( CRopeSegment, mCanBeGrabbed, FIELD_CHARACTER ),
 	DEFINE_FIELD( CRopeSegment, mMasterRope, FIELD_CLASSPTR ),
@@ -1309,8 +1264,6 @@ void CRopeSegment::Touch( CBaseEntity* pOther )
 		{
 			if( mCanBeGrabbed )
 			{
-				RopeSampleData& data = m_Sample->GetData();
-
 				//pPlayer->SetClosestOriginOnRope(data->mPosition);
 
 				pPlayer->SetOnRopeState( true );
@@ -1322,9 +1275,7 @@ void CRopeSegment::Touch( CBaseEntity* pOther )
 				if( vecVelocity.Length() > 0.5 )
 				{
 					//Apply some external force to move the rope. - Solokiller
-					data.mApplyExternalForce = true;
-
-					data.mExternalForce = data.mExternalForce + vecVelocity * 750;
+					ApplyExternalForce( vecVelocity * 750 );
 				}
 
 				if( GetMasterRope()->IsSoundAllowed() )
@@ -1356,7 +1307,7 @@ void CRopeSegment::Touch( CBaseEntity* pOther )
 	}
 }
 
-CRopeSegment* CRopeSegment::CreateSegment( CRopeSample* pSample, string_t iszModelName, CRope* rope )
+CRopeSegment* CRopeSegment::CreateSegment( int iSample, string_t iszModelName, CRope* rope )
 {
 	CRopeSegment* pSegment = GetClassPtr<CRopeSegment>( NULL );
 
@@ -1364,11 +1315,10 @@ CRopeSegment* CRopeSegment::CreateSegment( CRopeSample* pSample, string_t iszMod
 
 	pSegment->Spawn();
 
-	pSegment->m_Sample = pSample;
+	pSegment->m_iSample = iSample;
 
 	pSegment->mCauseDamage = false;
 	pSegment->mCanBeGrabbed = true;
-	pSegment->mDefaultMass = pSample->GetData().mMassReciprocal;
 	pSegment->SetMasterRope(rope);
 
 	return pSegment;
@@ -1376,9 +1326,7 @@ CRopeSegment* CRopeSegment::CreateSegment( CRopeSample* pSample, string_t iszMod
 
 void CRopeSegment::ApplyExternalForce( const Vector& vecForce )
 {
-	m_Sample->GetData().mApplyExternalForce = true;
-
-	m_Sample->GetData().mExternalForce = m_Sample->GetData().mExternalForce + vecForce;
+	mMasterRope->ApplyForceToSample( vecForce, m_iSample );
 }
 
 void CRopeSegment::SetCauseDamageOnTouch( const bool bCauseDamage )
@@ -16,9 +16,6 @@
 #define ROPES_H
 
 class CRopeSegment;
-class CRopeSample;
-
-struct RopeSampleData;
 
 #include "cbase.h"
 
@@ -28,6 +25,8 @@ struct RopeSampleData;
 /**
 *	A rope with a number of segments.
 *	Uses an RK4 integrator with dampened springs to simulate rope physics.
+*	The simulation samples are stored in the rope itself, only the visible segments are entities.
+*	Ropes without an attached object stop simulating once they come to rest.
 */
 class CRope : public CBaseDelay
 {
@@ -55,41 +54,27 @@ public:
 	void InitializeRopeSim();
 
 	/**
-	*	Runs simulation on the samples.
+	*	Rebuilds the simulation data from the segment positions for ropes restored from saves without samples.
 	*/
-	void RunSimOnSamples();
+	void RebuildSamples();
 
 	/**
-	*	Computes forces on the given sample list.
-	*	@param pSystem List of sample data. m_NumSamples Elements large.
-	*/
-	void ComputeForces( RopeSampleData* pSystem );
-
-	/**
-	*	Computes forces on the given sample list.
-	*	@param pSystem List of samples. m_NumSamples Elements large.
-	*/
-	void ComputeForces( CRopeSample** ppSystem );
-
-	/**
-	*	Computes forces for the given sample data.
-	*	@param data Sample data.
+	*	Runs simulation on the samples.
 	*/
-	void ComputeSampleForce( RopeSampleData& data );
+	void RunSimOnSamples();
 
 	/**
-	*	Computes spring force for the given sample datas.
-	*	@param first First sample.
-	*	@param second Second sample.
-	*	@param spring Spring.
+	*	Computes forces on the given sample state.
+	*	@param pPositions Sample positions. m_NumSamples Elements large.
+	*	@param pVelocities Sample velocities. m_NumSamples Elements large.
+	*	@param pForces Receives the forces. m_NumSamples Elements large.
+	*	@param bApplyExternalForces Whether to add the pending external forces and clear them.
 	*/
-	void ComputeSpringForce(RopeSampleData& first, RopeSampleData& second);
+	void ComputeForces( const Vector* pPositions, const Vector* pVelocities, Vector* pForces, bool bApplyExternalForces );
 
 	/**
-	*	Runs RK4 integration.
+	*	Runs RK4 integration on the samples.
 	*	@param flDeltaTime Delta between previous and current time.
-	*	@param ppSampleSource Previous sample state.
-	*	@param ppSampleTarget Next sample state.
 	*/
 	void RK4Integrate(const float flDeltaTime);
 
@@ -138,6 +123,23 @@ public:
 	*/
 	void ApplyForceToSegment( const Vector& vecForce, const int uiSegment );
 
+	/**
+	*	Applies force to a specific sample.
+	*	@param vecForce Force.
+	*	@param uiSample Sample index.
+	*/
+	void ApplyForceToSample( const Vector& vecForce, const int uiSample );
+
+	/**
+	*	Resumes simulation if the rope was resting.
+	*/
+	void WakeUp();
+
+	/**
+	*	@return Whether the rope is resting and not simulated.
+	*/
+	bool IsSleeping() const { return m_bSleeping; }
+
 	/**
 	*	Attached an object to the given segment.
 	*/
@@ -262,6 +264,11 @@ public:
 	static const NamedSoundScript creakSoundScript;
 
 private:
+	/**
+	*	Puts the rope to sleep once nothing is attached and the samples stopped moving for a while.
+	*/
+	void UpdateSleepState();
+
 	int m_iSegments;
 
 	CRopeSegment* seg[ MAX_SEGMENTS ];
@@ -276,10 +283,19 @@ private:
 	Vector m_LastEndPos;
 	Vector m_Gravity;
 
-	CRopeSample* m_Samples[ MAX_SAMPLES ];
+	Vector m_SamplePositions[ MAX_SAMPLES ];
+	Vector m_SampleVelocities[ MAX_SAMPLES ];
+	Vector m_SampleExternalForces[ MAX_SAMPLES ];
+	float m_SampleMassReciprocals[ MAX_SAMPLES ];
+	float m_SampleRestLengths[ MAX_SAMPLES ];
 
 	int m_NumSamples;
 
+	bool m_bSleeping;
+	int m_iQuietThinks;
+
+	bool m_bRebuildSamples;
+
 	bool mSpringsInitialized;
 
 	int m_BeamOffset;
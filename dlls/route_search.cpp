@@ -0,0 +1,380 @@
+#include <chrono>
+
+#include "extdll.h"
+#include "util.h"
+#include "cbase.h"
+#include "nodes.h"
+#include "route_search.h"
+
+CRouteSearch g_RouteSearch;
+
+CRouteSearch::CRouteSearch():
+	_nodes(NULL), _heap(NULL), _nodeCapacity(0), _heapCapacity(0), _heapSize(0), _searchGeneration(0),
+	_cacheGeneration(1), _useCounter(0), _numLinkEnts(0), _linkEntsOverflow(false)
+{
+	memset( _cache, 0, sizeof( _cache ) );
+	ResetStats();
+}
+
+CRouteSearch::~CRouteSearch()
+{
+	Reset();
+}
+
+void CRouteSearch::Reset()
+{
+	if( _nodes )
+	{
+		free( _nodes );
+		_nodes = NULL;
+	}
+	if( _heap )
+	{
+		free( _heap );
+		_heap = NULL;
+	}
+	_nodeCapacity = 0;
+	_heapCapacity = 0;
+	_heapSize = 0;
+	_searchGeneration = 0;
+	InvalidateCache();
+}
+
+void CRouteSearch::InvalidateCache()
+{
+	_cacheGeneration++;
+	if( _cacheGeneration == 0 )
+	{
+		memset( _cache, 0, sizeof( _cache ) );
+		_cacheGeneration = 1;
+	}
+}
+
+double CRouteSearch::Clock()
+{
+	return std::chrono::duration<double>( std::chrono::steady_clock::now().time_since_epoch() ).count();
+}
+
+bool CRouteSearch::EnsureArena( const CGraph &graph )
+{
+	if( _nodeCapacity < graph.m_cNodes )
+	{
+		SearchNode *pNodes = (SearchNode *)calloc( sizeof(SearchNode), graph.m_cNodes );
+		if( !pNodes )
+			return false;
+		if( _nodes )
+			free( _nodes );
+		_nodes = pNodes;
+		_nodeCapacity = graph.m_cNodes;
+		_searchGeneration = 0;
+	}
+
+	// every improvement pushes a node, so the links count is a good starting size
+	const int heapSize = graph.m_cLinks + 1;
+	if( _heapCapacity < heapSize )
+	{
+		HeapEntry *pHeap = (HeapEntry *)malloc( sizeof(HeapEntry) * heapSize );
+		if( !pHeap )
+			return false;
+		if( _heap )
+			free( _heap );
+		_heap = pHeap;
+		_heapCapacity = heapSize;
+	}
+
+	_searchGeneration++;
+	if( _searchGeneration == 0 )
+	{
+		memset( _nodes, 0, sizeof(SearchNode) * _nodeCapacity );
+		_searchGeneration = 1;
+	}
+	_heapSize = 0;
+	return true;
+}
+
+void CRouteSearch::HeapPush( int node, float estimate )
+{
+	if( _heapSize == _heapCapacity )
+	{
+		const int newCapacity = _heapCapacity * 2;
+		HeapEntry *pHeap = (HeapEntry *)realloc( _heap, sizeof(HeapEntry) * newCapacity );
+		if( !pHeap )
+			return;
+		_heap = pHeap;
+		_heapCapacity = newCapacity;
+	}
+
+	int i = _heapSize++;
+	while( i > 0 )
+	{
+		const int parent = ( i - 1 ) / 2;
+		if( _heap[parent].estimate <= estimate )
+			break;
+		_heap[i] = _heap[parent];
+		i = parent;
+	}
+	_heap[i].node = node;
+	_heap[i].estimate = estimate;
+}
+
+int CRouteSearch::HeapPop()
+{
+	const int node = _heap[0].node;
+	const HeapEntry last = _heap[--_heapSize];
+
+	int i = 0;
+	for( ;; )
+	{
+		int child = i * 2 + 1;
+		if( child >= _heapSize )
+			break;
+		if( child + 1 < _heapSize && _heap[child + 1].estimate < _heap[child].estimate )
+			child++;
+		if( last.estimate <= _heap[child].estimate )
+			break;
+		_heap[i] = _heap[child];
+		i = child;
+	}
+	if( _heapSize > 0 )
+		_heap[i] = last;
+	return node;
+}
+
+bool CRouteSearch::RecordLinkEnt( entvars_t *pevLinkEnt, bool allowed )
+{
+	for( int i = 0; i < _numLinkEnts; ++i )
+	{
+		if( _linkEnts[i].pevLinkEnt == pevLinkEnt )
+			return true;
+	}
+	if( _numLinkEnts == MAX_CACHED_LINKENTS )
+		return false;
+	_linkEnts[_numLinkEnts].pevLinkEnt = pevLinkEnt;
+	_linkEnts[_numLinkEnts].allowed = allowed;
+	_numLinkEnts++;
+	return true;
+}
+
+CRouteSearch::CacheEntry *CRouteSearch::LookupCache( CGraph &graph, int pathSize, int iStart, int iDest, int iHull, int afCapMask )
+{
+	for( int i = 0; i < CACHE_ENTRIES; ++i )
+	{
+		CacheEntry &entry = _cache[i];
+		if( entry.generation != _cacheGeneration || entry.start != iStart || entry.dest != iDest
+			|| entry.hull != iHull || entry.capMask != afCapMask )
+			continue;
+
+		// the route was stored for a shorter buffer
+		if( Q_min( entry.numPathNodes, pathSize ) > entry.numStoredNodes )
+			continue;
+
+		for( int j = 0; j < entry.numLinkEnts; ++j )
+		{
+			const LinkEntDecision &decision = entry.linkEnts[j];
+			const bool allowed = graph.HandleLinkEnt( iStart, decision.pevLinkEnt, afCapMask, CGraph::NODEGRAPH_DYNAMIC ) != NLE_PROHIBIT;
+			if( allowed != decision.allowed )
+			{
+				// a door was opened or something like that, the route is not valid anymore
+				entry.generation = 0;
+				return NULL;
+			}
+		}
+
+		entry.lastUsed = ++_useCounter;
+		return &entry;
+	}
+	return NULL;
+}
+
+void CRouteSearch::StoreCache( int iStart, int iDest, int iHull, int afCapMask, const int *piPath, int numPathNodes, int numStoredNodes )
+{
+	CacheEntry *pEntry = &_cache[0];
+	for( int i = 0; i < CACHE_ENTRIES; ++i )
+	{
+		if( _cache[i].generation != _cacheGeneration )
+		{
+			pEntry = &_cache[i];
+			break;
+		}
+		if( _cache[i].lastUsed < pEntry->lastUsed )
+			pEntry = &_cache[i];
+	}
+
+	pEntry->start = iStart;
+	pEntry->dest = iDest;
+	pEntry->hull = iHull;
+	pEntry->capMask = afCapMask;
+	pEntry->generation = _cacheGeneration;
+	pEntry->lastUsed = ++_useCounter;
+	pEntry->numPathNodes = numPathNodes;
+	pEntry->numStoredNodes = numStoredNodes;
+	memcpy( pEntry->path, piPath, sizeof(int) * numStoredNodes );
+	pEntry->numLinkEnts = _numLinkEnts;
+	memcpy( pEntry->linkEnts, _linkEnts, sizeof(LinkEntDecision) * _numLinkEnts );
+}
+
+//=========================================================
+// FindPath - A* from iStart to iDest. Link weights are
+// 2D distances, so the 2D distance to the destination
+// never overestimates and the first time the destination
+// is pulled out of the heap its route is the shortest one.
+// Returns the number of nodes in the path, the first
+// pathSize of them are copied into piPath.
+//=========================================================
+int CRouteSearch::FindPath( CGraph &graph, int *piPath, int pathSize, int iStart, int iDest, int iHull, int iHullMask, int afCapMask )
+{
+	const double startTime = Clock();
+	_dynamicQueries++;
+
+	const bool cacheable = pathSize <= MAX_PATH_SIZE;
+	if( cacheable )
+	{
+		CacheEntry *pEntry = LookupCache( graph, pathSize, iStart, iDest, iHull, afCapMask );
+		if( pEntry )
+		{
+			memcpy( piPath, pEntry->path, sizeof(int) * Q_min( pEntry->numPathNodes, pathSize ) );
+			_cacheHits++;
+			_dynamicTime += Clock() - startTime;
+			return pEntry->numPathNodes;
+		}
+	}
+
+	if( !EnsureArena( graph ) )
+	{
+		ALERT( at_error, "FindPath: couldn't allocate route search arena!\n" );
+		return 0;
+	}
+
+	_numLinkEnts = 0;
+	_linkEntsOverflow = false;
+
+	const Vector2D vecDest = graph.m_pNodes[iDest].m_vecOrigin.Make2D();
+
+	SearchNode &startNode = _nodes[iStart];
+	startNode.generation = _searchGeneration;
+	startNode.cost = 0.0f;
+	startNode.previous = iStart;
+	startNode.closed = false;
+	HeapPush( iStart, ( vecDest - graph.m_pNodes[iStart].m_vecOrigin.Make2D() ).Length() );
+
+	bool found = false;
+	while( _heapSize > 0 )
+	{
+		const int iCurrentNode = HeapPop();
+		SearchNode &current = _nodes[iCurrentNode];
+		if( current.closed )
+			continue;// stale heap entry, the node was already expanded
+
+		if( iCurrentNode == iDest )
+		{
+			found = true;
+			break;
+		}
+
+		current.closed = true;
+		_nodesExpanded++;
+
+		const CNode &node = graph.m_pNodes[iCurrentNode];
+		for( int i = 0; i < node.m_cNumLinks; i++ )
+		{
+			const CLink &link = graph.m_pLinkPool[node.m_iFirstLink + i];
+			if( ( link.m_afLinkInfo & iHullMask ) != iHullMask )
+			{
+				// monster is too large to walk this connection
+				continue;
+			}
+
+			const int iVisitNode = link.m_iDestNode;
+			SearchNode &visit = _nodes[iVisitNode];
+			const float flOurDistance = current.cost + link.m_flWeight;
+			if( visit.generation == _searchGeneration && flOurDistance >= visit.cost - 0.001f )
+				continue;
+
+			if( link.m_pLinkEnt != NULL )
+			{
+				// there's a brush ent in the way! Don't put the node into the queue unless the monster can negotiate it
+				const bool allowed = graph.HandleLinkEnt( iCurrentNode, link.m_pLinkEnt, afCapMask, CGraph::NODEGRAPH_DYNAMIC ) != NLE_PROHIBIT;
+				if( !RecordLinkEnt( link.m_pLinkEnt, allowed ) )
+					_linkEntsOverflow = true;
+				if( !allowed )
+					continue;
+			}
+
+			visit.generation = _searchGeneration;
+			visit.cost = flOurDistance;
+			visit.previous = iCurrentNode;
+			visit.closed = false;
+			HeapPush( iVisitNode, flOurDistance + ( vecDest - graph.m_pNodes[iVisitNode].m_vecOrigin.Make2D() ).Length() );
+		}
+	}
+
+	int iNumPathNodes = 0;
+	if( found )
+	{
+		// walk backwards through the previous nodes and count how many connections there are in the path
+		int iCurrentNode = iDest;
+		iNumPathNodes = 1;// count the dest
+		while( iCurrentNode != iStart )
+		{
+			iNumPathNodes++;
+			iCurrentNode = _nodes[iCurrentNode].previous;
+		}
+
+		iCurrentNode = iDest;
+		for( int i = iNumPathNodes - 1; i >= 0; i-- )
+		{
+			if( i < pathSize )
+				piPath[i] = iCurrentNode;
+			iCurrentNode = _nodes[iCurrentNode].previous;
+		}
+	}
+
+	// a route that depends on too many link entities can't be validated cheaply
+	if( cacheable && !_linkEntsOverflow )
+		StoreCache( iStart, iDest, iHull, afCapMask, piPath, iNumPathNodes, Q_min( iNumPathNodes, pathSize ) );
+
+	_dynamicTime += Clock() - startTime;
+	return iNumPathNodes;
+}
+
+void CRouteSearch::AddStaticQuery( double seconds )
+{
+	_staticQueries++;
+	_staticTime += seconds;
+}
+
+void CRouteSearch::ReportStats()
+{
+	ALERT( at_console, "Static route queries: %u, %.3f ms total", _staticQueries, _staticTime * 1000.0 );
+	if( _staticQueries )
+		ALERT( at_console, ", %.2f us per query", _staticTime * 1000000.0 / _staticQueries );
+	ALERT( at_console, "\n" );
+
+	ALERT( at_console, "Dynamic route queries: %u, %.3f ms total", _dynamicQueries, _dynamicTime * 1000.0 );
+	if( _dynamicQueries )
+		ALERT( at_console, ", %.2f us per query", _dynamicTime * 1000000.0 / _dynamicQueries );
+	ALERT( at_console, "\n" );
+
+	const unsigned int searches = _dynamicQueries - _cacheHits;
+	ALERT( at_console, "Cache hits: %u, searches: %u", _cacheHits, searches );
+	if( searches )
+		ALERT( at_console, ", %.1f nodes expanded per search", (float)_nodesExpanded / searches );
+	ALERT( at_console, "\n" );
+}
+
+void CRouteSearch::ResetStats()
+{
+	_staticQueries = 0;
+	_staticTime = 0.0;
+	_dynamicQueries = 0;
+	_cacheHits = 0;
+	_nodesExpanded = 0;
+	_dynamicTime = 0.0;
+}
+
+void DumpRouteStats()
+{
+	g_RouteSearch.ReportStats();
+	if( CMD_ARGC() > 1 && FStrEq( CMD_ARGV( 1 ), "reset" ) )
+		g_RouteSearch.ResetStats();
+}
@@ -0,0 +1,107 @@
+#pragma once
+#ifndef ROUTE_SEARCH_H
+#define ROUTE_SEARCH_H
+
+class CGraph;
+
+// A* search over the world graph for dynamic route queries, i.e. the ones that
+// have to respect the current state of link entities (doors, breakables, etc.).
+// Search state lives in arenas sized to the graph and is never reset between queries:
+// a node belongs to the current search only if its generation matches.
+// Recent results are kept in a small LRU cache. Each cached route remembers how the link entities
+// it ran into were handled and is thrown away as soon as any of them answers differently.
+// The state is kept outside of CGraph because CGraph is written to .nod files as is.
+class CRouteSearch
+{
+public:
+	CRouteSearch();
+	~CRouteSearch();
+
+	void Reset();
+	void InvalidateCache();
+
+	int FindPath( CGraph &graph, int *piPath, int pathSize, int iStart, int iDest, int iHull, int iHullMask, int afCapMask );
+
+	void AddStaticQuery( double seconds );
+
+	void ReportStats();
+	void ResetStats();
+
+	static double Clock();
+
+	static const int CACHE_ENTRIES = 32;
+	static const int MAX_CACHED_LINKENTS = 8;
+
+private:
+	struct SearchNode
+	{
+		float cost;
+		int previous;
+		unsigned int generation;
+		bool closed;
+	};
+
+	struct HeapEntry
+	{
+		int node;
+		float estimate;
+	};
+
+	struct LinkEntDecision
+	{
+		entvars_t *pevLinkEnt;
+		bool allowed;
+	};
+
+	struct CacheEntry
+	{
+		int start;
+		int dest;
+		int hull;
+		int capMask;
+		unsigned int generation;
+		unsigned int lastUsed;
+		int numPathNodes;
+		int numStoredNodes;
+		int path[MAX_PATH_SIZE];
+		int numLinkEnts;
+		LinkEntDecision linkEnts[MAX_CACHED_LINKENTS];
+	};
+
+	bool EnsureArena( const CGraph &graph );
+	void HeapPush( int node, float estimate );
+	int HeapPop();
+
+	CacheEntry *LookupCache( CGraph &graph, int pathSize, int iStart, int iDest, int iHull, int afCapMask );
+	void StoreCache( int iStart, int iDest, int iHull, int afCapMask, const int *piPath, int numPathNodes, int numStoredNodes );
+	bool RecordLinkEnt( entvars_t *pevLinkEnt, bool allowed );
+
+	SearchNode *_nodes;
+	HeapEntry *_heap;
+	int _nodeCapacity;
+	int _heapCapacity;
+	int _heapSize;
+	unsigned int _searchGeneration;
+
+	CacheEntry _cache[CACHE_ENTRIES];
+	unsigned int _cacheGeneration;
+	unsigned int _useCounter;
+
+	// link entities the current search had to ask about
+	LinkEntDecision _linkEnts[MAX_CACHED_LINKENTS];
+	int _numLinkEnts;
+	bool _linkEntsOverflow;
+
+	unsigned int _staticQueries;
+	double _staticTime;
+	unsigned int _dynamicQueries;
+	unsigned int _cacheHits;
+	unsigned int _nodesExpanded;
+	double _dynamicTime;
+};
+
+extern CRouteSearch g_RouteSearch;
+
+void DumpRouteStats();
+
+#endif
@@ -0,0 +1,204 @@
+#include "extdll.h"
+#include "util.h"
+#include "save_layout.h"
+
+#include <cctype>
+
+CSaveLayoutCache g_SaveLayoutCache;
+
+CSaveLayoutCache::CSaveLayoutCache(): _lastFields(NULL), _lastLayout(NULL)
+{
+	memset( _tokens, 0, sizeof( _tokens ) );
+	ResetStats();
+}
+
+CSaveLayoutCache::~CSaveLayoutCache()
+{
+	for( std::map<const TYPEDESCRIPTION *, Layout *>::iterator it = _layouts.begin(); it != _layouts.end(); ++it )
+		delete it->second;
+}
+
+unsigned int CSaveLayoutCache::HashName( const char *name )
+{
+	unsigned int hash = 2166136261u;
+	while( *name )
+	{
+		hash ^= (unsigned char)tolower( (unsigned char)*name++ );
+		hash *= 16777619u;
+	}
+	return hash;
+}
+
+unsigned int CSaveLayoutCache::TokenEntryIndex( const char *token )
+{
+	const unsigned int key = (unsigned int)( (size_t)token >> 2 );
+	return ( key * 2654435761u ) >> 20 & ( TOKEN_ENTRY_COUNT - 1 );
+}
+
+CSaveLayoutCache::Layout *CSaveLayoutCache::Build( const TYPEDESCRIPTION *pFields, int fieldCount, const int *typeSizes )
+{
+	_builds++;
+
+	Layout *layout = new Layout;
+	layout->fields = pFields;
+	layout->fieldCount = fieldCount;
+	layout->byteSizes.resize( fieldCount );
+	layout->nameHashes.resize( fieldCount );
+	layout->nextSameName.assign( fieldCount, -1 );
+
+	int slotCount = 16;
+	while( slotCount < fieldCount * 2 )
+		slotCount *= 2;
+	layout->nameSlots.assign( slotCount, -1 );
+
+	const int mask = slotCount - 1;
+	for( int i = 0; i < fieldCount; i++ )
+	{
+		layout->byteSizes[i] = pFields[i].fieldSize * typeSizes[pFields[i].fieldType];
+		if( !pFields[i].fieldName )
+			continue;
+
+		const unsigned int hash = HashName( pFields[i].fieldName );
+		layout->nameHashes[i] = hash;
+
+		int slot = hash & mask;
+		for( ; layout->nameSlots[slot] != -1; slot = ( slot + 1 ) & mask )
+		{
+			int first = layout->nameSlots[slot];
+			if( layout->nameHashes[first] == hash && !stricmp( pFields[first].fieldName, pFields[i].fieldName ) )
+			{
+				// Same name as an earlier field, append to its chain
+				while( layout->nextSameName[first] != -1 )
+					first = layout->nextSameName[first];
+				layout->nextSameName[first] = i;
+				break;
+			}
+		}
+		if( layout->nameSlots[slot] == -1 )
+			layout->nameSlots[slot] = i;
+	}
+
+	return layout;
+}
+
+const CSaveLayoutCache::Layout *CSaveLayoutCache::GetLayout( const TYPEDESCRIPTION *pFields, int fieldCount, const int *typeSizes )
+{
+	Layout *layout;
+	if( pFields == _lastFields )
+	{
+		layout = _lastLayout;
+	}
+	else
+	{
+		std::map<const TYPEDESCRIPTION *, Layout *>::iterator it = _layouts.find( pFields );
+		if( it == _layouts.end() )
+			it = _layouts.insert( std::make_pair( pFields, Build( pFields, fieldCount, typeSizes ) ) ).first;
+		layout = it->second;
+	}
+
+	// Tables passed in by the engine aren't guaranteed to be static
+	if( layout->fieldCount != fieldCount || ( fieldCount && layout->nameHashes.size() && pFields[0].fieldName
+		&& layout->nameHashes[0] != HashName( pFields[0].fieldName ) ) )
+	{
+		delete layout;
+		layout = Build( pFields, fieldCount, typeSizes );
+		_layouts[pFields] = layout;
+	}
+
+	_lastFields = pFields;
+	_lastLayout = layout;
+	return layout;
+}
+
+int CSaveLayoutCache::FindField( const Layout *layout, const char *name, int startField )
+{
+	_fieldLookups++;
+
+	const TYPEDESCRIPTION *pFields = layout->fields;
+	const int fieldCount = layout->fieldCount;
+	if( !fieldCount )
+		return -1;
+	startField %= fieldCount;
+
+	// Most data is read in the order it was written
+	if( pFields[startField].fieldName && !stricmp( pFields[startField].fieldName, name ) )
+	{
+		_inOrderFields++;
+		return startField;
+	}
+
+	const unsigned int hash = HashName( name );
+	const int mask = (int)layout->nameSlots.size() - 1;
+	for( int slot = hash & mask; layout->nameSlots[slot] != -1; slot = ( slot + 1 ) & mask )
+	{
+		const int first = layout->nameSlots[slot];
+		if( layout->nameHashes[first] != hash || stricmp( pFields[first].fieldName, name ) )
+			continue;
+
+		// First field with this name at or after startField, wrapping around to the first one
+		for( int i = first; i != -1; i = layout->nextSameName[i] )
+		{
+			if( i >= startField )
+				return i;
+		}
+		return first;
+	}
+
+	_missingFields++;
+	return -1;
+}
+
+bool CSaveLayoutCache::FindToken( const SAVERESTOREDATA *pdata, const char *token, unsigned short &index )
+{
+	const TokenEntry &entry = _tokens[TokenEntryIndex( token )];
+	if( entry.key == token && entry.tokens == pdata->pTokens && entry.index < pdata->tokenCount )
+	{
+		// Token strings are never removed from the table, so a slot holding this string is the one TokenHash would return
+		const char *stored = pdata->pTokens[entry.index];
+		if( stored == token || ( stored && strcmp( stored, token ) == 0 ) )
+		{
+			_tokenHits++;
+			index = entry.index;
+			return true;
+		}
+	}
+	_tokenMisses++;
+	return false;
+}
+
+void CSaveLayoutCache::StoreToken( const SAVERESTOREDATA *pdata, const char *token, unsigned short index, int probes )
+{
+	TokenEntry &entry = _tokens[TokenEntryIndex( token )];
+	entry.key = token;
+	entry.tokens = pdata->pTokens;
+	entry.index = index;
+
+	_tokenProbes += probes;
+	if( probes > _maxTokenProbes )
+		_maxTokenProbes = probes;
+}
+
+void CSaveLayoutCache::ReportStats()
+{
+	ALERT( at_console, "Save layouts built: %u, cached: %d\n", _builds, (int)_layouts.size() );
+	ALERT( at_console, "Field lookups: %u, in order: %u, missing: %u\n", _fieldLookups, _inOrderFields, _missingFields );
+	ALERT( at_console, "Token lookups: %u, cache hits: %u", _tokenHits + _tokenMisses, _tokenHits );
+	if( _tokenMisses )
+		ALERT( at_console, ", probes per miss: %.2f, longest probe: %d", (float)_tokenProbes / _tokenMisses, _maxTokenProbes );
+	ALERT( at_console, "\n" );
+}
+
+void CSaveLayoutCache::ResetStats()
+{
+	_builds = 0;
+	_fieldLookups = _inOrderFields = _missingFields = 0;
+	_tokenHits = _tokenMisses = _tokenProbes = 0;
+	_maxTokenProbes = 0;
+}
+
+void DumpSaveLayoutCache()
+{
+	g_SaveLayoutCache.ReportStats();
+	if( CMD_ARGC() > 1 && FStrEq( CMD_ARGV( 1 ), "reset" ) )
+		g_SaveLayoutCache.ResetStats();
+}
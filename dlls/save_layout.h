@@ -0,0 +1,78 @@
+#pragma once
+#ifndef SAVE_LAYOUT_H
+#define SAVE_LAYOUT_H
+
+#include <map>
+#include <vector>
+
+// Save/restore data derived once per TYPEDESCRIPTION table.
+// A layout keeps the byte size of every field and a case insensitive index of the field names,
+// so restoring a field doesn't walk the whole table. Fields sharing a name are chained in table order
+// to keep the "first match starting from the last restored field" rule of the linear search.
+// The token table itself is allocated by the engine with a fixed size, so slots are still placed by
+// CSaveRestoreBuffer::TokenHash; the slot each field name string landed in is remembered here
+// and checked against the current table before use.
+class CSaveLayoutCache
+{
+public:
+	struct Layout
+	{
+		const TYPEDESCRIPTION *fields;
+		int fieldCount;
+		std::vector<int> byteSizes;
+		std::vector<int> nameSlots;		// open addressing table of field indices
+		std::vector<unsigned int> nameHashes;
+		std::vector<int> nextSameName;
+	};
+
+	CSaveLayoutCache();
+	~CSaveLayoutCache();
+
+	const Layout *GetLayout( const TYPEDESCRIPTION *pFields, int fieldCount, const int *typeSizes );
+	int FindField( const Layout *layout, const char *name, int startField );
+
+	bool FindToken( const SAVERESTOREDATA *pdata, const char *token, unsigned short &index );
+	void StoreToken( const SAVERESTOREDATA *pdata, const char *token, unsigned short index, int probes );
+
+	void ReportStats();
+	void ResetStats();
+
+	static const int TOKEN_ENTRY_COUNT = 4096;
+
+private:
+	CSaveLayoutCache( const CSaveLayoutCache & );
+	CSaveLayoutCache &operator=( const CSaveLayoutCache & );
+
+	struct TokenEntry
+	{
+		const char *key;
+		char **tokens;
+		unsigned short index;
+	};
+
+	static unsigned int HashName( const char *name );
+	static unsigned int TokenEntryIndex( const char *token );
+
+	Layout *Build( const TYPEDESCRIPTION *pFields, int fieldCount, const int *typeSizes );
+
+	std::map<const TYPEDESCRIPTION *, Layout *> _layouts;
+	const TYPEDESCRIPTION *_lastFields;
+	Layout *_lastLayout;
+
+	TokenEntry _tokens[TOKEN_ENTRY_COUNT];
+
+	unsigned int _builds;
+	unsigned int _fieldLookups;
+	unsigned int _inOrderFields;
+	unsigned int _missingFields;
+	unsigned int _tokenHits;
+	unsigned int _tokenMisses;
+	unsigned int _tokenProbes;
+	int _maxTokenProbes;
+};
+
+extern CSaveLayoutCache g_SaveLayoutCache;
+
+void DumpSaveLayoutCache();
+
+#endif
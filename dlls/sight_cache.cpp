@@ -0,0 +1,135 @@
+#include "extdll.h"
+#include "util.h"
+#include "cbase.h"
+#include "game.h"
+#include "sight_cache.h"
+
+CSightCache g_SightCache;
+
+CSightCache::CSightCache(): _frame(1), _tracesIssued(0), _tracesReused(0), _tracesReusedReversed(0)
+{
+	ClearEntries();
+}
+
+void CSightCache::ClearEntries()
+{
+	for( int i = 0; i < ENTRY_COUNT; i++ )
+		_entries[i] = SightEntry();
+}
+
+void CSightCache::BeginFrame()
+{
+	_frame++;
+	if( _frame == 0 )
+	{
+		ClearEntries();
+		_frame = 1;
+	}
+}
+
+unsigned int CSightCache::PairHash( int first, int second )
+{
+	if( first > second )
+	{
+		const int temp = first;
+		first = second;
+		second = temp;
+	}
+	return ( (unsigned int)first * 2654435761u ^ (unsigned int)second * 40503u ) & ( ENTRY_COUNT - 1 );
+}
+
+// ignore_monsters traces still hit brush entities, so the skipped entity matters only if it's a brush
+bool CSightCache::CanReverse( CBaseEntity *pEntity )
+{
+	return pEntity->pev->solid != SOLID_BSP;
+}
+
+bool CSightCache::CheckLineOfSight( CBaseEntity *pLooker, CBaseEntity *pTarget, const Vector &vecLookerOrigin, const Vector &vecTargetOrigin )
+{
+	TraceResult tr;
+
+	if( !sv_sightcache.value )
+	{
+		_tracesIssued++;
+		UTIL_TraceLine( vecLookerOrigin, vecTargetOrigin, ignore_monsters, ignore_glass, pLooker->edict(), &tr );
+		return tr.flFraction == 1.0f;
+	}
+
+	const int looker = pLooker->entindex();
+	const int target = pTarget->entindex();
+
+	SightEntry *pFree = NULL;
+	unsigned int index = PairHash( looker, target );
+	for( int i = 0; i < MAX_PROBES; ++i, index = ( index + 1 ) & ( ENTRY_COUNT - 1 ) )
+	{
+		SightEntry &entry = _entries[index];
+		if( entry.frame != _frame )
+		{
+			if( !pFree )
+				pFree = &entry;
+			continue;
+		}
+
+		if( entry.looker == looker && entry.target == target )
+		{
+			if( entry.start == vecLookerOrigin && entry.end == vecTargetOrigin )
+			{
+				_tracesReused++;
+				return entry.visible;
+			}
+			// Someone moved during the frame, overwrite with the new trace
+			pFree = &entry;
+			break;
+		}
+
+		// Only the clear line can be reused in the opposite direction.
+		// A blocked trace might have started in solid on the other end.
+		if( entry.looker == target && entry.target == looker && entry.reversible
+			&& entry.start == vecTargetOrigin && entry.end == vecLookerOrigin
+			&& CanReverse( pLooker ) && CanReverse( pTarget ) )
+		{
+			_tracesReusedReversed++;
+			return true;
+		}
+	}
+
+	_tracesIssued++;
+	UTIL_TraceLine( vecLookerOrigin, vecTargetOrigin, ignore_monsters, ignore_glass, pLooker->edict(), &tr );
+	const bool visible = tr.flFraction == 1.0f;
+
+	if( pFree )
+	{
+		pFree->frame = _frame;
+		pFree->looker = looker;
+		pFree->target = target;
+		pFree->start = vecLookerOrigin;
+		pFree->end = vecTargetOrigin;
+		pFree->visible = visible;
+		pFree->reversible = visible && !tr.fStartSolid && !tr.fAllSolid;
+	}
+
+	return visible;
+}
+
+void CSightCache::ReportStats()
+{
+	const unsigned int total = _tracesIssued + _tracesReused + _tracesReusedReversed;
+	ALERT( at_console, "Sight cache is %s\n", sv_sightcache.value ? "enabled" : "disabled" );
+	ALERT( at_console, "Line of sight checks: %u\n", total );
+	ALERT( at_console, "Traces issued: %u\n", _tracesIssued );
+	ALERT( at_console, "Traces reused: %u (reversed: %u)\n", _tracesReused + _tracesReusedReversed, _tracesReusedReversed );
+	if( total )
+		ALERT( at_console, "Saved: %.1f%%\n", (float)( _tracesReused + _tracesReusedReversed ) * 100.0f / total );
+}
+
+void CSightCache::ResetStats()
+{
+	_tracesIssued = _tracesReused = _tracesReusedReversed = 0;
+}
+
+void DumpSightCache()
+{
+	g_SightCache.ReportStats();
+	if( CMD_ARGC() > 1 && FStrEq( CMD_ARGV( 1 ), "reset" ) )
+		g_SightCache.ResetStats();
+}
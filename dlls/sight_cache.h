@@ -0,0 +1,53 @@
+#pragma once
+#ifndef SIGHT_CACHE_H
+#define SIGHT_CACHE_H
+
+class CBaseEntity;
+
+// Per-frame cache of line of sight traces between entity eyes.
+// Monsters looking at each other in the same frame share the trace:
+// if A sees B, then B sees A as long as the eye positions are the same.
+class CSightCache
+{
+public:
+	CSightCache();
+
+	void BeginFrame();
+	bool CheckLineOfSight( CBaseEntity *pLooker, CBaseEntity *pTarget, const Vector &vecLookerOrigin, const Vector &vecTargetOrigin );
+
+	void ReportStats();
+	void ResetStats();
+
+	static const int ENTRY_COUNT = 4096;
+	static const int MAX_PROBES = 8;
+
+private:
+	struct SightEntry
+	{
+		unsigned int frame;
+		int looker;
+		int target;
+		Vector start;
+		Vector end;
+		bool visible;
+		bool reversible;
+	};
+
+	static unsigned int PairHash( int first, int second );
+	static bool CanReverse( CBaseEntity *pEntity );
+
+	void ClearEntries();
+
+	SightEntry _entries[ENTRY_COUNT];
+	unsigned int _frame;
+
+	unsigned int _tracesIssued;
+	unsigned int _tracesReused;
+	unsigned int _tracesReusedReversed;
+};
+
+extern CSightCache g_SightCache;
+
+void DumpSightCache();
+
+#endif
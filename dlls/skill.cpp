@@ -18,9 +18,58 @@
 #include	"extdll.h"
 #include	"util.h"
 #include	"skill.h"
+#include	"cbase.h"
+#include	"gamerules.h"
+
+#include <algorithm>
+#include <vector>
 
 skilldata_t gSkillData;
 
+// Constant-initialized, so it's valid before any descriptor constructor runs
+static skill_cvar_t* g_pSkillCvars = NULL;
+static std::vector<skill_cvar_t*> g_sortedSkillCvars;
+
+skill_cvar_t::skill_cvar_t(const char *skillName, cvar_t *cvar1, cvar_t *cvar2, cvar_t *cvar3):
+	name(skillName), loadedValue(0.0f)
+{
+	cvars[0] = cvar1;
+	cvars[1] = cvar2;
+	cvars[2] = cvar3;
+	next = g_pSkillCvars;
+	g_pSkillCvars = this;
+}
+
+static bool SkillCvarLess(const skill_cvar_t* a, const skill_cvar_t* b)
+{
+	return strcmp(a->name, b->name) < 0;
+}
+
+static skill_cvar_t* FindSkillCvar(const char* pName)
+{
+	if (g_sortedSkillCvars.empty())
+	{
+		for (skill_cvar_t* pSkillCvar = g_pSkillCvars; pSkillCvar; pSkillCvar = pSkillCvar->next)
+			g_sortedSkillCvars.push_back(pSkillCvar);
+		std::sort(g_sortedSkillCvars.begin(), g_sortedSkillCvars.end(), SkillCvarLess);
+	}
+
+	size_t low = 0;
+	size_t high = g_sortedSkillCvars.size();
+	while (low < high)
+	{
+		const size_t middle = low + (high - low) / 2;
+		const int cmp = strcmp(g_sortedSkillCvars[middle]->name, pName);
+		if (cmp == 0)
+			return g_sortedSkillCvars[middle];
+		if (cmp < 0)
+			low = middle + 1;
+		else
+			high = middle;
+	}
+	return NULL;
+}
+
 //=========================================================
 // take the name of a cvar, tack a digit for the skill level
 // on, and return the value.of that Cvar 
@@ -30,9 +79,21 @@ static float GetSkillCvar(const char *pName , const char *fallback, bool allowZe
 	float flValue;
 	char szBuffer[64];
 
-	sprintf( szBuffer, "%s%d",pName, gSkillData.iSkillLevel );
+	skill_cvar_t* pSkillCvar = NULL;
+	if (gSkillData.iSkillLevel >= SKILL_EASY && gSkillData.iSkillLevel <= SKILL_HARD)
+		pSkillCvar = FindSkillCvar( pName );
 
-	flValue = CVAR_GET_FLOAT( szBuffer );
+	if (pSkillCvar)
+	{
+		flValue = pSkillCvar->cvars[gSkillData.iSkillLevel - 1]->value;
+		pSkillCvar->loadedValue = flValue;
+	}
+	else
+	{
+		// Not declared in game.cpp (e.g. set from a config only), ask the engine
+		sprintf( szBuffer, "%s%d",pName, gSkillData.iSkillLevel );
+		flValue = CVAR_GET_FLOAT( szBuffer );
+	}
 
 	if( flValue <= 0 && !allowZero)
 	{
@@ -41,7 +102,11 @@ static float GetSkillCvar(const char *pName , const char *fallback, bool allowZe
 		else if (fallbackValue)
 			flValue = fallbackValue;
 		if (flValue <= 0)
+		{
+			if (pSkillCvar)
+				sprintf( szBuffer, "%s%d",pName, gSkillData.iSkillLevel );
 			ALERT( at_console, "\n\n** GetSkillCVar Got a zero for %s **\n\n", szBuffer );
+		}
 	}
 
 	return flValue;
@@ -61,3 +126,35 @@ float GetSkillCvarZeroable(const char *pName)
 {
 	return GetSkillCvar(pName, 0, true);
 }
+
+//=========================================================
+// re-read the skill values of the current skill level and
+// report the ones that changed since the last refresh
+//=========================================================
+void ReloadSkillData()
+{
+	if (!g_pGameRules)
+	{
+		ALERT( at_console, "skill_reload: no game is running\n" );
+		return;
+	}
+
+	std::vector<float> oldValues;
+	oldValues.reserve(g_sortedSkillCvars.size());
+	for (size_t i=0; i<g_sortedSkillCvars.size(); ++i)
+		oldValues.push_back(g_sortedSkillCvars[i]->loadedValue);
+
+	g_pGameRules->RefreshSkillData();
+
+	int changedCount = 0;
+	for (size_t i=0; i<oldValues.size(); ++i)
+	{
+		const skill_cvar_t* pSkillCvar = g_sortedSkillCvars[i];
+		if (pSkillCvar->loadedValue != oldValues[i])
+		{
+			ALERT( at_console, "%s%d: %g -> %g\n", pSkillCvar->name, gSkillData.iSkillLevel, oldValues[i], pSkillCvar->loadedValue );
+			changedCount++;
+		}
+	}
+	ALERT( at_console, "skill_reload: %d value(s) changed for skill level %d\n", changedCount, gSkillData.iSkillLevel );
+}
@@ -335,6 +335,21 @@ float GetSkillCvar( const char *pName, const char* fallback = 0 );
 float GetSkillCvar( const char *pName, float fallback );
 float GetSkillCvarZeroable( const char* pName );
 
+// Cvars of a skill value for each skill level, declared by DECLARE_SKILL_VALUE.
+// Descriptors link themselves on static initialization so GetSkillCvar can read the cvar values directly
+// instead of formatting the name and asking the engine for each value.
+struct skill_cvar_t
+{
+	skill_cvar_t( const char* skillName, cvar_t* cvar1, cvar_t* cvar2, cvar_t* cvar3 );
+
+	const char* name;
+	cvar_t* cvars[3];
+	float loadedValue; // value read on the last refresh, used to report changes on reload
+	skill_cvar_t* next;
+};
+
+void ReloadSkillData();
+
 extern DLL_GLOBAL int		g_iSkillLevel;
 
 #define SKILL_EASY		1
@@ -1796,30 +1796,19 @@ char TEXTURETYPE_Find( char *name )
 	return PM_FindTextureType(name);
 }
 
-// play a strike sound based on the texture that was hit by the attack traceline.  VecSrc/VecEnd are the
-// original traceline endpoints used by the attacker, iBulletType is the type of bullet that hit the texture.
-// returns volume of strike instrument (crowbar) to play
-
-float TEXTURETYPE_PlaySound( TraceResult *ptr,  Vector vecSrc, Vector vecEnd, int iBulletType )
+// find the material type of the texture hit by the attack traceline, optionally reporting if it was the sky
+char TEXTURETYPE_FromTrace( TraceResult *ptr, Vector vecSrc, Vector vecEnd, bool *pIsSky )
 {
-	// hit the world, try to play sound based on texture material type
 	char chTextureType;
-	float fvol;
-	float fvolbar;
-	char szbuffer[64];
 	const char *pTextureName;
 	float rgfl1[3];
 	float rgfl2[3];
-	const char *rgsz[4];
-	int cnt;
-	float fattn = ATTN_NORM;
-
-	if( !g_pGameRules->PlayTextureSounds() )
-		return 0.0f;
 
 	CBaseEntity *pEntity = CBaseEntity::Instance( ptr->pHit );
 
 	chTextureType = 0;
+	if( pIsSky )
+		*pIsSky = false;
 
 	if( pEntity && pEntity->DefaultClassify() != CLASS_NONE && !pEntity->IsMachine() )
 		// hit body
@@ -1843,15 +1832,37 @@ float TEXTURETYPE_PlaySound( TraceResult *ptr,  Vector vecSrc, Vector vecEnd, in
 
 		if( pTextureName )
 		{
-			GetStrippedTextureName(szbuffer, pTextureName);
-	
-			// ALERT( at_console, "texture hit: %s\n", szbuffer );
+			// ALERT( at_console, "texture hit: %s\n", pTextureName );
+
+			if( pIsSky && strcmp( pTextureName, "sky" ) == 0 )
+				*pIsSky = true;
 
-			// get texture type
-			chTextureType = TEXTURETYPE_Find( szbuffer );
+			// get texture type, cached per texture
+			chTextureType = PM_FindTextureTypeByTexture( pTextureName );
 		}
 	}
 
+	return chTextureType;
+}
+
+// play a strike sound based on the texture that was hit by the attack traceline.  VecSrc/VecEnd are the
+// original traceline endpoints used by the attacker, iBulletType is the type of bullet that hit the texture.
+// returns volume of strike instrument (crowbar) to play
+float TEXTURETYPE_PlaySound( TraceResult *ptr,  Vector vecSrc, Vector vecEnd, int iBulletType )
+{
+	float fvol;
+	float fvolbar;
+	const char *rgsz[4];
+	int cnt;
+	float fattn = ATTN_NORM;
+
+	if( !g_pGameRules->PlayTextureSounds() )
+		return 0.0f;
+
+	CBaseEntity *pEntity = CBaseEntity::Instance( ptr->pHit );
+
+	const char chTextureType = TEXTURETYPE_FromTrace( ptr, vecSrc, vecEnd );
+
 	if (!GetTextureMaterialProperties(chTextureType, &fvol, &fvolbar, rgsz, &cnt, &fattn, iBulletType))
 		return 0.0;
 
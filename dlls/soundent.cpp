@@ -18,11 +18,31 @@
 #include	"cbase.h"
 #include	"monsters.h"
 #include	"soundent.h"
+#include	"game.h"
+
+#include	<algorithm>
+#include	<cmath>
 
 LINK_ENTITY_TO_CLASS( soundent, CSoundEnt )
 
 CSoundEnt *pSoundEnt;
 
+std::vector<CSound> CSoundEnt::m_SoundPool;
+std::vector<CSoundEnt::SoundGridLink> CSoundEnt::m_SoundLinks;
+std::vector<int> CSoundEnt::m_SoundGrid[SOUND_GRID_BUCKETS];
+std::vector<int> CSoundEnt::m_GlobalSounds;
+std::vector<int> CSoundEnt::m_AudibleCandidates;
+
+static int SoundGridCoord( float f )
+{
+	return (int)floor( f / SOUND_GRID_CELL_SIZE );
+}
+
+static unsigned int SoundGridBucket( int x, int y )
+{
+	return ( (unsigned int)x * 73856093u ^ (unsigned int)y * 19349663u ) & ( SOUND_GRID_BUCKETS - 1 );
+}
+
 //=========================================================
 // CSound - Clear - zeros all fields for a sound
 //=========================================================
@@ -158,6 +178,8 @@ void CSoundEnt::FreeSound( int iSound, int iPrevious )
 		pSoundEnt->m_iActiveSound = pSoundEnt->m_SoundPool[iSound].m_iNext;
 	}
 
+	pSoundEnt->UnlinkSoundFromGrid( iSound );
+
 	// make iSound the head of the Free list.
 	pSoundEnt->m_SoundPool[iSound].m_iNext = pSoundEnt->m_iFreeSound;
 	pSoundEnt->m_iFreeSound = iSound;
@@ -171,7 +193,7 @@ int CSoundEnt::IAllocSound( void )
 {
 	int iNewSound;
 
-	if( m_iFreeSound == SOUNDLIST_EMPTY )
+	if( m_iFreeSound == SOUNDLIST_EMPTY && !GrowSoundPool() )
 	{
 		// no free sound!
 		ALERT( at_console, "Free Sound List is full!\n" );
@@ -189,9 +211,113 @@ int CSoundEnt::IAllocSound( void )
 
 	m_iActiveSound = iNewSound;// now make the new sound the top of the active list. You're done.
 
+	m_SoundLinks[iNewSound].sequence = ++m_iSequence;
+
 	return iNewSound;
 }
 
+//=========================================================
+// GrowSoundPool - doubles the sound pool up to the limit
+// set by sv_maxworldsounds and links new sounds into the
+// free list. Returns FALSE if the limit is reached.
+//=========================================================
+bool CSoundEnt::GrowSoundPool( void )
+{
+	const int iOldSize = (int)m_SoundPool.size();
+	const int iMaxSize = Q_max( (int)maxworldsounds.value, MAX_WORLD_SOUNDS );
+	const int iNewSize = Q_min( iOldSize * 2, iMaxSize );
+
+	if( iNewSize <= iOldSize )
+		return false;
+
+	m_SoundPool.resize( iNewSize );
+	m_SoundLinks.resize( iNewSize );
+
+	for( int i = iOldSize; i < iNewSize; i++ )
+	{
+		m_SoundPool[i].Clear();
+		m_SoundPool[i].m_iNext = i + 1;
+		m_SoundLinks[i] = SoundGridLink();
+	}
+	m_SoundPool[iNewSize - 1].m_iNext = m_iFreeSound;
+	m_iFreeSound = iOldSize;
+
+	ALERT( at_aiconsole, "Sound pool grew to %d sounds\n", iNewSize );
+	return true;
+}
+
+//=========================================================
+// LinkSoundToGrid - puts the sound into every grid cell
+// its volume reaches.
+//=========================================================
+void CSoundEnt::LinkSoundToGrid( int iSound )
+{
+	const CSound &sound = m_SoundPool[iSound];
+	SoundGridLink &link = m_SoundLinks[iSound];
+
+	link.minX = SoundGridCoord( sound.m_vecOrigin.x - sound.m_iVolume );
+	link.minY = SoundGridCoord( sound.m_vecOrigin.y - sound.m_iVolume );
+	link.maxX = SoundGridCoord( sound.m_vecOrigin.x + sound.m_iVolume );
+	link.maxY = SoundGridCoord( sound.m_vecOrigin.y + sound.m_iVolume );
+	link.linked = true;
+	link.global = ( link.maxX - link.minX + 1 ) * ( link.maxY - link.minY + 1 ) > SOUND_GRID_MAX_CELLS;
+
+	if( link.global )
+	{
+		m_GlobalSounds.push_back( iSound );
+	}
+	else
+	{
+		for( int x = link.minX; x <= link.maxX; x++ )
+		{
+			for( int y = link.minY; y <= link.maxY; y++ )
+			{
+				m_SoundGrid[SoundGridBucket( x, y )].push_back( iSound );
+			}
+		}
+	}
+
+	m_iLoudestSound = Q_max( m_iLoudestSound, sound.m_iVolume );
+}
+
+//=========================================================
+// UnlinkSoundFromGrid - removes the sound from the grid
+// cells it was put into.
+//=========================================================
+void CSoundEnt::UnlinkSoundFromGrid( int iSound )
+{
+	SoundGridLink &link = m_SoundLinks[iSound];
+	if( !link.linked )
+		return;
+
+	if( link.global )
+	{
+		std::vector<int>::iterator it = std::find( m_GlobalSounds.begin(), m_GlobalSounds.end(), iSound );
+		if( it != m_GlobalSounds.end() )
+		{
+			*it = m_GlobalSounds.back();
+			m_GlobalSounds.pop_back();
+		}
+	}
+	else
+	{
+		for( int x = link.minX; x <= link.maxX; x++ )
+		{
+			for( int y = link.minY; y <= link.maxY; y++ )
+			{
+				std::vector<int> &bucket = m_SoundGrid[SoundGridBucket( x, y )];
+				std::vector<int>::iterator it = std::find( bucket.begin(), bucket.end(), iSound );
+				if( it != bucket.end() )
+				{
+					*it = bucket.back();
+					bucket.pop_back();
+				}
+			}
+		}
+	}
+	link.linked = false;
+}
+
 //=========================================================
 // InsertSound - Allocates a free sound and fills it with 
 // sound info.
@@ -218,6 +344,8 @@ void CSoundEnt::InsertSound( int iType, const Vector &vecOrigin, int iVolume, fl
 	pSoundEnt->m_SoundPool[iThisSound].m_iType = iType;
 	pSoundEnt->m_SoundPool[iThisSound].m_iVolume = iVolume;
 	pSoundEnt->m_SoundPool[iThisSound].m_flExpireTime = gpGlobals->time + flDuration;
+
+	pSoundEnt->LinkSoundToGrid( iThisSound );
 }
 
 //=========================================================
@@ -232,8 +360,20 @@ void CSoundEnt::Initialize( void )
 	m_cLastActiveSounds = 0;
 	m_iFreeSound = 0;
 	m_iActiveSound = SOUNDLIST_EMPTY;
+	m_iSequence = 0;
+	m_iQueryMark = 0;
+	m_iLoudestSound = 0;
+
+	const int iPoolSize = Q_max( MAX_WORLD_SOUNDS, gpGlobals->maxClients * 2 );
+	m_SoundPool.assign( iPoolSize, CSound() );
+	m_SoundLinks.assign( iPoolSize, SoundGridLink() );
+	for( i = 0; i < SOUND_GRID_BUCKETS; i++ )
+	{
+		m_SoundGrid[i].clear();
+	}
+	m_GlobalSounds.clear();
 
-	for( i = 0; i < MAX_WORLD_SOUNDS; i++ )
+	for( i = 0; i < iPoolSize; i++ )
 	{
 		// clear all sounds, and link them into the free sound list.
 		m_SoundPool[i].Clear();
@@ -254,6 +394,10 @@ void CSoundEnt::Initialize( void )
 		}
 
 		pSoundEnt->m_SoundPool[iSound].m_flExpireTime = SOUND_NEVER_EXPIRE;
+
+		// client sounds are moved by players every frame, so they're not put into the grid
+		m_SoundLinks[iSound].linked = false;
+		m_GlobalSounds.push_back( iSound );
 	}
 
 	if( CVAR_GET_FLOAT( "displaysoundlist" ) == 1 )
@@ -342,7 +486,7 @@ CSound *CSoundEnt::SoundPointerForIndex( int iIndex )
 		return NULL;
 	}
 
-	if( iIndex > ( MAX_WORLD_SOUNDS - 1 ) )
+	if( iIndex >= (int)m_SoundPool.size() )
 	{
 		ALERT( at_console, "SoundPointerForIndex() - Index too large!\n" );
 		return NULL;
@@ -376,3 +520,76 @@ int CSoundEnt::ClientSoundIndex( edict_t *pClient )
 
 	return iReturn;
 }
+
+//=========================================================
+// BuildAudibleList - links the active sounds that match the
+// mask and can be heard from the passed position via their
+// m_iNextAudible fields. Only the grid cells around the
+// listener are visited. Like the list Listen used to build
+// while walking the active list, the oldest sound comes
+// first.
+//=========================================================
+int CSoundEnt::BuildAudibleList( const Vector &vecEar, float flSensitivity, int iMask )
+{
+	if( !pSoundEnt )
+	{
+		return SOUNDLIST_EMPTY;
+	}
+
+	pSoundEnt->m_iQueryMark++;
+	const unsigned int iMark = pSoundEnt->m_iQueryMark;
+	m_AudibleCandidates.clear();
+
+	// sounds are linked to the cells they reach with sensitivity 1, more sensitive listeners look further
+	const float flExtraRange = flSensitivity > 1.0f ? pSoundEnt->m_iLoudestSound * ( flSensitivity - 1.0f ) : 0.0f;
+	const int minX = SoundGridCoord( vecEar.x - flExtraRange );
+	const int minY = SoundGridCoord( vecEar.y - flExtraRange );
+	const int maxX = SoundGridCoord( vecEar.x + flExtraRange );
+	const int maxY = SoundGridCoord( vecEar.y + flExtraRange );
+
+	for( int x = minX; x <= maxX; x++ )
+	{
+		for( int y = minY; y <= maxY; y++ )
+		{
+			const std::vector<int> &bucket = m_SoundGrid[SoundGridBucket( x, y )];
+			for( size_t i = 0; i < bucket.size(); i++ )
+			{
+				const int iSound = bucket[i];
+				if( m_SoundLinks[iSound].queryMark != iMark )
+				{
+					m_SoundLinks[iSound].queryMark = iMark;
+					m_AudibleCandidates.push_back( iSound );
+				}
+			}
+		}
+	}
+	for( size_t i = 0; i < m_GlobalSounds.size(); i++ )
+	{
+		m_AudibleCandidates.push_back( m_GlobalSounds[i] );
+	}
+
+	// walk from the newest to the oldest like the active list, prepending leaves the oldest at the head
+	std::sort( m_AudibleCandidates.begin(), m_AudibleCandidates.end(), []( int a, int b ) {
+		return m_SoundLinks[a].sequence > m_SoundLinks[b].sequence;
+	});
+
+	int iAudibleList = SOUNDLIST_EMPTY;
+	for( size_t i = 0; i < m_AudibleCandidates.size(); i++ )
+	{
+		const int iSound = m_AudibleCandidates[i];
+		CSound &sound = m_SoundPool[iSound];
+
+		if( !( sound.m_iType & iMask ) )
+			continue;
+
+		const float flRange = sound.m_iVolume * flSensitivity;
+		const Vector vecDelta = sound.m_vecOrigin - vecEar;
+		if( flRange < 0.0f || DotProduct( vecDelta, vecDelta ) > flRange * flRange )
+			continue;
+
+		sound.m_iNextAudible = iAudibleList;
+		iAudibleList = iSound;
+	}
+
+	return iAudibleList;
+}
@@ -21,7 +21,12 @@
 #if !defined(SOUNDENT_H)
 #define SOUNDENT_H
 
-#define	MAX_WORLD_SOUNDS	64 // maximum number of sounds handled by the world at one time.
+#include <vector>
+
+#define	MAX_WORLD_SOUNDS	64 // initial number of sounds handled by the world at one time. The pool grows up to sv_maxworldsounds.
+#define SOUND_GRID_CELL_SIZE	512 // size of the grid cell sounds are bucketed by
+#define SOUND_GRID_BUCKETS	256
+#define SOUND_GRID_MAX_CELLS	64 // sounds covering more cells are checked by every listener
 
 #define bits_SOUND_NONE		0
 #define	bits_SOUND_COMBAT	( 1 << 0 )// gunshots, explosions
@@ -81,10 +86,14 @@ public:
 	static int		FreeList( void );// return the head of the free list
 	static CSound*	SoundPointerForIndex( int iIndex );// return a pointer for this index in the sound list
 	static int		ClientSoundIndex ( edict_t *pClient );
+	static int		BuildAudibleList( const Vector &vecEar, float flSensitivity, int iMask );// link the sounds that can be heard from this position, return the head of the list
 
 	BOOL	IsEmpty( void ) { return m_iActiveSound == SOUNDLIST_EMPTY; }
 	int		ISoundsInList ( int iListType );
 	int		IAllocSound ( void );
+	bool	GrowSoundPool ( void );
+	void	LinkSoundToGrid ( int iSound );
+	void	UnlinkSoundFromGrid ( int iSound );
 	virtual int		ObjectCaps( void ) { return FCAP_DONT_SAVE; }
 
 	int		m_iFreeSound;	// index of the first sound in the free sound list
@@ -93,6 +102,23 @@ public:
 	BOOL	m_fShowReport; // if true, dump information about free/active sounds.
 
 private:
-	CSound		m_SoundPool[ MAX_WORLD_SOUNDS ];
+	// CSoundEnt is allocated by the engine and never destructed, so the pool can't be an instance member
+	struct SoundGridLink
+	{
+		int minX, minY, maxX, maxY;
+		unsigned int sequence; // allocation order, the newest sounds come first in the active list
+		unsigned int queryMark;
+		bool linked;
+		bool global;
+	};
+
+	static std::vector<CSound> m_SoundPool;
+	static std::vector<SoundGridLink> m_SoundLinks;
+	static std::vector<int> m_SoundGrid[SOUND_GRID_BUCKETS];
+	static std::vector<int> m_GlobalSounds;
+	static std::vector<int> m_AudibleCandidates;
+	unsigned int m_iSequence;
+	unsigned int m_iQueryMark;
+	int m_iLoudestSound;
 };
 #endif // SOUNDENT_H
@@ -3,6 +3,7 @@
 #include "soundscripts.h"
 #include "util.h"
 #include "icase_compare.h"
+#include "string_pool.h"
 
 #include <map>
 #include <set>
@@ -252,14 +253,7 @@ void SoundScriptSystem::AddSoundScriptFromJsonValue(const char *name, Value &val
 			soundScript.waveCount = arr.Size();
 			for (size_t i=0; i<soundScript.waveCount; ++i)
 			{
-				std::string str = arr[i].GetString();
-				auto strIt = _waveStringSet.find(str);
-				if (strIt == _waveStringSet.end())
-				{
-					auto p = _waveStringSet.insert(str);
-					strIt = p.first;
-				}
-				soundScript.waves[i] = strIt->c_str();
+				soundScript.waves[i] = g_StringPool.Intern(arr[i].GetString(), arr[i].GetStringLength());
 			}
 			soundScriptMeta.wavesSet = true;
 		}
@@ -290,20 +284,46 @@ void SoundScriptSystem::AddSoundScriptFromJsonValue(const char *name, Value &val
 	}
 	soundScriptMeta.pitchSet = UpdatePropertyFromJson(soundScript.pitch, value, "pitch");
 
-	_soundScripts[name] = std::make_pair(soundScript, soundScriptMeta);
+	AddSoundScript(name, soundScript, soundScriptMeta);
 }
 
-const SoundScript* SoundScriptSystem::GetSoundScript(const char *name)
+SoundScriptHandle SoundScriptSystem::AddSoundScript(const char *name, const SoundScript &soundScript, const SoundScriptMeta &meta)
+{
+	auto it = _soundScriptSlots.find(name);
+	if (it != _soundScriptSlots.end())
+	{
+		_soundScripts[it->second] = std::make_pair(soundScript, meta);
+		return SoundScriptHandle(it->second);
+	}
+	const int slot = (int)_soundScripts.size();
+	_soundScripts.push_back(std::make_pair(soundScript, meta));
+	_soundScriptSlots[name] = slot;
+	return SoundScriptHandle(slot);
+}
+
+SoundScriptHandle SoundScriptSystem::FindSoundScript(const char *name)
 {
 	if (!name || *name == '\0')
-		return nullptr;
+		return SoundScriptHandle();
 	_temp = name; // reuse the same std::string for search to avoid reallocation
-	auto it = _soundScripts.find(_temp);
-	if (it != _soundScripts.end())
-		return &it->second.first;
+	auto it = _soundScriptSlots.find(_temp);
+	if (it != _soundScriptSlots.end())
+		return SoundScriptHandle(it->second);
+	return SoundScriptHandle();
+}
+
+const SoundScript* SoundScriptSystem::GetSoundScript(SoundScriptHandle handle) const
+{
+	if (handle.IsValid())
+		return &_soundScripts[handle.index].first;
 	return nullptr;
 }
 
+const SoundScript* SoundScriptSystem::GetSoundScript(const char *name)
+{
+	return GetSoundScript(FindSoundScript(name));
+}
+
 static void MarkSoundScriptAllDefined(SoundScriptMeta& meta)
 {
 	meta.defaultSet = true;
@@ -342,12 +362,11 @@ void SoundScriptSystem::EnsureExistingScriptDefined(SoundScript& existing, Sound
 
 const SoundScript* SoundScriptSystem::ProvideDefaultSoundScript(const char *name, const SoundScript &soundScript)
 {
-	_temp = name;
-	auto it = _soundScripts.find(_temp);
-	if (it != _soundScripts.end())
+	const SoundScriptHandle handle = FindSoundScript(name);
+	if (handle.IsValid())
 	{
-		SoundScript& existing = it->second.first;
-		SoundScriptMeta& meta = it->second.second;
+		SoundScript& existing = _soundScripts[handle.index].first;
+		SoundScriptMeta& meta = _soundScripts[handle.index].second;
 		EnsureExistingScriptDefined(existing, meta, soundScript);
 		return &existing;
 	}
@@ -355,23 +374,17 @@ const SoundScript* SoundScriptSystem::ProvideDefaultSoundScript(const char *name
 	{
 		SoundScriptMeta meta;
 		MarkSoundScriptAllDefined(meta);
-		auto inserted = _soundScripts.insert(std::make_pair(_temp, std::make_pair(soundScript, meta)));
-		if (inserted.second)
-		{
-			return &inserted.first->second.first;
-		}
-		return nullptr;
+		return GetSoundScript(AddSoundScript(name, soundScript, meta));
 	}
 }
 
 const SoundScript* SoundScriptSystem::ProvideDefaultSoundScript(const char *derivative, const char *base, const SoundScript &soundScript, const SoundScriptParamOverride paramOverride)
 {
-	_temp = derivative;
-	auto it = _soundScripts.find(_temp);
-	if (it != _soundScripts.end())
+	const SoundScriptHandle handle = FindSoundScript(derivative);
+	if (handle.IsValid())
 	{
-		SoundScript& existing = it->second.first;
-		SoundScriptMeta& meta = it->second.second;
+		SoundScript& existing = _soundScripts[handle.index].first;
+		SoundScriptMeta& meta = _soundScripts[handle.index].second;
 
 		if (!meta.defaultSet)
 		{
@@ -481,9 +494,9 @@ void SoundScriptSystem::DumpSoundScriptImpl(const char *name, const SoundScript
 
 void SoundScriptSystem::DumpSoundScripts()
 {
-	for (const auto& p : _soundScripts)
+	for (const auto& p : _soundScriptSlots)
 	{
-		DumpSoundScriptImpl(p.first.c_str(),  p.second.first, p.second.second);
+		DumpSoundScriptImpl(p.first.c_str(),  _soundScripts[p.second].first, _soundScripts[p.second].second);
 	}
 }
 
@@ -495,12 +508,12 @@ void SoundScriptSystem::DumpSoundScript(const char *name)
 	if (_temp[_temp.size()-1] == '.' || _temp[_temp.size()-1] == '#')
 	{
 		bool foundSomething = false;
-		for (const auto& p : _soundScripts)
+		for (const auto& p : _soundScriptSlots)
 		{
 			if (strnicmp(p.first.c_str(), _temp.c_str(), _temp.size()) == 0)
 			{
 				foundSomething = true;
-				DumpSoundScriptImpl(p.first.c_str(),  p.second.first, p.second.second);
+				DumpSoundScriptImpl(p.first.c_str(),  _soundScripts[p.second].first, _soundScripts[p.second].second);
 			}
 		}
 		if (foundSomething)
@@ -508,10 +521,10 @@ void SoundScriptSystem::DumpSoundScript(const char *name)
 	}
 	else
 	{
-		auto it = _soundScripts.find(_temp);
-		if (it != _soundScripts.end())
+		auto it = _soundScriptSlots.find(_temp);
+		if (it != _soundScriptSlots.end())
 		{
-			DumpSoundScriptImpl(name, it->second.first, it->second.second);
+			DumpSoundScriptImpl(name, _soundScripts[it->second].first, _soundScripts[it->second].second);
 			return;
 		}
 	}
@@ -9,8 +9,8 @@
 #include "rapidjson/document.h"
 #include "template_property_types.h"
 
+#include <deque>
 #include <map>
-#include <set>
 #include <string>
 #include "icase_compare.h"
 
@@ -34,6 +34,17 @@ private:
 	void SetSoundList(std::initializer_list<const char*> sounds);
 };
 
+// Slot of a sound script in SoundScriptSystem. Slots are never removed, so a handle stays valid for the whole game.
+struct SoundScriptHandle
+{
+	SoundScriptHandle(): index(-1) {}
+	explicit SoundScriptHandle(int i): index(i) {}
+	bool IsValid() const {
+		return index >= 0;
+	}
+	int index;
+};
+
 struct NamedSoundScript : public SoundScript
 {
 	NamedSoundScript(int soundChannel, std::initializer_list<const char*> sounds, FloatRange soundVolume, float soundAttenuation, IntRange soundPitch, const char* scriptName):
@@ -99,6 +110,8 @@ class SoundScriptSystem
 public:
 	bool ReadFromFile(const char* fileName);
 	void AddSoundScriptFromJsonValue(const char* name, rapidjson::Value& value);
+	SoundScriptHandle FindSoundScript(const char* name);
+	const SoundScript* GetSoundScript(SoundScriptHandle handle) const;
 	const SoundScript* GetSoundScript(const char* name);
 	const SoundScript* ProvideDefaultSoundScript(const char* name, const SoundScript& soundScript);
 	const SoundScript* ProvideDefaultSoundScript(const char* derivative, const char* base, const SoundScript& soundScript, const SoundScriptParamOverride paramOverride = SoundScriptParamOverride());
@@ -110,8 +123,11 @@ private:
 
 	static constexpr const char* notDefinedYet = "waiting for default";
 
-	std::map<std::string, std::pair<SoundScript, SoundScriptMeta>, CaseInsensitiveCompare> _soundScripts;
-	std::set<std::string> _waveStringSet;
+	SoundScriptHandle AddSoundScript(const char* name, const SoundScript& soundScript, const SoundScriptMeta& meta);
+
+	// Scripts are stored by slot, the map only resolves names. std::deque keeps returned pointers valid when it grows.
+	std::map<std::string, int, CaseInsensitiveCompare> _soundScriptSlots;
+	std::deque<std::pair<SoundScript, SoundScriptMeta> > _soundScripts;
 	std::string _temp;
 };
 
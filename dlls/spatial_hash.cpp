@@ -0,0 +1,410 @@
+#include "extdll.h"
+#include "util.h"
+#include "cbase.h"
+#include "game.h"
+#include "spatial_hash.h"
+
+#include <algorithm>
+#include <cmath>
+
+CEntitySpatialHash g_EntitySpatialHash;
+
+CEntitySpatialHash::CEntitySpatialHash():
+	_queryMark(0), _modificationCount(0),
+	_queryCount(0), _fallbackCount(0), _candidatesVisited(0), _sphereIteratorRebuilds(0), _relinkCount(0)
+{
+	_sphereIterator.valid = false;
+}
+
+void CEntitySpatialHash::Clear()
+{
+	for( int i = 0; i < BUCKET_COUNT; ++i )
+		_buckets[i].clear();
+	_oversized.clear();
+	_entities.clear();
+	_queryMarks.clear();
+	_queryMark = 0;
+	_sphereIterator.valid = false;
+	_modificationCount++;
+}
+
+void CEntitySpatialHash::Rebuild()
+{
+	Clear();
+
+	edict_t *pEdict = INDEXENT( 0 );
+	if( !pEdict )
+		return;
+
+	for( int i = 1; i < gpGlobals->maxEntities; i++ )
+	{
+		if( pEdict[i].free )
+			continue;
+		Update( &pEdict[i] );
+	}
+}
+
+bool CEntitySpatialHash::IsActive() const
+{
+	return sv_spatialhash.value != 0;
+}
+
+int CEntitySpatialHash::CellCoord( float f )
+{
+	return (int)floor( f / CELL_SIZE );
+}
+
+unsigned int CEntitySpatialHash::BucketIndex( int x, int y )
+{
+	return ( (unsigned int)x * 73856093u ^ (unsigned int)y * 19349663u ) & ( BUCKET_COUNT - 1 );
+}
+
+void CEntitySpatialHash::EnsureCapacity( int index )
+{
+	if( index >= (int)_entities.size() )
+	{
+		const int newSize = Q_max( index + 1, gpGlobals->maxEntities );
+		EntityCells cells = {};
+		_entities.resize( newSize, cells );
+		_queryMarks.resize( newSize, 0 );
+	}
+}
+
+void CEntitySpatialHash::Update( edict_t *pent )
+{
+	if( !pent )
+		return;
+
+	const int index = ENTINDEX( pent );
+	if( index <= 0 )
+		return;
+
+	if( pent->free )
+	{
+		Remove( pent );
+		return;
+	}
+
+	EnsureCapacity( index );
+
+	// Monsters are tested by their origin, so make sure it's covered by the cells even when it's outside the bounding box
+	const entvars_t &v = pent->v;
+	EntityCells cells;
+	cells.minX = CellCoord( Q_min( v.absmin.x, v.origin.x ) );
+	cells.minY = CellCoord( Q_min( v.absmin.y, v.origin.y ) );
+	cells.maxX = CellCoord( Q_max( v.absmax.x, v.origin.x ) );
+	cells.maxY = CellCoord( Q_max( v.absmax.y, v.origin.y ) );
+	cells.oversizedPos = -1;
+	cells.linked = true;
+
+	const EntityCells &current = _entities[index];
+	if( current.linked && current.minX == cells.minX && current.minY == cells.minY
+		&& current.maxX == cells.maxX && current.maxY == cells.maxY )
+		return;
+
+	Unlink( index );
+	Link( index, cells );
+}
+
+void CEntitySpatialHash::Remove( edict_t *pent )
+{
+	if( !pent )
+		return;
+	const int index = ENTINDEX( pent );
+	if( index > 0 && index < (int)_entities.size() )
+		Unlink( index );
+}
+
+void CEntitySpatialHash::Link( int index, const EntityCells &cells )
+{
+	EntityCells &entity = _entities[index];
+	entity = cells;
+
+	const int cellCount = ( cells.maxX - cells.minX + 1 ) * ( cells.maxY - cells.minY + 1 );
+	if( cellCount > MAX_CELLS_PER_ENTITY || cellCount <= 0 )
+	{
+		entity.oversizedPos = (int)_oversized.size();
+		_oversized.push_back( index );
+	}
+	else
+	{
+		for( int x = cells.minX; x <= cells.maxX; ++x )
+		{
+			for( int y = cells.minY; y <= cells.maxY; ++y )
+			{
+				_buckets[BucketIndex( x, y )].push_back( index );
+			}
+		}
+	}
+	_modificationCount++;
+	_relinkCount++;
+}
+
+void CEntitySpatialHash::Unlink( int index )
+{
+	EntityCells &entity = _entities[index];
+	if( !entity.linked )
+		return;
+
+	if( entity.oversizedPos >= 0 )
+	{
+		const int last = _oversized.back();
+		_oversized[entity.oversizedPos] = last;
+		_entities[last].oversizedPos = entity.oversizedPos;
+		_oversized.pop_back();
+	}
+	else
+	{
+		for( int x = entity.minX; x <= entity.maxX; ++x )
+		{
+			for( int y = entity.minY; y <= entity.maxY; ++y )
+			{
+				std::vector<int> &bucket = _buckets[BucketIndex( x, y )];
+				std::vector<int>::iterator it = std::find( bucket.begin(), bucket.end(), index );
+				if( it != bucket.end() )
+				{
+					*it = bucket.back();
+					bucket.pop_back();
+				}
+			}
+		}
+	}
+	entity.linked = false;
+	entity.oversizedPos = -1;
+	_modificationCount++;
+}
+
+bool CEntitySpatialHash::GatherCandidates( const Vector &mins, const Vector &maxs )
+{
+	_queryCount++;
+	_candidates.clear();
+
+	const int minX = CellCoord( mins.x );
+	const int minY = CellCoord( mins.y );
+	const int maxX = CellCoord( maxs.x );
+	const int maxY = CellCoord( maxs.y );
+
+	if( maxX < minX || maxY < minY )
+		return true;
+
+	// Huge queries would visit more buckets than there are entities, the plain scan is cheaper then
+	if( ( maxX - minX + 1 ) * ( maxY - minY + 1 ) > MAX_CELLS_PER_QUERY )
+	{
+		_fallbackCount++;
+		return false;
+	}
+
+	_queryMark++;
+	if( _queryMark == 0 )
+	{
+		std::fill( _queryMarks.begin(), _queryMarks.end(), 0 );
+		_queryMark = 1;
+	}
+
+	for( int x = minX; x <= maxX; ++x )
+	{
+		for( int y = minY; y <= maxY; ++y )
+		{
+			const std::vector<int> &bucket = _buckets[BucketIndex( x, y )];
+			for( size_t i = 0; i < bucket.size(); ++i )
+			{
+				const int index = bucket[i];
+				if( _queryMarks[index] != _queryMark )
+				{
+					_queryMarks[index] = _queryMark;
+					_candidates.push_back( index );
+				}
+			}
+		}
+	}
+	for( size_t i = 0; i < _oversized.size(); ++i )
+	{
+		_candidates.push_back( _oversized[i] );
+	}
+
+	_candidatesVisited += _candidates.size();
+
+	// Callers expect the results in the edict order
+	std::sort( _candidates.begin(), _candidates.end() );
+	return true;
+}
+
+bool CEntitySpatialHash::EntitiesInBox( CBaseEntity **pList, int listMax, const Vector &mins, const Vector &maxs, int flagMask, int &count )
+{
+	count = 0;
+	if( !IsActive() )
+		return false;
+
+	edict_t *pEdictList = INDEXENT( 0 );
+	if( !pEdictList )
+		return true;
+
+	if( !GatherCandidates( mins, maxs ) )
+		return false;
+
+	for( size_t i = 0; i < _candidates.size() && count < listMax; ++i )
+	{
+		edict_t *pEdict = &pEdictList[_candidates[i]];
+		if( pEdict->free )
+			continue;
+
+		if( flagMask && !( pEdict->v.flags & flagMask ) )
+			continue;
+
+		if( mins.x > pEdict->v.absmax.x ||
+			mins.y > pEdict->v.absmax.y ||
+			mins.z > pEdict->v.absmax.z ||
+			maxs.x < pEdict->v.absmin.x ||
+			maxs.y < pEdict->v.absmin.y ||
+			maxs.z < pEdict->v.absmin.z )
+			continue;
+
+		CBaseEntity *pEntity = CBaseEntity::Instance( pEdict );
+		if( !pEntity )
+			continue;
+
+		pList[count] = pEntity;
+		count++;
+	}
+	return true;
+}
+
+bool CEntitySpatialHash::MonstersInSphere( CBaseEntity **pList, int listMax, const Vector &center, float radius, int &count )
+{
+	count = 0;
+	if( !IsActive() )
+		return false;
+
+	edict_t *pEdictList = INDEXENT( 0 );
+	if( !pEdictList )
+		return true;
+
+	const Vector delta( radius, radius, radius );
+	if( !GatherCandidates( center - delta, center + delta ) )
+		return false;
+
+	const float radiusSquared = radius * radius;
+
+	for( size_t i = 0; i < _candidates.size() && count < listMax; ++i )
+	{
+		edict_t *pEdict = &pEdictList[_candidates[i]];
+		if( pEdict->free )
+			continue;
+
+		if( !( pEdict->v.flags & ( FL_CLIENT | FL_MONSTER ) ) )
+			continue;
+
+		// Same test as in UTIL_MonstersInSphere: origin for X & Y, bounding box center for Z
+		float d = center.x - pEdict->v.origin.x;
+		float distance = d * d;
+		d = center.y - pEdict->v.origin.y;
+		distance += d * d;
+		d = center.z - ( pEdict->v.absmin.z + pEdict->v.absmax.z ) * 0.5f;
+		distance += d * d;
+		if( distance > radiusSquared )
+			continue;
+
+		CBaseEntity *pEntity = CBaseEntity::Instance( pEdict );
+		if( !pEntity )
+			continue;
+
+		pList[count] = pEntity;
+		count++;
+	}
+	return true;
+}
+
+bool CEntitySpatialHash::FindEntityInSphere( CBaseEntity *pStartEntity, const Vector &vecCenter, float flRadius, CBaseEntity *&pResult )
+{
+	pResult = NULL;
+	if( !IsActive() )
+		return false;
+
+	edict_t *pEdictList = INDEXENT( 0 );
+	if( !pEdictList )
+		return true;
+
+	// The callers iterate over the results passing the previous one as a start entity.
+	// Keep the candidate list between calls while the set of linked entities stays the same.
+	SphereIterator &it = _sphereIterator;
+	if( !it.valid || it.modificationCount != _modificationCount || it.radius != flRadius || it.center != vecCenter )
+	{
+		const Vector delta( flRadius, flRadius, flRadius );
+		if( !GatherCandidates( vecCenter - delta, vecCenter + delta ) )
+		{
+			it.valid = false;
+			return false;
+		}
+		it.candidates.swap( _candidates );
+		it.center = vecCenter;
+		it.radius = flRadius;
+		it.modificationCount = _modificationCount;
+		it.valid = true;
+		_sphereIteratorRebuilds++;
+	}
+
+	const int startIndex = pStartEntity ? pStartEntity->entindex() : 0;
+	const float radiusSquared = flRadius * flRadius;
+
+	std::vector<int>::const_iterator candidateIt = std::upper_bound( it.candidates.begin(), it.candidates.end(), startIndex );
+	for( ; candidateIt != it.candidates.end(); ++candidateIt )
+	{
+		const int index = *candidateIt;
+		edict_t *pEdict = &pEdictList[index];
+		if( pEdict->free || FStringNull( pEdict->v.classname ) )
+			continue;
+
+		// Skip unconnected client slots like the engine does
+		if( index <= gpGlobals->maxClients && !( pEdict->v.flags & FL_CLIENT ) )
+			continue;
+
+		float distSquared = 0.0f;
+		for( int j = 0; j < 3 && distSquared <= radiusSquared; j++ )
+		{
+			float d;
+			if( vecCenter[j] < pEdict->v.absmin[j] )
+				d = vecCenter[j] - pEdict->v.absmin[j];
+			else if( vecCenter[j] > pEdict->v.absmax[j] )
+				d = vecCenter[j] - pEdict->v.absmax[j];
+			else
+				d = 0.0f;
+			distSquared += d * d;
+		}
+		if( distSquared > radiusSquared )
+			continue;
+
+		pResult = CBaseEntity::Instance( pEdict );
+		if( pResult )
+			return true;
+	}
+	return true;
+}
+
+void CEntitySpatialHash::ReportStats()
+{
+	int linkedCount = 0;
+	for( size_t i = 0; i < _entities.size(); ++i )
+	{
+		if( _entities[i].linked )
+			linkedCount++;
+	}
+	int usedBuckets = 0;
+	size_t largestBucket = 0;
+	for( int i = 0; i < BUCKET_COUNT; ++i )
+	{
+		if( !_buckets[i].empty() )
+			usedBuckets++;
+		largestBucket = Q_max( largestBucket, _buckets[i].size() );
+	}
+
+	ALERT( at_console, "Entity spatial hash is %s\n", IsActive() ? "active" : "inactive" );
+	ALERT( at_console, "Linked entities: %d (oversized: %d)\n", linkedCount, (int)_oversized.size() );
+	ALERT( at_console, "Used buckets: %d/%d. Largest bucket: %d\n", usedBuckets, BUCKET_COUNT, (int)largestBucket );
+	ALERT( at_console, "Queries: %u. Fallbacks to edict scan: %u. Candidates visited: %u\n", _queryCount, _fallbackCount, _candidatesVisited );
+	ALERT( at_console, "Relinks: %u. Sphere iterator rebuilds: %u\n", _relinkCount, _sphereIteratorRebuilds );
+}
+
+void DumpEntitySpatialHash()
+{
+	g_EntitySpatialHash.ReportStats();
+}
@@ -0,0 +1,83 @@
+#pragma once
+#ifndef SPATIAL_HASH_H
+#define SPATIAL_HASH_H
+
+#include <vector>
+
+class CBaseEntity;
+
+// Uniform 2D grid over entity absolute bounding boxes.
+// Entries are kept up to date from the engine's SetAbsBox callback which is invoked on every link of the edict,
+// so queries see the same positions the engine collision code does.
+class CEntitySpatialHash
+{
+public:
+	CEntitySpatialHash();
+
+	void Clear();
+	void Rebuild();
+	void Update( edict_t *pent );
+	void Remove( edict_t *pent );
+
+	bool IsActive() const;
+
+	// These return false if the query can't be served by the hash and the caller should fall back to the edict scan
+	bool EntitiesInBox( CBaseEntity **pList, int listMax, const Vector &mins, const Vector &maxs, int flagMask, int &count );
+	bool MonstersInSphere( CBaseEntity **pList, int listMax, const Vector &center, float radius, int &count );
+	bool FindEntityInSphere( CBaseEntity *pStartEntity, const Vector &vecCenter, float flRadius, CBaseEntity *&pResult );
+
+	void ReportStats();
+
+	static const int CELL_SIZE = 256;
+	static const int BUCKET_COUNT = 4096;
+	static const int MAX_CELLS_PER_ENTITY = 16;
+	static const int MAX_CELLS_PER_QUERY = BUCKET_COUNT / 2;
+
+private:
+	struct EntityCells
+	{
+		int minX, minY, maxX, maxY;
+		int oversizedPos;
+		bool linked;
+	};
+
+	static int CellCoord( float f );
+	static unsigned int BucketIndex( int x, int y );
+
+	void EnsureCapacity( int index );
+	void Link( int index, const EntityCells &cells );
+	void Unlink( int index );
+	bool GatherCandidates( const Vector &mins, const Vector &maxs );
+
+	std::vector<int> _buckets[BUCKET_COUNT];
+	std::vector<int> _oversized;
+	std::vector<EntityCells> _entities;
+	std::vector<unsigned int> _queryMarks;
+	std::vector<int> _candidates;
+	unsigned int _queryMark;
+
+	// Modified each time an entity changes its set of cells. Used to validate the sphere iterator cache.
+	unsigned int _modificationCount;
+
+	struct SphereIterator
+	{
+		Vector center;
+		float radius;
+		unsigned int modificationCount;
+		bool valid;
+		std::vector<int> candidates;
+	};
+	SphereIterator _sphereIterator;
+
+	unsigned int _queryCount;
+	unsigned int _fallbackCount;
+	unsigned int _candidatesVisited;
+	unsigned int _sphereIteratorRebuilds;
+	unsigned int _relinkCount;
+};
+
+extern CEntitySpatialHash g_EntitySpatialHash;
+
+void DumpEntitySpatialHash();
+
+#endif
@@ -0,0 +1,141 @@
+#include "extdll.h"
+#include "util.h"
+#include "cbase.h"
+#include "spawn_points.h"
+
+CSpawnPointRegistry g_SpawnPointRegistry;
+
+#define SPAWN_POINT_CLEAR_RADIUS 128
+
+CSpawnPointRegistry::CSpawnPointRegistry()
+{
+	ResetStats();
+}
+
+void CSpawnPointRegistry::Clear()
+{
+	_lists.clear();
+}
+
+void CSpawnPointRegistry::Invalidate()
+{
+	for( size_t i = 0; i < _lists.size(); ++i )
+		_lists[i].valid = false;
+}
+
+std::vector<EHANDLE>& CSpawnPointRegistry::EnabledSpawnPoints( const char *className )
+{
+	SpawnPointList *pList = NULL;
+	for( size_t i = 0; i < _lists.size(); ++i )
+	{
+		if( _lists[i].className == className )
+		{
+			pList = &_lists[i];
+			break;
+		}
+	}
+	if( !pList )
+	{
+		_lists.push_back( SpawnPointList() );
+		pList = &_lists.back();
+		pList->className = className;
+		pList->valid = false;
+	}
+
+	if( !pList->valid )
+		Build( *pList );
+	return pList->enabled;
+}
+
+void CSpawnPointRegistry::Build( SpawnPointList &list )
+{
+	list.enabled.clear();
+
+	CBaseEntity *pSpot = NULL;
+	while( ( pSpot = UTIL_FindEntityByClassname( pSpot, list.className.c_str() ) ) != NULL )
+	{
+		if( !FBitSet( pSpot->pev->spawnflags, SF_SPAWNPOINT_OFF ) )
+		{
+			EHANDLE hSpot;
+			hSpot = pSpot;
+			list.enabled.push_back( hSpot );
+		}
+	}
+	list.valid = true;
+	_rebuildCount++;
+}
+
+int CSpawnPointRegistry::FindOccupants( CBaseEntity *pPlayer, const Vector &origin, CBaseEntity **pList )
+{
+	// Only clients are gathered from the spatial hash, then checked against the sphere the same way the engine does
+	const Vector delta( SPAWN_POINT_CLEAR_RADIUS, SPAWN_POINT_CLEAR_RADIUS, SPAWN_POINT_CLEAR_RADIUS );
+	const int count = UTIL_EntitiesInBox( pList, MAX_OCCUPANTS, origin - delta, origin + delta, FL_CLIENT );
+	const float radiusSquared = SPAWN_POINT_CLEAR_RADIUS * SPAWN_POINT_CLEAR_RADIUS;
+
+	_occupancyQueries++;
+
+	int occupants = 0;
+	for( int i = 0; i < count; ++i )
+	{
+		CBaseEntity *pEntity = pList[i];
+		if( pEntity == pPlayer || !pEntity->IsPlayer() )
+			continue;
+
+		float distSquared = 0.0f;
+		for( int j = 0; j < 3; j++ )
+		{
+			float d;
+			if( origin[j] < pEntity->pev->absmin[j] )
+				d = origin[j] - pEntity->pev->absmin[j];
+			else if( origin[j] > pEntity->pev->absmax[j] )
+				d = origin[j] - pEntity->pev->absmax[j];
+			else
+				d = 0.0f;
+			distSquared += d * d;
+		}
+		if( distSquared > radiusSquared )
+			continue;
+
+		pList[occupants++] = pEntity;
+	}
+
+	_occupantsFound += occupants;
+	return occupants;
+}
+
+bool CSpawnPointRegistry::IsOccupied( CBaseEntity *pPlayer, const Vector &origin )
+{
+	CBaseEntity *pList[MAX_OCCUPANTS];
+	return FindOccupants( pPlayer, origin, pList ) > 0;
+}
+
+void CSpawnPointRegistry::ClearOccupants( CBaseEntity *pPlayer, const Vector &origin )
+{
+	CBaseEntity *pList[MAX_OCCUPANTS];
+	const int count = FindOccupants( pPlayer, origin, pList );
+	for( int i = 0; i < count; ++i )
+		pList[i]->TakeDamage( VARS( INDEXENT( 0 ) ), VARS( INDEXENT( 0 ) ), 300, DMG_GENERIC );
+}
+
+void CSpawnPointRegistry::ReportStats()
+{
+	for( size_t i = 0; i < _lists.size(); ++i )
+	{
+		const SpawnPointList &list = _lists[i];
+		ALERT( at_console, "%s: %d enabled%s\n", list.className.c_str(), (int)list.enabled.size(), list.valid ? "" : " (stale)" );
+	}
+	ALERT( at_console, "List rebuilds: %u\n", _rebuildCount );
+	ALERT( at_console, "Occupancy queries: %u, occupants found: %u\n", _occupancyQueries, _occupantsFound );
+}
+
+void CSpawnPointRegistry::ResetStats()
+{
+	_rebuildCount = _occupancyQueries = _occupantsFound = 0;
+}
+
+void DumpSpawnPoints()
+{
+	g_SpawnPointRegistry.ReportStats();
+	if( CMD_ARGC() > 1 && FStrEq( CMD_ARGV( 1 ), "reset" ) )
+		g_SpawnPointRegistry.ResetStats();
+}
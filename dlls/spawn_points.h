@@ -0,0 +1,59 @@
+#pragma once
+#ifndef SPAWN_POINTS_H
+#define SPAWN_POINTS_H
+
+#include <string>
+#include <vector>
+
+class CBaseEntity;
+
+#define SF_SPAWNPOINT_OFF 2
+
+// Enabled spawn points of each classname in edict order.
+// Lists are built on first use after a level start and rebuilt lazily when a spawn point is created or toggled.
+// Removed spawn points are skipped through their handles, and the spawn flags are still checked on selection,
+// so a list that missed a change can only cost a candidate, never return a disabled spot.
+class CSpawnPointRegistry
+{
+public:
+	CSpawnPointRegistry();
+
+	void Clear();
+	void Invalidate();
+
+	// Returns the enabled spawn points of the given classname
+	std::vector<EHANDLE>& EnabledSpawnPoints( const char *className );
+
+	// Checks if there's a player other than pPlayer within the 128 units of the spot
+	bool IsOccupied( CBaseEntity *pPlayer, const Vector &origin );
+	// Kills players other than pPlayer within the 128 units of the spot
+	void ClearOccupants( CBaseEntity *pPlayer, const Vector &origin );
+
+	void ReportStats();
+	void ResetStats();
+
+	static const int MAX_OCCUPANTS = 64;
+
+private:
+	struct SpawnPointList
+	{
+		std::string className;
+		bool valid;
+		std::vector<EHANDLE> enabled;
+	};
+
+	void Build( SpawnPointList &list );
+	int FindOccupants( CBaseEntity *pPlayer, const Vector &origin, CBaseEntity **pList );
+
+	std::vector<SpawnPointList> _lists;
+
+	unsigned int _rebuildCount;
+	unsigned int _occupancyQueries;
+	unsigned int _occupantsFound;
+};
+
+extern CSpawnPointRegistry g_SpawnPointRegistry;
+
+void DumpSpawnPoints();
+
+#endif
@@ -0,0 +1,165 @@
+#include "extdll.h"
+#include "util.h"
+#include "string_pool.h"
+
+CStringPool g_StringPool;
+
+CStringPool::CStringPool(): _count(0), _blockUsed(BLOCK_SIZE), _bytesStored(0), _engineGeneration(1)
+{
+	ResetStats();
+}
+
+CStringPool::~CStringPool()
+{
+	for( size_t i = 0; i < _blocks.size(); i++ )
+		free( _blocks[i] );
+}
+
+unsigned int CStringPool::Hash( const char *str, size_t length )
+{
+	unsigned int hash = 2166136261u;
+	for( size_t i = 0; i < length; i++ )
+	{
+		hash ^= (unsigned char)str[i];
+		hash *= 16777619u;
+	}
+	return hash;
+}
+
+const char *CStringPool::Store( const char *str, size_t length )
+{
+	const size_t size = length + 1;
+	char *dest;
+	if( size > BLOCK_SIZE / 4 )
+	{
+		// Big strings get a block of their own so the current block isn't wasted
+		dest = (char *)malloc( size );
+		_blocks.push_back( dest );
+	}
+	else
+	{
+		if( _blockUsed + size > BLOCK_SIZE )
+		{
+			_blocks.push_back( (char *)malloc( BLOCK_SIZE ) );
+			_blockUsed = 0;
+		}
+		dest = _blocks.back() + _blockUsed;
+		_blockUsed += size;
+	}
+
+	memcpy( dest, str, length );
+	dest[length] = '\0';
+	_bytesStored += size;
+	return dest;
+}
+
+void CStringPool::Grow()
+{
+	std::vector<Entry> oldSlots;
+	oldSlots.swap( _slots );
+
+	Entry empty = {};
+	_slots.assign( oldSlots.empty() ? INITIAL_SLOTS : oldSlots.size() * 2, empty );
+
+	const unsigned int mask = (unsigned int)_slots.size() - 1;
+	for( size_t i = 0; i < oldSlots.size(); i++ )
+	{
+		if( !oldSlots[i].text )
+			continue;
+
+		unsigned int slot = oldSlots[i].hash & mask;
+		while( _slots[slot].text )
+			slot = ( slot + 1 ) & mask;
+		_slots[slot] = oldSlots[i];
+	}
+}
+
+CStringPool::Entry &CStringPool::Lookup( const char *str, size_t length )
+{
+	// Keep the table at most half full so probe sequences stay short
+	if( ( _count + 1 ) * 2 > (int)_slots.size() )
+		Grow();
+
+	_lookups++;
+
+	const unsigned int hash = Hash( str, length );
+	const unsigned int mask = (unsigned int)_slots.size() - 1;
+	unsigned int slot = hash & mask;
+	for( ;; )
+	{
+		_probes++;
+
+		Entry &entry = _slots[slot];
+		if( !entry.text )
+		{
+			entry.text = Store( str, length );
+			entry.hash = hash;
+			entry.length = (unsigned int)length;
+			entry.engineString = iStringNull;
+			entry.engineGeneration = 0;
+			_count++;
+			return entry;
+		}
+		if( entry.hash == hash && entry.length == length && memcmp( entry.text, str, length ) == 0 )
+			return entry;
+
+		slot = ( slot + 1 ) & mask;
+	}
+}
+
+const char *CStringPool::Intern( const char *str )
+{
+	return Lookup( str, strlen( str ) ).text;
+}
+
+const char *CStringPool::Intern( const char *str, size_t length )
+{
+	return Lookup( str, length ).text;
+}
+
+string_t CStringPool::EngineString( const char *str )
+{
+	Entry &entry = Lookup( str, strlen( str ) );
+	if( entry.engineGeneration != _engineGeneration )
+	{
+		entry.engineString = g_engfuncs.pfnAllocString( entry.text );
+		entry.engineGeneration = _engineGeneration;
+		_engineAllocs++;
+	}
+	return entry.engineString;
+}
+
+void CStringPool::ClearEngineStrings()
+{
+	_engineGeneration++;
+	if( _engineGeneration == 0 )
+	{
+		for( size_t i = 0; i < _slots.size(); i++ )
+			_slots[i].engineGeneration = 0;
+		_engineGeneration = 1;
+	}
+}
+
+void CStringPool::ReportStats()
+{
+	ALERT( at_console, "Interned strings: %d (%u bytes in %d blocks)\n", _count, (unsigned int)_bytesStored, (int)_blocks.size() );
+	if( !_slots.empty() )
+		ALERT( at_console, "Table slots: %d (%.1f%% used)\n", (int)_slots.size(), (float)_count * 100.0f / _slots.size() );
+	ALERT( at_console, "Lookups: %u", _lookups );
+	if( _lookups )
+		ALERT( at_console, ", probes per lookup: %.2f", (float)_probes / _lookups );
+	ALERT( at_console, "\n" );
+	ALERT( at_console, "Engine strings allocated: %u\n", _engineAllocs );
+}
+
+void CStringPool::ResetStats()
+{
+	_lookups = _probes = _engineAllocs = 0;
+}
+
+void DumpStringPool()
+{
+	g_StringPool.ReportStats();
+	if( CMD_ARGC() > 1 && FStrEq( CMD_ARGV( 1 ), "reset" ) )
+		g_StringPool.ResetStats();
+}
@@ -0,0 +1,69 @@
+#pragma once
+#ifndef STRING_POOL_H
+#define STRING_POOL_H
+
+#include <cstddef>
+#include <vector>
+
+// Interned strings shared by ALLOC_STRING and the visual and sound script systems.
+// Text is copied into arena blocks that are never moved or freed, so interned pointers stay valid
+// until the library is unloaded. Lookups hash the text once and probe an open addressing table,
+// nothing is allocated unless the string hasn't been seen before.
+class CStringPool
+{
+public:
+	CStringPool();
+	~CStringPool();
+
+	const char *Intern( const char *str );
+	const char *Intern( const char *str, size_t length );
+
+	// Engine copy of the string for the current map, allocated on the first request
+	string_t EngineString( const char *str );
+	// Engine strings are released on map change, the interned text stays
+	void ClearEngineStrings();
+
+	void ReportStats();
+	void ResetStats();
+
+	static const int INITIAL_SLOTS = 4096;
+	static const size_t BLOCK_SIZE = 64 * 1024;
+
+private:
+	CStringPool( const CStringPool & );
+	CStringPool &operator=( const CStringPool & );
+
+	struct Entry
+	{
+		const char *text;
+		unsigned int hash;
+		unsigned int length;
+		string_t engineString;
+		unsigned int engineGeneration;
+	};
+
+	static unsigned int Hash( const char *str, size_t length );
+
+	Entry &Lookup( const char *str, size_t length );
+	const char *Store( const char *str, size_t length );
+	void Grow();
+
+	std::vector<Entry> _slots;
+	int _count;
+
+	std::vector<char *> _blocks;
+	size_t _blockUsed;
+	size_t _bytesStored;
+
+	unsigned int _engineGeneration;
+
+	unsigned int _lookups;
+	unsigned int _probes;
+	unsigned int _engineAllocs;
+};
+
+extern CStringPool g_StringPool;
+
+void DumpStringPool();
+
+#endif
@@ -25,6 +25,8 @@
 #include "cbase.h"
 #include "saverestore.h"
 #include "nodes.h"
+#include "route_search.h"
+#include "spawn_points.h"
 #include "doors.h"
 
 extern BOOL FEntIsVisible( entvars_t *pev, entvars_t *pevTarget );
@@ -55,10 +57,15 @@ LINK_ENTITY_TO_CLASS( info_null, CNullEntity )
 class CSpawnPoint : public CPointEntity
 {
 public:
+	void Spawn( void );
 	void Use( CBaseEntity *pActivator, CBaseEntity *pCaller, USE_TYPE useType, float value );
 };
 
-#define SF_SPAWNPOINT_OFF 2
+void CSpawnPoint::Spawn( void )
+{
+	CPointEntity::Spawn();
+	g_SpawnPointRegistry.Invalidate();
+}
 
 void CSpawnPoint::Use(CBaseEntity *pActivator, CBaseEntity *pCaller, USE_TYPE useType, float value)
 {
@@ -68,6 +75,7 @@ void CSpawnPoint::Use(CBaseEntity *pActivator, CBaseEntity *pCaller, USE_TYPE us
 			ClearBits(pev->spawnflags, SF_SPAWNPOINT_OFF);
 		else
 			SetBits(pev->spawnflags, SF_SPAWNPOINT_OFF);
+		g_SpawnPointRegistry.Invalidate();
 	}
 }
 
@@ -121,10 +129,14 @@ void CBaseEntity::UpdateOnRemove( void )
 				WorldGraph.m_pLinkPool[i].m_pLinkEnt = NULL;
 			}
 		}
+		g_RouteSearch.InvalidateCache();
 	}
 
 	if( pev->globalname )
 		gGlobalState.EntitySetState( pev->globalname, GLOBAL_DEAD );
+
+	// The edict stays findable until the engine frees it, subclasses may clear the name before that
+	g_EntityNameIndex.MarkPending( edict() );
 }
 
 // Convenient way to delay removing oneself
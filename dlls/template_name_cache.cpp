@@ -0,0 +1,78 @@
+#include "extdll.h"
+#include "util.h"
+#include "string_pool.h"
+#include "template_name_cache.h"
+
+CTemplateNameCache g_TemplateNameCache;
+
+CTemplateNameCache::CTemplateNameCache(): _generation(1)
+{
+	memset( _entries, 0, sizeof( _entries ) );
+	ResetStats();
+}
+
+unsigned int CTemplateNameCache::EntryIndex( int kind, const char *name, string_t entTemplate, string_t ownerTemplate )
+{
+	const unsigned int key = (unsigned int)( (size_t)name >> 2 );
+	const unsigned int hash = ( key * 2654435761u ) ^ ( (unsigned int)entTemplate * 73856093u )
+		^ ( (unsigned int)ownerTemplate * 19349663u ) ^ ( (unsigned int)kind * 83492791u );
+	return hash & ( ENTRY_COUNT - 1 );
+}
+
+bool CTemplateNameCache::Find( int kind, const char *name, string_t entTemplate, string_t ownerTemplate, int &slot )
+{
+	const Entry &entry = _entries[EntryIndex( kind, name, entTemplate, ownerTemplate )];
+	if( entry.generation == _generation && entry.key == name && entry.kind == kind
+		&& entry.entTemplate == entTemplate && entry.ownerTemplate == ownerTemplate && strcmp( entry.text, name ) == 0 )
+	{
+		_hits++;
+		slot = entry.slot;
+		return true;
+	}
+	_misses++;
+	return false;
+}
+
+void CTemplateNameCache::Store( int kind, const char *name, string_t entTemplate, string_t ownerTemplate, int slot )
+{
+	Entry &entry = _entries[EntryIndex( kind, name, entTemplate, ownerTemplate )];
+	entry.key = name;
+	entry.text = g_StringPool.Intern( name );
+	entry.entTemplate = entTemplate;
+	entry.ownerTemplate = ownerTemplate;
+	entry.kind = kind;
+	entry.slot = slot;
+	entry.generation = _generation;
+}
+
+void CTemplateNameCache::Clear()
+{
+	_generation++;
+	if( _generation == 0 )
+	{
+		memset( _entries, 0, sizeof( _entries ) );
+		_generation = 1;
+	}
+}
+
+void CTemplateNameCache::ReportStats()
+{
+	const unsigned int total = _hits + _misses;
+	ALERT( at_console, "Template name resolutions: %u\n", total );
+	ALERT( at_console, "Cache hits: %u, misses: %u", _hits, _misses );
+	if( total )
+		ALERT( at_console, " (%.1f%% hit)", (float)_hits * 100.0f / total );
+	ALERT( at_console, "\n" );
+}
+
+void CTemplateNameCache::ResetStats()
+{
+	_hits = _misses = 0;
+}
+
+void DumpTemplateNameCache()
+{
+	g_TemplateNameCache.ReportStats();
+	if( CMD_ARGC() > 1 && FStrEq( CMD_ARGV( 1 ), "reset" ) )
+		g_TemplateNameCache.ResetStats();
+}
@@ -0,0 +1,56 @@
+#pragma once
+#ifndef TEMPLATE_NAME_CACHE_H
+#define TEMPLATE_NAME_CACHE_H
+
+// Remembers which sound script or visual slot a name resolves to for a pair of entity templates,
+// so the template overrides and the name maps are only searched the first time.
+// Entries are keyed by the caller's string pointer and checked against the name text,
+// so a reused buffer can't return the slot of a different name.
+class CTemplateNameCache
+{
+public:
+	enum
+	{
+		KIND_SOUNDSCRIPT = 0,
+		KIND_VISUAL,
+	};
+
+	CTemplateNameCache();
+
+	bool Find( int kind, const char *name, string_t entTemplate, string_t ownerTemplate, int &slot );
+	void Store( int kind, const char *name, string_t entTemplate, string_t ownerTemplate, int slot );
+
+	// Template names are engine strings and template overrides can be added at runtime, so the cache is dropped on both
+	void Clear();
+
+	void ReportStats();
+	void ResetStats();
+
+	static const int ENTRY_COUNT = 4096;
+
+private:
+	struct Entry
+	{
+		const char *key;
+		const char *text;
+		string_t entTemplate;
+		string_t ownerTemplate;
+		int kind;
+		int slot;
+		unsigned int generation;
+	};
+
+	static unsigned int EntryIndex( int kind, const char *name, string_t entTemplate, string_t ownerTemplate );
+
+	Entry _entries[ENTRY_COUNT];
+	unsigned int _generation;
+
+	unsigned int _hits;
+	unsigned int _misses;
+};
+
+extern CTemplateNameCache g_TemplateNameCache;
+
+void DumpTemplateNameCache();
+
+#endif
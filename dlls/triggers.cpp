@@ -5424,6 +5424,7 @@ void CMotionManager::Affect( CBaseEntity *pTarget, CBaseEntity *pActivator )
 	pThread->pev->owner = edict();
 	pThread->Spawn();
 	pThread->pev->targetname = pev->targetname;
+	g_EntityNameIndex.Update( pThread->edict() );
 	pThread->m_hLocus = pActivator;
 	pThread->m_hTarget = pTarget;
 	pThread->m_iszPosition = m_iszPosition;
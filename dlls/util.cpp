@@ -31,56 +31,19 @@
 #include "global_models.h"
 #include "gamerules.h"
 #include "string_utils.h"
+#include "spatial_hash.h"
+#include "string_pool.h"
+#include "save_layout.h"
 
-#include <map>
 #include <set>
 #include <string>
 
-class StringPool
-{
-public:
-	void AddString(const char* str, string_t s)
-	{
-		stringMap[str] = s;
-	}
-	string_t FindString(const char* str)
-	{
-		auto it = stringMap.find(str);
-		if (it != stringMap.end())
-		{
-			return it->second;
-		}
-		else
-		{
-			return iStringNull;
-		}
-	}
-	void Clear()
-	{
-		stringMap.clear();
-	}
-private:
-	std::map<std::string, string_t> stringMap;
-};
-
 #define USE_STRINGPOOL 1
 
-StringPool g_StringPool;
-
 string_t ALLOC_STRING(const char* str)
 {
 #if USE_STRINGPOOL
-	string_t s = g_StringPool.FindString(str);
-	if (!FStringNull(s))
-	{
-		return s;
-	}
-	else
-	{
-		s = g_engfuncs.pfnAllocString(str);
-		g_StringPool.AddString(str, s);
-		return s;
-	}
+	return g_StringPool.EngineString(str);
 #else
 	return g_engfuncs.pfnAllocString(str);
 #endif
@@ -88,7 +51,7 @@ string_t ALLOC_STRING(const char* str)
 
 void ClearStringPool()
 {
-	g_StringPool.Clear();
+	g_StringPool.ClearEngineStrings();
 }
 
 extern cvar_t *g_psv_developer;
@@ -459,6 +422,9 @@ int UTIL_EntitiesInBox( CBaseEntity **pList, int listMax, const Vector &mins, co
 	CBaseEntity *pEntity;
 	int count;
 
+	if( g_EntitySpatialHash.EntitiesInBox( pList, listMax, mins, maxs, flagMask, count ) )
+		return count;
+
 	count = 0;
 
 	if( !pEdict )
@@ -501,6 +467,9 @@ int UTIL_MonstersInSphere( CBaseEntity **pList, int listMax, const Vector &cente
 	int		count;
 	float		distance, delta;
 
+	if( g_EntitySpatialHash.MonstersInSphere( pList, listMax, center, radius, count ) )
+		return count;
+
 	count = 0;
 	float radiusSquared = radius * radius;
 
@@ -558,6 +527,10 @@ CBaseEntity *UTIL_FindEntityInSphere( CBaseEntity *pStartEntity, const Vector &v
 {
 	edict_t	*pentEntity;
 
+	CBaseEntity *pResult;
+	if( g_EntitySpatialHash.FindEntityInSphere( pStartEntity, vecCenter, flRadius, pResult ) )
+		return pResult;
+
 	if( pStartEntity )
 		pentEntity = pStartEntity->edict();
 	else
@@ -570,6 +543,15 @@ CBaseEntity *UTIL_FindEntityInSphere( CBaseEntity *pStartEntity, const Vector &v
 	return NULL;
 }
 
+edict_t *UTIL_FindEdictByString( edict_t *pentStart, const char *szKeyword, const char *szValue )
+{
+	edict_t *pResult;
+	if( g_EntityNameIndex.FindEntityByString( pentStart, szKeyword, szValue, pResult ) )
+		return pResult;
+
+	return FIND_ENTITY_BY_STRING( pentStart, szKeyword, szValue );
+}
+
 CBaseEntity *UTIL_FindEntityByString( CBaseEntity *pStartEntity, const char *szKeyword, const char *szValue )
 {
 	edict_t	*pentEntity;
@@ -579,7 +561,7 @@ CBaseEntity *UTIL_FindEntityByString( CBaseEntity *pStartEntity, const char *szK
 	else
 		pentEntity = NULL;
 
-	pentEntity = FIND_ENTITY_BY_STRING( pentEntity, szKeyword, szValue );
+	pentEntity = UTIL_FindEdictByString( pentEntity, szKeyword, szValue );
 
 	if( !FNullEnt( pentEntity ) )
 		return CBaseEntity::Instance( pentEntity );
@@ -1447,11 +1429,10 @@ Vector UTIL_StringToVector(const char* str)
 }
 
 //LRC - randomized vectors of the form "0 0 0 .. 1 0 0"
-void UTIL_StringToRandomVector( float *pVector, const char *pString )
+bool UTIL_StringToVectorRange( float *pVector, float *pAltVector, const char *pString )
 {
 	char *pstr, *pfront, tempString[128];
 	int	j;
-	float pAltVec[3];
 
 	strcpy( tempString, pString );
 	pstr = pfront = tempString;
@@ -1477,12 +1458,22 @@ void UTIL_StringToRandomVector( float *pVector, const char *pString )
 	else if (*pstr == '.')
 	{
 		pstr++;
-		if (*pstr != '.') return;
+		if (*pstr != '.') return false;
 		pstr++;
-		if (*pstr != ' ') return;
+		if (*pstr != ' ') return false;
 
-		UTIL_StringToVector(pAltVec, pstr);
+		UTIL_StringToVector(pAltVector, pstr);
+		return true;
+	}
+	return false;
+}
+
+void UTIL_StringToRandomVector( float *pVector, const char *pString )
+{
+	float pAltVec[3];
 
+	if (UTIL_StringToVectorRange(pVector, pAltVec, pString))
+	{
 		pVector[0] = RANDOM_FLOAT( pVector[0], pAltVec[0] );
 		pVector[1] = RANDOM_FLOAT( pVector[1], pAltVec[1] );
 		pVector[2] = RANDOM_FLOAT( pVector[2], pAltVec[2] );
@@ -1631,6 +1622,7 @@ void UTIL_Remove( CBaseEntity *pEntity )
 	pEntity->UpdateOnRemove();
 	pEntity->pev->flags |= FL_KILLME;
 	pEntity->pev->targetname = 0;
+	g_EntityNameIndex.Update( pEntity->edict() );
 }
 
 BOOL UTIL_IsValidEntity( edict_t *pent )
@@ -1921,6 +1913,13 @@ unsigned short CSaveRestoreBuffer::TokenHash( const char *pszToken )
 	if( !m_pdata->tokenCount || !m_pdata->pTokens )
 		ALERT( at_error, "No token table array in TokenHash()!\n" );
 #endif
+	unsigned short cached;
+	if( g_SaveLayoutCache.FindToken( m_pdata, pszToken, cached ) )
+	{
+		m_pdata->pTokens[cached] = (char *)pszToken;
+		return cached;
+	}
+
 	for( int i = 0; i < m_pdata->tokenCount; i++ )
 	{
 #if _DEBUG
@@ -1938,6 +1937,7 @@ unsigned short CSaveRestoreBuffer::TokenHash( const char *pszToken )
 		if( !m_pdata->pTokens[index] || strcmp( pszToken, m_pdata->pTokens[index] ) == 0 )
 		{
 			m_pdata->pTokens[index] = (char *)pszToken;
+			g_SaveLayoutCache.StoreToken( m_pdata, pszToken, index, i + 1 );
 			return index;
 		}
 	}
@@ -2163,34 +2163,34 @@ int CSave::WriteEntVars( const char *pname, entvars_t *pev )
 
 int CSave::WriteFields( const char *pname, void *pBaseData, TYPEDESCRIPTION *pFields, int fieldCount )
 {
-	int i, j, actualCount, emptyCount;
+	int i, j, actualCount;
 	TYPEDESCRIPTION	*pTest;
 	int entityArray[MAX_ENTITYARRAY];
+	const CSaveLayoutCache::Layout *layout = g_SaveLayoutCache.GetLayout( pFields, fieldCount, gSizes );
 
-	// Precalculate the number of empty fields
-	emptyCount = 0;
-	for( i = 0; i < fieldCount; i++ )
+	// Empty fields will not be written, the actual number of fields is patched in once they're written
+	actualCount = 0;
+	char *pCountData = NULL;
+	if( m_pdata )
 	{
-		void *pOutputData;
-		pOutputData = ( (char *)pBaseData + pFields[i].fieldOffset );
-		if( DataEmpty( (const char *)pOutputData, pFields[i].fieldSize * gSizes[pFields[i].fieldType] ) )
-			emptyCount++;
+		const int sizeBefore = m_pdata->size;
+		pCountData = m_pdata->pCurrentData + 2 * sizeof(short);
+		WriteInt( pname, &actualCount, 1 );
+		if( m_pdata->size != sizeBefore + (int)( 2 * sizeof(short) + sizeof(int) ) )
+			pCountData = NULL;
 	}
 
-	// Empty fields will not be written, write out the actual number of fields to be written
-	actualCount = fieldCount - emptyCount;
-	WriteInt( pname, &actualCount, 1 );
-
 	for( i = 0; i < fieldCount; i++ )
 	{
 		void *pOutputData;
 		pTest = &pFields[i];
 		pOutputData = ( (char *)pBaseData + pTest->fieldOffset );
 
-		// UNDONE: Must we do this twice?
-		if( DataEmpty( (const char *)pOutputData, pTest->fieldSize * gSizes[pTest->fieldType] ) )
+		if( DataEmpty( (const char *)pOutputData, layout->byteSizes[i] ) )
 			continue;
 
+		actualCount++;
+
 		switch( pTest->fieldType )
 		{
 		case FIELD_FLOAT:
@@ -2264,6 +2264,9 @@ int CSave::WriteFields( const char *pname, void *pBaseData, TYPEDESCRIPTION *pFi
 		}
 	}
 
+	if( pCountData )
+		memcpy( pCountData, &actualCount, sizeof(int) );
+
 	return 1;
 }
 
@@ -2324,7 +2327,7 @@ void CSave::BufferData( const char *pdata, int size )
 // --------------------------------------------------------------
 int CRestore::ReadField( void *pBaseData, TYPEDESCRIPTION *pFields, int fieldCount, int startField, int size, char *pName, void *pData )
 {
-	int i, j, stringCount, fieldNumber, entityIndex;
+	int j, stringCount, fieldNumber, entityIndex;
 	TYPEDESCRIPTION *pTest;
 	float time, timeData;
 	Vector position;
@@ -2341,162 +2344,159 @@ int CRestore::ReadField( void *pBaseData, TYPEDESCRIPTION *pFields, int fieldCou
 			position = m_pdata->vecLandmarkOffset;
 	}
 
-	for( i = 0; i < fieldCount; i++ )
+	fieldNumber = g_SaveLayoutCache.FindField( g_SaveLayoutCache.GetLayout( pFields, fieldCount, gSizes ), pName, startField );
+	if( fieldNumber >= 0 )
 	{
-		fieldNumber = ( i + startField ) % fieldCount;
 		pTest = &pFields[fieldNumber];
-		if( pTest->fieldName && !stricmp( pTest->fieldName, pName ) )
+		if( !m_global || !(pTest->flags & FTYPEDESC_GLOBAL ) )
 		{
-			if( !m_global || !(pTest->flags & FTYPEDESC_GLOBAL ) )
+			for( j = 0; j < pTest->fieldSize; j++ )
 			{
-				for( j = 0; j < pTest->fieldSize; j++ )
-				{
-					void *pOutputData = ( (char *)pBaseData + pTest->fieldOffset + ( j * gSizes[pTest->fieldType] ) );
-					void *pInputData = (char *)pData + j * gInputSizes[pTest->fieldType];
+				void *pOutputData = ( (char *)pBaseData + pTest->fieldOffset + ( j * gSizes[pTest->fieldType] ) );
+				void *pInputData = (char *)pData + j * gInputSizes[pTest->fieldType];
 
-					switch( pTest->fieldType )
+				switch( pTest->fieldType )
+				{
+				case FIELD_TIME:
+				#if __VFP_FP__
+					memcpy( &timeData, pInputData, 4 );
+					// Re-base time variables
+					timeData += time;
+					memcpy( pOutputData, &timeData, 4 );
+				#else
+					timeData = *(float *)pInputData;
+					// Re-base time variables
+					timeData += time;
+					*( (float *)pOutputData ) = timeData;
+				#endif
+					break;
+				case FIELD_FLOAT:
+					memcpy( pOutputData, pInputData, 4 );
+					break;
+				case FIELD_MODELNAME:
+				case FIELD_SOUNDNAME:
+				case FIELD_STRING:
+					// Skip over j strings
+					pString = (char *)pData;
+					for( stringCount = 0; stringCount < j; stringCount++ )
 					{
-					case FIELD_TIME:
-					#if __VFP_FP__
-						memcpy( &timeData, pInputData, 4 );
-						// Re-base time variables
-						timeData += time;
-						memcpy( pOutputData, &timeData, 4 );
-					#else
-						timeData = *(float *)pInputData;
-						// Re-base time variables
-						timeData += time;
-						*( (float *)pOutputData ) = timeData;
-					#endif
-						break;
-					case FIELD_FLOAT:
-						memcpy( pOutputData, pInputData, 4 );
-						break;
-					case FIELD_MODELNAME:
-					case FIELD_SOUNDNAME:
-					case FIELD_STRING:
-						// Skip over j strings
-						pString = (char *)pData;
-						for( stringCount = 0; stringCount < j; stringCount++ )
-						{
-							while( *pString )
-								pString++;
+						while( *pString )
 							pString++;
-						}
-						pInputData = pString;
-						if( ( (char *)pInputData )[0] == '\0' )
-							*( (string_t *)pOutputData ) = 0;
-						else
-						{
-							string_t string;
+						pString++;
+					}
+					pInputData = pString;
+					if( ( (char *)pInputData )[0] == '\0' )
+						*( (string_t *)pOutputData ) = 0;
+					else
+					{
+						string_t string;
 
-							string = ALLOC_STRING( (char *)pInputData );
+						string = ALLOC_STRING( (char *)pInputData );
 
-							*( (string_t *)pOutputData ) = string;
+						*( (string_t *)pOutputData ) = string;
 
-							if( !FStringNull( string ) && m_precache )
-							{
-								if( pTest->fieldType == FIELD_MODELNAME )
-									PRECACHE_MODEL( STRING( string ) );
-								else if( pTest->fieldType == FIELD_SOUNDNAME )
-									PRECACHE_SOUND( STRING( string ) );
-							}
-						}
-						break;
-					case FIELD_EVARS:
-						entityIndex = *( int *)pInputData;
-						pent = EntityFromIndex( entityIndex );
-						if( pent )
-							*( (entvars_t **)pOutputData ) = VARS( pent );
-						else
-							*( (entvars_t **)pOutputData ) = NULL;
-						break;
-					case FIELD_CLASSPTR:
-						entityIndex = *( int *)pInputData;
-						pent = EntityFromIndex( entityIndex );
-						if( pent )
-							*( (CBaseEntity **)pOutputData ) = CBaseEntity::Instance( pent );
-						else
-							*( (CBaseEntity **)pOutputData ) = NULL;
-						break;
-					case FIELD_EDICT:
-						entityIndex = *(int *)pInputData;
-						pent = EntityFromIndex( entityIndex );
-						*( (edict_t **)pOutputData ) = pent;
-						break;
-					case FIELD_EHANDLE:
-						// Input and Output sizes are different!
-						pInputData = (char*)pData + j * gInputSizes[pTest->fieldType];
-						entityIndex = *(int *)pInputData;
-						pent = EntityFromIndex( entityIndex );
-						if( pent )
-							*( (EHANDLE *)pOutputData ) = CBaseEntity::Instance( pent );
-						else
-							*( (EHANDLE *)pOutputData ) = NULL;
-						break;
-					case FIELD_ENTITY:
-						entityIndex = *(int *)pInputData;
-						pent = EntityFromIndex( entityIndex );
-						if( pent )
-							*( (EOFFSET *)pOutputData ) = OFFSET( pent );
-						else
-							*( (EOFFSET *)pOutputData ) = 0;
-						break;
-					case FIELD_VECTOR:
-						#if __VFP_FP__
-						memcpy( pOutputData, pInputData, sizeof( Vector ) );
-						#else
-						( (float *)pOutputData )[0] = ( (float *)pInputData )[0];
-						( (float *)pOutputData )[1] = ( (float *)pInputData )[1];
-						( (float *)pOutputData )[2] = ( (float *)pInputData )[2];
-						#endif
-						break;
-					case FIELD_POSITION_VECTOR:
-						#if  __VFP_FP__
+						if( !FStringNull( string ) && m_precache )
 						{
-							Vector tmp;
-							memcpy( &tmp, pInputData, sizeof( Vector ) );
-							tmp = tmp + position;
-							memcpy( pOutputData, &tmp, sizeof( Vector ) );
+							if( pTest->fieldType == FIELD_MODELNAME )
+								PRECACHE_MODEL( STRING( string ) );
+							else if( pTest->fieldType == FIELD_SOUNDNAME )
+								PRECACHE_SOUND( STRING( string ) );
 						}
-						#else
-						( (float *)pOutputData )[0] = ( (float *)pInputData )[0] + position.x;
-						( (float *)pOutputData )[1] = ( (float *)pInputData )[1] + position.y;
-						( (float *)pOutputData )[2] = ( (float *)pInputData )[2] + position.z;
-						#endif
-						break;
-					case FIELD_BOOLEAN:
-					case FIELD_INTEGER:
-						*( (int *)pOutputData ) = *(int *)pInputData;
-						break;
-					case FIELD_SHORT:
-						*( (short *)pOutputData ) = *(short *)pInputData;
-						break;
-					case FIELD_CHARACTER:
-						*( (char *)pOutputData ) = *(char *)pInputData;
-						break;
-					case FIELD_POINTER:
-						*( (void**)pOutputData ) = *(void **)pInputData;
-						break;
-					case FIELD_FUNCTION:
-						if( ( (char *)pInputData )[0] == '\0' )
-							*( (void**)pOutputData ) = 0;
-						else
-							*( (void**)pOutputData ) = (void*)FUNCTION_FROM_NAME( (char *)pInputData );
-						break;
-					default:
-						ALERT( at_error, "Bad field type\n" );
 					}
+					break;
+				case FIELD_EVARS:
+					entityIndex = *( int *)pInputData;
+					pent = EntityFromIndex( entityIndex );
+					if( pent )
+						*( (entvars_t **)pOutputData ) = VARS( pent );
+					else
+						*( (entvars_t **)pOutputData ) = NULL;
+					break;
+				case FIELD_CLASSPTR:
+					entityIndex = *( int *)pInputData;
+					pent = EntityFromIndex( entityIndex );
+					if( pent )
+						*( (CBaseEntity **)pOutputData ) = CBaseEntity::Instance( pent );
+					else
+						*( (CBaseEntity **)pOutputData ) = NULL;
+					break;
+				case FIELD_EDICT:
+					entityIndex = *(int *)pInputData;
+					pent = EntityFromIndex( entityIndex );
+					*( (edict_t **)pOutputData ) = pent;
+					break;
+				case FIELD_EHANDLE:
+					// Input and Output sizes are different!
+					pInputData = (char*)pData + j * gInputSizes[pTest->fieldType];
+					entityIndex = *(int *)pInputData;
+					pent = EntityFromIndex( entityIndex );
+					if( pent )
+						*( (EHANDLE *)pOutputData ) = CBaseEntity::Instance( pent );
+					else
+						*( (EHANDLE *)pOutputData ) = NULL;
+					break;
+				case FIELD_ENTITY:
+					entityIndex = *(int *)pInputData;
+					pent = EntityFromIndex( entityIndex );
+					if( pent )
+						*( (EOFFSET *)pOutputData ) = OFFSET( pent );
+					else
+						*( (EOFFSET *)pOutputData ) = 0;
+					break;
+				case FIELD_VECTOR:
+					#if __VFP_FP__
+					memcpy( pOutputData, pInputData, sizeof( Vector ) );
+					#else
+					( (float *)pOutputData )[0] = ( (float *)pInputData )[0];
+					( (float *)pOutputData )[1] = ( (float *)pInputData )[1];
+					( (float *)pOutputData )[2] = ( (float *)pInputData )[2];
+					#endif
+					break;
+				case FIELD_POSITION_VECTOR:
+					#if  __VFP_FP__
+					{
+						Vector tmp;
+						memcpy( &tmp, pInputData, sizeof( Vector ) );
+						tmp = tmp + position;
+						memcpy( pOutputData, &tmp, sizeof( Vector ) );
+					}
+					#else
+					( (float *)pOutputData )[0] = ( (float *)pInputData )[0] + position.x;
+					( (float *)pOutputData )[1] = ( (float *)pInputData )[1] + position.y;
+					( (float *)pOutputData )[2] = ( (float *)pInputData )[2] + position.z;
+					#endif
+					break;
+				case FIELD_BOOLEAN:
+				case FIELD_INTEGER:
+					*( (int *)pOutputData ) = *(int *)pInputData;
+					break;
+				case FIELD_SHORT:
+					*( (short *)pOutputData ) = *(short *)pInputData;
+					break;
+				case FIELD_CHARACTER:
+					*( (char *)pOutputData ) = *(char *)pInputData;
+					break;
+				case FIELD_POINTER:
+					*( (void**)pOutputData ) = *(void **)pInputData;
+					break;
+				case FIELD_FUNCTION:
+					if( ( (char *)pInputData )[0] == '\0' )
+						*( (void**)pOutputData ) = 0;
+					else
+						*( (void**)pOutputData ) = (void*)FUNCTION_FROM_NAME( (char *)pInputData );
+					break;
+				default:
+					ALERT( at_error, "Bad field type\n" );
 				}
 			}
+		}
 #if 0
-			else
-			{
-				ALERT( at_console, "Skipping global field %s\n", pName );
-			}
-#endif
-			return fieldNumber;
+		else
+		{
+			ALERT( at_console, "Skipping global field %s\n", pName );
 		}
+#endif
+		return fieldNumber;
 	}
 	return -1;
 }
@@ -2531,11 +2531,12 @@ int CRestore::ReadFields( const char *pname, void *pBaseData, TYPEDESCRIPTION *p
 	lastField = 0;								// Make searches faster, most data is read/written in the same order
 
 	// Clear out base data
+	const CSaveLayoutCache::Layout *layout = g_SaveLayoutCache.GetLayout( pFields, fieldCount, gSizes );
 	for( i = 0; i < fieldCount; i++ )
 	{
 		// Don't clear global fields
 		if( !m_global || !( pFields[i].flags & FTYPEDESC_GLOBAL ) )
-			memset( ( (char *)pBaseData + pFields[i].fieldOffset ), 0, pFields[i].fieldSize * gSizes[pFields[i].fieldType] );
+			memset( ( (char *)pBaseData + pFields[i].fieldOffset ), 0, layout->byteSizes[i] );
 	}
 
 	for( i = 0; i < fileCount; i++ )
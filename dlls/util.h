@@ -69,14 +69,20 @@ extern void WRITE_COLOR(const Vector& color);
 extern void WRITE_VECTOR(const Vector& vecSrc);
 extern void WRITE_CIRCLE(const Vector& vecSrc, float radius);
 
+#if CLIENT_DLL
+#define UTIL_FindEdictByString FIND_ENTITY_BY_STRING
+#else
+extern edict_t *UTIL_FindEdictByString( edict_t *pentStart, const char *szKeyword, const char *szValue );
+#endif
+
 inline edict_t *FIND_ENTITY_BY_CLASSNAME(edict_t *entStart, const char *pszName) 
 {
-	return FIND_ENTITY_BY_STRING(entStart, "classname", pszName);
+	return UTIL_FindEdictByString(entStart, "classname", pszName);
 }
 
 inline edict_t *FIND_ENTITY_BY_TARGETNAME(edict_t *entStart, const char *pszName) 
 {
-	return FIND_ENTITY_BY_STRING(entStart, "targetname", pszName);
+	return UTIL_FindEdictByString(entStart, "targetname", pszName);
 }
 
 // for doing a reverse lookup. Say you have a door, and want to find its button.
@@ -327,6 +333,8 @@ extern void			UTIL_SparkShower( const Vector &position, const SparkEffectParams&
 extern void			UTIL_Ricochet( const Vector &position, float scale );
 extern Vector		UTIL_StringToVector( const char *str );
 extern void			UTIL_StringToRandomVector( float *pVector, const char *pString );
+// Returns true if the string is a "min .. max" range, with the other end written to pAltVector
+extern bool			UTIL_StringToVectorRange( float *pVector, float *pAltVector, const char *pString );
 extern void			UTIL_StringToIntArray( int *pVector, int count, const char *pString );
 extern Vector		UTIL_ClampVectorToBox( const Vector &input, const Vector &clampSize );
 
@@ -533,6 +541,7 @@ int SENTENCEG_Lookup(const char *sample, char *sentencenum);
 
 void TEXTURETYPE_Init();
 char TEXTURETYPE_Find(char *name);
+char TEXTURETYPE_FromTrace(TraceResult *ptr, Vector vecSrc, Vector vecEnd, bool *pIsSky = NULL);
 float TEXTURETYPE_PlaySound(TraceResult *ptr,  Vector vecSrc, Vector vecEnd, int iBulletType);
 
 // NOTE: use EMIT_SOUND_DYN to set the pitch of a sound. Pitch of 100
@@ -3,6 +3,7 @@
 #include "util.h"
 #include "visuals.h"
 #include "customentity.h"
+#include "string_pool.h"
 
 #include "json_utils.h"
 
@@ -162,14 +163,7 @@ void VisualSystem::AddVisualFromJsonValue(const char *name, Value &value)
 		auto it = value.FindMember("model");
 		if (it != value.MemberEnd())
 		{
-			std::string str = it->value.GetString();
-			auto strIt = _modelStringSet.find(str);
-			if (strIt == _modelStringSet.end())
-			{
-				auto p = _modelStringSet.insert(str);
-				strIt = p.first;
-			}
-			visual.SetModel(strIt->c_str());
+			visual.SetModel(g_StringPool.Intern(it->value.GetString(), it->value.GetStringLength()));
 		}
 	}
 
@@ -183,14 +177,7 @@ void VisualSystem::AddVisualFromJsonValue(const char *name, Value &value)
 			}
 			else
 			{
-				std::string str = it->value.GetString();
-				auto strIt = _modelStringSet.find(str);
-				if (strIt == _modelStringSet.end())
-				{
-					auto p = _modelStringSet.insert(str);
-					strIt = p.first;
-				}
-				visual.SetModel(strIt->c_str());
+				visual.SetModel(g_StringPool.Intern(it->value.GetString(), it->value.GetStringLength()));
 			}
 		}
 	}
@@ -307,34 +294,59 @@ void VisualSystem::AddVisualFromJsonValue(const char *name, Value &value)
 		}
 	}
 
-	_visuals[name] = visual;
+	AddVisual(name, visual);
+}
+
+VisualHandle VisualSystem::AddVisual(const std::string& name, const Visual& visual)
+{
+	auto it = _visualSlots.find(name);
+	if (it != _visualSlots.end())
+	{
+		_visuals[it->second] = visual;
+		return VisualHandle(it->second);
+	}
+	const int slot = (int)_visuals.size();
+	_visuals.push_back(visual);
+	_visualSlots[name] = slot;
+	return VisualHandle(slot);
 }
 
 void VisualSystem::EnsureVisualExists(const std::string& name)
 {
-	auto it = _visuals.find(name);
-	if (it == _visuals.end())
-		_visuals[name] = Visual();
+	auto it = _visualSlots.find(name);
+	if (it == _visualSlots.end())
+		AddVisual(name, Visual());
 }
 
-const Visual* VisualSystem::GetVisual(const char *name)
+VisualHandle VisualSystem::FindVisual(const char *name)
 {
 	if (!name || *name == '\0')
-		return nullptr;
+		return VisualHandle();
 	_temp = name; // reuse the same std::string for search to avoid reallocation
-	auto it = _visuals.find(_temp);
-	if (it != _visuals.end())
-		return &it->second;
+	auto it = _visualSlots.find(_temp);
+	if (it != _visualSlots.end())
+		return VisualHandle(it->second);
+	return VisualHandle();
+}
+
+const Visual* VisualSystem::GetVisual(VisualHandle handle) const
+{
+	if (handle.IsValid())
+		return &_visuals[handle.index];
 	return nullptr;
 }
 
+const Visual* VisualSystem::GetVisual(const char *name)
+{
+	return GetVisual(FindVisual(name));
+}
+
 const Visual* VisualSystem::ProvideDefaultVisual(const char *name, const Visual &visual, bool doPrecache)
 {
-	_temp = name;
-	auto it = _visuals.find(_temp);
-	if (it != _visuals.end())
+	const VisualHandle handle = FindVisual(name);
+	if (handle.IsValid())
 	{
-		Visual& existing = it->second;
+		Visual& existing = _visuals[handle.index];
 		existing.CompleteFrom(visual);
 
 		if (doPrecache)
@@ -344,16 +356,10 @@ const Visual* VisualSystem::ProvideDefaultVisual(const char *name, const Visual
 	}
 	else
 	{
-		auto inserted = _visuals.insert(std::make_pair(_temp, visual));
-		if (inserted.second)
-		{
-			Visual* insertedVisual = &inserted.first->second;
-			if (doPrecache)
-				insertedVisual->DoPrecache();
-			return insertedVisual;
-		}
-		// Should never get here: if it already existed it should have used the first if branch.
-		return nullptr;
+		Visual* insertedVisual = &_visuals[AddVisual(name, visual).index];
+		if (doPrecache)
+			insertedVisual->DoPrecache();
+		return insertedVisual;
 	}
 }
 
@@ -425,9 +431,9 @@ void VisualSystem::DumpVisualImpl(const char *name, const Visual &visual)
 
 void VisualSystem::DumpVisuals()
 {
-	for (const auto& p : _visuals)
+	for (const auto& p : _visualSlots)
 	{
-		DumpVisualImpl(p.first.c_str(),  p.second);
+		DumpVisualImpl(p.first.c_str(),  _visuals[p.second]);
 	}
 }
 
@@ -437,12 +443,12 @@ void VisualSystem::DumpVisual(const char *name)
 	if (_temp[_temp.size()-1] == '.' || _temp[_temp.size()-1] == '#')
 	{
 		bool foundSomething = false;
-		for (const auto& p : _visuals)
+		for (const auto& p : _visualSlots)
 		{
 			if (strnicmp(p.first.c_str(), _temp.c_str(), _temp.size()) == 0)
 			{
 				foundSomething = true;
-				DumpVisualImpl(p.first.c_str(),  p.second);
+				DumpVisualImpl(p.first.c_str(),  _visuals[p.second]);
 			}
 		}
 		if (foundSomething)
@@ -450,10 +456,10 @@ void VisualSystem::DumpVisual(const char *name)
 	}
 	else
 	{
-		auto it = _visuals.find(_temp);
-		if (it != _visuals.end())
+		auto it = _visualSlots.find(_temp);
+		if (it != _visualSlots.end())
 		{
-			DumpVisualImpl(name, it->second);
+			DumpVisualImpl(name, _visuals[it->second]);
 			return;
 		}
 	}
@@ -6,8 +6,8 @@
 #include "template_property_types.h"
 #include "rapidjson/document.h"
 
+#include <deque>
 #include <map>
-#include <set>
 #include <string>
 #include "icase_compare.h"
 
@@ -257,12 +257,25 @@ private:
 	NamedVisual visual;
 };
 
+// Slot of a visual in VisualSystem. Slots are never removed, so a handle stays valid for the whole game.
+struct VisualHandle
+{
+	VisualHandle(): index(-1) {}
+	explicit VisualHandle(int i): index(i) {}
+	bool IsValid() const {
+		return index >= 0;
+	}
+	int index;
+};
+
 class VisualSystem
 {
 public:
 	bool ReadFromFile(const char* fileName);
 	void AddVisualFromJsonValue(const char* name, rapidjson::Value& value);
 	void EnsureVisualExists(const std::string& name);
+	VisualHandle FindVisual(const char* name);
+	const Visual* GetVisual(VisualHandle handle) const;
 	const Visual* GetVisual(const char* name);
 	const Visual* ProvideDefaultVisual(const char* name, const Visual& visual, bool doPrecache);
 	const Visual* ProvideDefaultVisual(const char* name, const Visual& visual, const char* mixinName, const Visual& mixinVisual);
@@ -271,8 +284,11 @@ public:
 private:
 	void DumpVisualImpl(const char* name, const Visual& visual);
 
-	std::map<std::string, Visual, CaseInsensitiveCompare> _visuals;
-	std::set<std::string> _modelStringSet;
+	VisualHandle AddVisual(const std::string& name, const Visual& visual);
+
+	// Visuals are stored by slot, the map only resolves names. std::deque keeps returned pointers valid when it grows.
+	std::map<std::string, int, CaseInsensitiveCompare> _visualSlots;
+	std::deque<Visual> _visuals;
 	std::string _temp;
 };
 
@@ -62,6 +62,11 @@ public:
 	static constexpr const char* attackHitSoundScript = "Zombie.AttackHit";
 	static constexpr const char* attackMissSoundScript = "Zombie.AttackMiss";
 
+	SoundScriptHandle m_painSound;
+	SoundScriptHandle m_attackSound;
+	SoundScriptHandle m_attackHitSound;
+	SoundScriptHandle m_attackMissSound;
+
 	// No range attacks
 	BOOL CheckRangeAttack1( float flDot, float flDist ) { return FALSE; }
 	BOOL CheckRangeAttack2( float flDot, float flDist ) { return FALSE; }
@@ -150,7 +155,7 @@ int CZombie::TakeDamage( entvars_t *pevInflictor, entvars_t *pevAttacker, float
 void CZombie::PainSound( void )
 {
 	if( RANDOM_LONG( 0, 5 ) < 2 )
-		EmitSoundScript(painSoundScript);
+		EmitSoundScript(m_painSound, painSoundScript);
 }
 
 void CZombie::AlertSound( void )
@@ -165,7 +170,7 @@ void CZombie::IdleSound( void )
 
 void CZombie::AttackSound( void )
 {
-	EmitSoundScript(attackSoundScript);
+	EmitSoundScript(m_attackSound, attackSoundScript);
 }
 
 //=========================================================
@@ -185,10 +190,10 @@ void CZombie::SlashAttack(float dmg, float rightScalar, float forwardScalar, flo
 			pHurt->pev->punchangle.x = 5;
 			pHurt->pev->velocity = pHurt->pev->velocity + gpGlobals->v_right * rightScalar + gpGlobals->v_forward * forwardScalar;
 		}
-		EmitSoundScript(attackHitSoundScript);
+		EmitSoundScript(m_attackHitSound, attackHitSoundScript);
 	}
 	else // Play a random attack miss sound
-		EmitSoundScript(attackMissSoundScript);
+		EmitSoundScript(m_attackMissSound, attackMissSoundScript);
 
 	if (RANDOM_LONG(0,1))
 		AttackSound();
@@ -260,6 +265,11 @@ void CZombie::PrecacheSounds()
 	RegisterAndPrecacheSoundScript(attackSoundScript);
 	RegisterAndPrecacheSoundScript(attackHitSoundScript, NPC::attackHitSoundScript);
 	RegisterAndPrecacheSoundScript(attackMissSoundScript, NPC::attackMissSoundScript);
+
+	m_painSound = ResolveSoundScript(painSoundScript);
+	m_attackSound = ResolveSoundScript(attackSoundScript);
+	m_attackHitSound = ResolveSoundScript(attackHitSoundScript);
+	m_attackMissSound = ResolveSoundScript(attackMissSoundScript);
 }
 
 //=========================================================
@@ -51,4 +51,14 @@ enum
 #define SPRAY_FLAG_ANIMATE (1 << 1)
 #define SPRAY_FLAG_FADEOUT (1 << 2)
 
+// Pellets per BulletVolley message, larger volleys are split over several messages
+#define BULLET_VOLLEY_MAX_PELLETS 8
+
+#define BULLET_VOLLEY_TRACER (1 << 0)
+#define BULLET_VOLLEY_HIT (1 << 1)
+#define BULLET_VOLLEY_DECAL (1 << 2)
+#define BULLET_VOLLEY_SOUND (1 << 3)
+#define BULLET_VOLLEY_QUIET_SOUND (1 << 4)
+#define BULLET_VOLLEY_SPARKS (1 << 5)
+
 #endif
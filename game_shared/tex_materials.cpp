@@ -1,6 +1,8 @@
 #include "tex_materials.h"
 #include "pm_materials.h"
 #include "bullet_types.h"
+#include <cctype>
+#include <cstdint>
 #include <cstring>
 
 int GetTextureMaterialProperties(char chTextureType, float* fvol, float* fvolbar,
@@ -115,3 +117,139 @@ void GetStrippedTextureName(char *szbuffer, const char *pTextureName)
 	strcpy( szbuffer, pTextureName );
 	szbuffer[CBTEXTURENAMEMAX - 1] = 0;
 }
+
+void TextureMaterialTable::Clear()
+{
+	_entries.clear();
+	_slots.clear();
+	memset(_textureCache, 0, sizeof(_textureCache));
+}
+
+unsigned int TextureMaterialTable::HashName(const char* name)
+{
+	// FNV-1a over the lowercased name
+	unsigned int hash = 2166136261u;
+
+	for (int i = 0; i < MaxNameLength && name[i]; ++i)
+	{
+		hash ^= static_cast<unsigned char>(tolower(static_cast<unsigned char>(name[i])));
+		hash *= 16777619u;
+	}
+
+	return hash;
+}
+
+int TextureMaterialTable::FindEntry(const char* name, unsigned int hash) const
+{
+	if (_slots.empty())
+		return -1;
+
+	const size_t mask = _slots.size() - 1;
+
+	for (size_t slot = hash & mask;; slot = (slot + 1) & mask)
+	{
+		const int index = _slots[slot];
+
+		if (index == -1)
+			return -1;
+
+		const Entry& entry = _entries[index];
+
+		if (entry.hash == hash && strnicmp(entry.name, name, MaxNameLength) == 0)
+			return index;
+	}
+}
+
+void TextureMaterialTable::Rehash(std::size_t slotCount)
+{
+	_slots.assign(slotCount, -1);
+
+	const size_t mask = slotCount - 1;
+
+	for (size_t i = 0; i < _entries.size(); ++i)
+	{
+		size_t slot = _entries[i].hash & mask;
+
+		while (_slots[slot] != -1)
+			slot = (slot + 1) & mask;
+
+		_slots[slot] = static_cast<int>(i);
+	}
+}
+
+void TextureMaterialTable::Add(const char* name, char type)
+{
+	const unsigned int hash = HashName(name);
+
+	if (FindEntry(name, hash) != -1)
+		return;
+
+	Entry entry;
+	strncpy(entry.name, name, MaxNameLength);
+	entry.name[MaxNameLength] = '\0';
+	entry.hash = hash;
+	entry.type = type;
+
+	_entries.push_back(entry);
+
+	// Keep the load factor at or below one half
+	if (_entries.size() * 2 > _slots.size())
+	{
+		size_t slotCount = 64;
+
+		while (slotCount < _entries.size() * 2)
+			slotCount *= 2;
+
+		Rehash(slotCount);
+	}
+	else
+	{
+		const size_t mask = _slots.size() - 1;
+		size_t slot = hash & mask;
+
+		while (_slots[slot] != -1)
+			slot = (slot + 1) & mask;
+
+		_slots[slot] = static_cast<int>(_entries.size() - 1);
+	}
+}
+
+char TextureMaterialTable::Find(const char* name, char defaultType) const
+{
+	const int index = FindEntry(name, HashName(name));
+
+	return index != -1 ? _entries[index].type : defaultType;
+}
+
+char TextureMaterialTable::FindByTexture(const char* pTextureName, char defaultType)
+{
+	CachedTexture& cached = _textureCache[(reinterpret_cast<uintptr_t>(pTextureName) >> 4) & (TextureCacheSize - 1)];
+
+	// The engine may reuse the memory for another texture after a map change
+	if (cached.texture == pTextureName && strncmp(cached.rawName, pTextureName, TextureNameLength) == 0)
+		return cached.type;
+
+	char szbuffer[TextureNameLength + 1];
+	strncpy(szbuffer, pTextureName, TextureNameLength);
+	szbuffer[TextureNameLength] = '\0';
+
+	char stripped[TextureNameLength + 1];
+	GetStrippedTextureName(stripped, szbuffer);
+
+	cached.texture = pTextureName;
+	strncpy(cached.rawName, pTextureName, TextureNameLength);
+	cached.type = Find(stripped, defaultType);
+
+	return cached.type;
+}
+
+bool TextureMaterialTable::HasType(char type) const
+{
+	for (const Entry& entry : _entries)
+	{
+		if (entry.type == type)
+			return true;
+	}
+
+	return false;
+}
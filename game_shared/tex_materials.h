@@ -2,8 +2,67 @@
 #ifndef TEX_MATERIALS_H
 #define TEX_MATERIALS_H
 
+#include <cstddef>
+#include <vector>
+
+#include "pm_materials.h"
+
 int GetTextureMaterialProperties(char chTextureType, float* fvol, float* fvolbar, const char* rgsz[4], int* cnt, float* fattn, int iBulletType);
 
 void GetStrippedTextureName(char* szbuffer, const char* pTextureName);
 
+/**
+*	@brief Case-insensitive texture name to material type table, as loaded from sound/materials.txt.
+*	Names are compared on their first CBTEXTURENAMEMAX - 1 characters like the original sorted list.
+*	Lookups by the engine's texture name pointer are cached, so repeated hits on the same surface skip the name handling.
+*/
+class TextureMaterialTable
+{
+public:
+	void Clear();
+
+	/**
+	*	@brief Adds a texture. If the name is already present the first entry is kept.
+	*/
+	void Add(const char* name, char type);
+
+	char Find(const char* name, char defaultType) const;
+
+	/**
+	*	@brief Finds the type of a texture name as returned by the engine's texture traces, before stripping.
+	*	The pointer must stay valid while the current map is loaded.
+	*/
+	char FindByTexture(const char* pTextureName, char defaultType);
+
+	bool HasType(char type) const;
+	int Count() const { return static_cast<int>(_entries.size()); }
+
+private:
+	static constexpr int MaxNameLength = CBTEXTURENAMEMAX - 1;
+	static constexpr int TextureNameLength = 16; //Size of texture names in BSP files
+	static constexpr int TextureCacheSize = 256;
+
+	struct Entry
+	{
+		char name[CBTEXTURENAMEMAX];
+		unsigned int hash;
+		char type;
+	};
+
+	struct CachedTexture
+	{
+		const char* texture;
+		char rawName[TextureNameLength];
+		char type;
+	};
+
+	static unsigned int HashName(const char* name);
+	int FindEntry(const char* name, unsigned int hash) const;
+	void Rehash(std::size_t slotCount);
+
+	std::vector<Entry> _entries;
+	std::vector<int> _slots; //Open addressing, -1 for empty slots
+	CachedTexture _textureCache[TextureCacheSize] = {};
+};
+
 #endif
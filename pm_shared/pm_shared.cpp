@@ -63,7 +63,6 @@ playermove_t *pmove = NULL;
 #define VEC_VIEW		28
 #define	STOP_EPSILON		0.1f
 
-#define CTEXTURESMAX		1024			// max number of textures loaded
 #include "pm_materials.h"
 
 #define STEP_CONCRETE		0		// default step sound
@@ -110,9 +109,7 @@ static Vector rgv3tStuckTable[54];
 static int rgStuckLast[MAX_CLIENTS][2];
 
 // Texture names
-static int gcTextures = 0;
-static char grgszTextureName[CTEXTURESMAX][CBTEXTURENAMEMAX];	
-static char grgchTextureType[CTEXTURESMAX];
+static TextureMaterialTable g_textureMaterials;
 
 bool g_onladder = true;
 
@@ -130,55 +127,15 @@ static void PM_TraceModel( physent_t *pe, float *start, float *end, trace_t *tra
 	pmove->PM_TraceModel(pe, start, end, trace);
 }
 
-void PM_SwapTextures( int i, int j )
-{
-	char chTemp;
-	char szTemp[CBTEXTURENAMEMAX];
-
-	strcpy( szTemp, grgszTextureName[i] );
-	chTemp = grgchTextureType[i];
-	
-	strcpy( grgszTextureName[i], grgszTextureName[j] );
-	grgchTextureType[i] = grgchTextureType[j];
-
-	strcpy( grgszTextureName[j], szTemp );
-	grgchTextureType[j] = chTemp;
-}
-
 int PM_IsThereSnowTexture()
 {
-	int i;
-	for (i = 0; i < gcTextures; ++i)
-	{
-		if (grgchTextureType[i] == CHAR_TEX_SNOW || grgchTextureType[i] == CHAR_TEX_SNOW_OPFOR)
-			return 1;
-	}
-	return 0;
-}
-
-void PM_SortTextures( void )
-{
-	// Bubble sort, yuck, but this only occurs at startup and it's only 512 elements...
-	//
-	int i, j;
-
-	for( i = 0; i < gcTextures; i++ )
-	{
-		for( j = i + 1; j < gcTextures; j++ )
-		{
-			if( stricmp( grgszTextureName[i], grgszTextureName[j] ) > 0 )
-			{
-				// Swap
-				//
-				PM_SwapTextures( i, j );
-			}
-		}
-	}
+	return g_textureMaterials.HasType( CHAR_TEX_SNOW ) || g_textureMaterials.HasType( CHAR_TEX_SNOW_OPFOR );
 }
 
 void PM_InitTextureTypes( void )
 {
 	char buffer[512];
+	char chTextureType;
 	int i, j;
 	byte *pMemFile;
 	int fileSize, filePos = 0;
@@ -187,10 +144,7 @@ void PM_InitTextureTypes( void )
 	if( bTextureTypeInit )
 		return;
 
-	memset(&( grgszTextureName[0][0] ), 0, sizeof( grgszTextureName ) );
-	memset( grgchTextureType, 0, sizeof( grgchTextureType ) );
-
-	gcTextures = 0;
+	g_textureMaterials.Clear();
 
 	pMemFile = pmove->COM_LoadFile( "sound/materials.txt", 5, &fileSize );
 	if( !pMemFile )
@@ -199,7 +153,7 @@ void PM_InitTextureTypes( void )
 	memset( buffer, 0, sizeof( buffer ) );
 
 	// for each line in the file...
-	while( pmove->memfgets( pMemFile, fileSize, &filePos, buffer, 511 ) != NULL && (gcTextures < CTEXTURESMAX ) )
+	while( pmove->memfgets( pMemFile, fileSize, &filePos, buffer, 511 ) != NULL )
 	{
 		// skip whitespace
 		i = 0;
@@ -214,7 +168,7 @@ void PM_InitTextureTypes( void )
 			continue;
 
 		// get texture type
-		grgchTextureType[gcTextures] = toupper( buffer[i++] );
+		chTextureType = toupper( buffer[i++] );
 
 		// skip whitespace
 		while( buffer[i] && isspace( buffer[i] ) )
@@ -231,50 +185,30 @@ void PM_InitTextureTypes( void )
 		if( !buffer[j] )
 			continue;
 
-		// null-terminate name and save in sentences array
+		// null-terminate name and save in texture table
 		j = Q_min( j, CBTEXTURENAMEMAX - 1 + i );
 		buffer[j] = 0;
-		strcpy( &( grgszTextureName[gcTextures++][0] ), &( buffer[i] ) );
+		g_textureMaterials.Add( &( buffer[i] ), chTextureType );
 	}
 
 	// Must use engine to free since we are in a .dll
 	pmove->COM_FreeFile( pMemFile );
 
-	PM_SortTextures();
-
 	bTextureTypeInit = true;
 }
 
 char PM_FindTextureType( const char *name )
 {
-	int left, right, pivot;
-	int val;
-
 	assert( pm_shared_initialized );
 
-	left = 0;
-	right = gcTextures - 1;
-
-	while( left <= right )
-	{
-		pivot = ( left + right ) / 2;
+	return g_textureMaterials.Find( name, CHAR_TEX_CONCRETE );
+}
 
-		val = strnicmp( name, grgszTextureName[pivot], CBTEXTURENAMEMAX - 1 );
-		if( val == 0 )
-		{
-			return grgchTextureType[pivot];
-		}
-		else if( val > 0 )
-		{
-			left = pivot + 1;
-		}
-		else if( val < 0 )
-		{
-			right = pivot - 1;
-		}
-	}
+char PM_FindTextureTypeByTexture( const char *pTextureName )
+{
+	assert( pm_shared_initialized );
 
-	return CHAR_TEX_CONCRETE;
+	return g_textureMaterials.FindByTexture( pTextureName, CHAR_TEX_CONCRETE );
 }
 
 void PM_PlayStepSound( int step, float fvol )
@@ -574,7 +508,7 @@ void PM_CatagorizeTextureType( void )
 	GetStrippedTextureName(pmove->sztexturename, pTextureName);
 
 	// get texture type
-	pmove->chtexturetype = PM_FindTextureType( pmove->sztexturename );	
+	pmove->chtexturetype = PM_FindTextureTypeByTexture( pTextureName );
 }
 
 void PM_UpdateStepSound( void )
@@ -19,6 +19,8 @@
 void PM_Init( struct playermove_s *ppmove );
 void PM_Move( struct playermove_s *ppmove, int server );
 char PM_FindTextureType( const char* name );
+// Looks up an unstripped texture name as returned by texture traces, caching the result per texture
+char PM_FindTextureTypeByTexture( const char* pTextureName );
 
 // Spectator Movement modes (stored in pev->iuser1, so the physics code can get at them)
 #define OBS_NONE			0